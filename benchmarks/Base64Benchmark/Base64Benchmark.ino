@@ -0,0 +1,100 @@
+#include <ArduinoHA.h>
+
+#define DATA_SIZE 65535
+#define ITERATIONS_NB 200
+
+static const char* Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static uint32_t checksum = 0;
+
+/**
+ * Reference encoder that processes the data byte by byte.
+ */
+uint32_t encodeNaive(char* output, const uint8_t* data, const uint32_t length)
+{
+    uint32_t position = 0;
+    uint32_t bits = 0;
+    uint8_t bitsNb = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        bits = (bits << 8) | data[i];
+        bitsNb += 8;
+
+        while (bitsNb >= 6) {
+            bitsNb -= 6;
+            output[position++] = Alphabet[(bits >> bitsNb) & 0x3F];
+        }
+    }
+
+    if (bitsNb > 0) {
+        output[position++] = Alphabet[(bits << (6 - bitsNb)) & 0x3F];
+    }
+
+    while (position % 4 != 0) {
+        output[position++] = '=';
+    }
+
+    return position;
+}
+
+/**
+ * Returns the average time (microseconds) needed to encode the data.
+ */
+template <typename Encoder>
+uint32_t measure(Encoder encoder, char* output, const uint8_t* data)
+{
+    const uint32_t startedAt = micros();
+
+    for (uint8_t i = 0; i < ITERATIONS_NB; i++) {
+        checksum += encoder(output, data, DATA_SIZE);
+        checksum += output[i];
+    }
+
+    return (micros() - startedAt) / ITERATIONS_NB;
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+
+    uint8_t* data = new uint8_t[DATA_SIZE];
+    char* output = new char[HABase64::calculateEncodedLength(DATA_SIZE)];
+    char* expected = new char[HABase64::calculateEncodedLength(DATA_SIZE)];
+
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        data[i] = (i * 2654435761UL) >> 24;
+    }
+
+    const uint32_t naiveTime = measure(encodeNaive, expected, data);
+    const uint32_t swarTime = measure(HABase64::encode, output, data);
+    const bool equal = memcmp(
+        expected,
+        output,
+        HABase64::calculateEncodedLength(DATA_SIZE)
+    ) == 0;
+
+    Serial.print(F("data: "));
+    Serial.print(DATA_SIZE);
+    Serial.print(F(" bytes, per-byte loop: "));
+    Serial.print(naiveTime);
+    Serial.print(F(" us, HABase64: "));
+    Serial.print(swarTime);
+    Serial.print(F(" us, equal output: "));
+    Serial.print(equal ? F("yes") : F("no"));
+    Serial.print(F(", checksum: "));
+    Serial.println(checksum);
+
+    delete[] data;
+    delete[] output;
+    delete[] expected;
+
+#if defined(EPOXY_DUINO)
+    exit(0);
+#endif
+}
+
+void loop()
+{
+
+}
@@ -0,0 +1,84 @@
+#include <ArduinoHA.h>
+
+#define ENTITIES_NB 40
+#define ROUNDS_NB 50
+
+static const char* testDeviceId = "testDevice";
+static const uint16_t bufferSizes[] = {0, 64, 256, 1460};
+
+class BenchmarkSensor : public HASensor
+{
+public:
+    BenchmarkSensor(const char* uniqueId) : HASensor(uniqueId) { }
+
+    void discover()
+        { publishConfig(); }
+};
+
+void runBenchmark(const uint16_t bufferSize)
+{
+    PubSubClientMock* mock = new PubSubClientMock();
+    HADevice device(testDeviceId);
+    HAMqtt mqtt(mock, device, ENTITIES_NB);
+    mqtt.enablePayloadBuffer(bufferSize);
+    mqtt.begin("testHost");
+
+    char ids[ENTITIES_NB][12];
+    BenchmarkSensor* sensors[ENTITIES_NB];
+
+    for (uint8_t i = 0; i < ENTITIES_NB; i++) {
+        sprintf(ids[i], "sensor%u", i);
+        sensors[i] = new BenchmarkSensor(ids[i]);
+        sensors[i]->setName(ids[i]);
+        sensors[i]->setIcon("mdi:home");
+    }
+
+    mock->connectDummy();
+
+    const uint32_t writesBefore = mock->getWritesNb();
+    const uint32_t startedAt = micros();
+
+    for (uint8_t round = 0; round < ROUNDS_NB; round++) {
+        for (uint8_t i = 0; i < ENTITIES_NB; i++) {
+            sensors[i]->discover();
+        }
+
+        mock->clearFlushedMessages();
+    }
+
+    const uint32_t duration = (micros() - startedAt) / ROUNDS_NB;
+    const uint32_t writesNb = (mock->getWritesNb() - writesBefore) / ROUNDS_NB;
+
+    Serial.print(F("payload buffer: "));
+    Serial.print(bufferSize);
+    Serial.print(F(" B, discovery of "));
+    Serial.print(ENTITIES_NB);
+    Serial.print(F(" entities: "));
+    Serial.print(duration);
+    Serial.print(F(" us, client writes: "));
+    Serial.println(writesNb);
+
+    for (uint8_t i = 0; i < ENTITIES_NB; i++) {
+        delete sensors[i];
+    }
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+
+    for (uint8_t i = 0; i < sizeof(bufferSizes) / sizeof(bufferSizes[0]); i++) {
+        runBenchmark(bufferSizes[i]);
+    }
+
+#if defined(EPOXY_DUINO)
+    exit(0);
+#endif
+}
+
+void loop()
+{
+
+}
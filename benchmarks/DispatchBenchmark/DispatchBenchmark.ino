@@ -0,0 +1,87 @@
+#include <ArduinoHA.h>
+
+#define MESSAGES_NB 2000
+
+static const char* testDeviceId = "testDevice";
+static const uint8_t entitiesNbs[] = {1, 8, 16, 32, 64, 128};
+static uint32_t commandsNb = 0;
+
+void onSwitchCommand(bool state, HASwitch* sender)
+{
+    (void)state;
+    (void)sender;
+
+    commandsNb++;
+}
+
+/**
+ * Returns the average time (nanoseconds) needed to process a single message.
+ */
+uint32_t measureDispatch(PubSubClientMock* mock, const char* topic)
+{
+    const uint32_t startedAt = micros();
+
+    for (uint16_t i = 0; i < MESSAGES_NB; i++) {
+        mock->fakeMessage(topic, "ON");
+    }
+
+    return ((micros() - startedAt) * 1000UL) / MESSAGES_NB;
+}
+
+void runBenchmark(const uint8_t entitiesNb)
+{
+    PubSubClientMock* mock = new PubSubClientMock();
+    HADevice device(testDeviceId);
+    HAMqtt mqtt(mock, device, entitiesNb);
+    mqtt.begin("testHost");
+
+    char ids[entitiesNb][8];
+    HASwitch* switches[entitiesNb];
+
+    for (uint8_t i = 0; i < entitiesNb; i++) {
+        sprintf(ids[i], "sw%u", i);
+        switches[i] = new HASwitch(ids[i]);
+        switches[i]->onCommand(onSwitchCommand);
+    }
+
+    char ownedTopic[64];
+    sprintf(ownedTopic, "aha/testDevice/%s/cmd_t", ids[entitiesNb - 1]);
+
+    commandsNb = 0;
+    const uint32_t ownedTime = measureDispatch(mock, ownedTopic);
+    const uint32_t handledNb = commandsNb;
+    const uint32_t foreignTime = measureDispatch(mock, "aha/testDevice/unknown/cmd_t");
+
+    Serial.print(F("entities: "));
+    Serial.print(entitiesNb);
+    Serial.print(F(", owned topic: "));
+    Serial.print(ownedTime);
+    Serial.print(F(" ns/msg, unknown object ID (broadcast): "));
+    Serial.print(foreignTime);
+    Serial.print(F(" ns/msg, handled commands: "));
+    Serial.println(handledNb);
+
+    for (uint8_t i = 0; i < entitiesNb; i++) {
+        delete switches[i];
+    }
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+
+    for (uint8_t i = 0; i < sizeof(entitiesNbs); i++) {
+        runBenchmark(entitiesNbs[i]);
+    }
+
+#if defined(EPOXY_DUINO)
+    exit(0);
+#endif
+}
+
+void loop()
+{
+
+}
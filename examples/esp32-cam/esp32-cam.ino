@@ -73,6 +73,7 @@ void setup() {
 
   haCamera.setIcon("mdi:home");
   haCamera.setName("Garden camera");
+  haCamera.enableChangeDetection(); // static scenes are published once per minute
 
   mqtt.begin(BROKER_ADDR);
 }
@@ -179,6 +180,8 @@ void publishCameraImage() {
 
   Serial.printf("Image size: %db\n", fb->len);
 
+  // the frame is streamed from the buffer without copying
+  // frames bigger than 64 KB require the ARDUINOHA_NATIVE_MQTT macro (see ArduinoHADefines.h)
   haCamera.publishImage(fb->buf, fb->len);
   esp_camera_fb_return(fb);
   lastPublishAt = millis();
@@ -3,6 +3,7 @@
 
 #include "HADevice.h"
 #include "HAMqtt.h"
+#include "HAMqttClient.h"
 #include "device-types/HAAlarmControlPanel.h"
 #include "device-types/HABinarySensor.h"
 #include "device-types/HAButton.h"
@@ -22,10 +23,19 @@
 #include "device-types/HASwitch.h"
 #include "device-types/HATagScanner.h"
 #include "utils/HAUtils.h"
+#include "utils/HABase64.h"
+#include "utils/HADeadband.h"
 #include "utils/HANumeric.h"
+#include "utils/HAPublishQueue.h"
+#include "utils/HASubscriptionBatch.h"
+#include "utils/HAStorage.h"
+#include "utils/HATimerWheel.h"
+#include "utils/HATopicCache.h"
 
 #ifdef ARDUINOHA_TEST
 #include "mocks/AUnitHelpers.h"
+#include "mocks/ClientMock.h"
+#include "mocks/FileStorageMock.h"
 #include "mocks/PubSubClientMock.h"
 #include "utils/HADictionary.h"
 #include "utils/HASerializer.h"
@@ -3,6 +3,16 @@
 // by calling Serial.begin([baudRate]) before initializing ArduinoHA.
 // #define ARDUINOHA_DEBUG
 
+// Replaces PubSubClient with the built-in MQTT client (HAMqttClient).
+// #define ARDUINOHA_NATIVE_MQTT
+
+// These macros enable optional features of the library.
+// Code of the disabled features is not compiled, so it doesn't occupy flash memory and RAM.
+// #define ARDUINOHA_PUBLISH_SCHEDULER
+// #define ARDUINOHA_PUBLISH_QUEUE
+// #define ARDUINOHA_TOPIC_CACHE
+// #define ARDUINOHA_SUBSCRIPTION_BATCH
+
 // These macros allow to exclude some parts of the library to save more resources.
 // #define EX_ARDUINOHA_BINARY_SENSOR
 // #define EX_ARDUINOHA_BUTTON
@@ -21,6 +31,14 @@
 // #define EX_ARDUINOHA_SWITCH
 // #define EX_ARDUINOHA_TAG_SCANNER
 
+#if defined(ARDUINOHA_TEST)
+    // unit tests cover all optional features
+    #define ARDUINOHA_PUBLISH_SCHEDULER
+    #define ARDUINOHA_PUBLISH_QUEUE
+    #define ARDUINOHA_TOPIC_CACHE
+    #define ARDUINOHA_SUBSCRIPTION_BATCH
+#endif
+
 #if defined(ARDUINOHA_DEBUG)
     #include <Arduino.h>
 
@@ -10,7 +10,11 @@
     _availabilityTopic(nullptr), \
     _sharedAvailability(false), \
     _available(true), \
-    _extendedUniqueIds(false)
+    _extendedUniqueIds(false), \
+    _jsonCacheEnabled(false), \
+    _jsonDirty(true), \
+    _json(nullptr), \
+    _jsonLength(0)
 
 HADevice::HADevice() :
     _uniqueId(nullptr),
@@ -45,6 +49,35 @@ HADevice::~HADevice()
     if (_ownsUniqueId) {
         delete[] _uniqueId;
     }
+
+    if (_json) {
+        delete[] _json;
+    }
+}
+
+const uint8_t* HADevice::getJson(uint16_t& length) const
+{
+    if (!_jsonCacheEnabled) {
+        return nullptr;
+    }
+
+    if (_jsonDirty) {
+        if (_json) {
+            delete[] _json;
+            _json = nullptr;
+        }
+
+        _json = new uint8_t[_serializer->calculateSize()];
+        _jsonLength = _serializer->render(_json);
+        _jsonDirty = (_jsonLength == 0); // try again next time
+    }
+
+    if (_jsonLength == 0) {
+        return nullptr;
+    }
+
+    length = _jsonLength;
+    return _json;
 }
 
 bool HADevice::setUniqueId(const byte* uniqueId, const uint16_t length)
@@ -56,22 +89,26 @@ bool HADevice::setUniqueId(const byte* uniqueId, const uint16_t length)
     _uniqueId = HAUtils::byteArrayToStr(uniqueId, length);
     _ownsUniqueId = true;
     _serializer->set(AHATOFSTR(HADeviceIdentifiersProperty), _uniqueId);
+    invalidateJson();
     return true;
 }
 
 void HADevice::setManufacturer(const char* manufacturer)
 {
     _serializer->set(AHATOFSTR(HADeviceManufacturerProperty), manufacturer);
+    invalidateJson();
 }
 
 void HADevice::setModel(const char* model)
 {
     _serializer->set(AHATOFSTR(HADeviceModelProperty), model);
+    invalidateJson();
 }
 
 void HADevice::setName(const char* name)
 {
     _serializer->set(AHATOFSTR(HANameProperty), name);
+    invalidateJson();
 }
 
 void HADevice::setSoftwareVersion(const char* softwareVersion)
@@ -80,6 +117,7 @@ void HADevice::setSoftwareVersion(const char* softwareVersion)
         AHATOFSTR(HADeviceSoftwareVersionProperty),
         softwareVersion
     );
+    invalidateJson();
 }
 
 void HADevice::setConfigurationUrl(const char* url)
@@ -88,6 +126,7 @@ void HADevice::setConfigurationUrl(const char* url)
         AHATOFSTR(HADeviceConfigurationUrlProperty),
         url
     );
+    invalidateJson();
 }
 
 void HADevice::setAvailability(bool online)
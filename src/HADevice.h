@@ -88,6 +88,25 @@ public:
     inline void enableExtendedUniqueIds()
         { _extendedUniqueIds = true; }
 
+    /**
+     * Enables the cache of the device's JSON representation.
+     * The JSON is rendered once (when it's needed for the first time) and then it's reused by all entities.
+     * It's rendered again only after the device's properties change.
+     *
+     * @note The cache uses as much RAM as the length of the rendered JSON.
+     */
+    inline void enableJsonCache()
+        { _jsonCacheEnabled = true; _jsonDirty = true; }
+
+    /**
+     * Returns the cached JSON representation of the device (it's not null terminated).
+     * The JSON is rendered if the device's properties have changed since the last call.
+     *
+     * @param length Length of the JSON (output).
+     * @returns Pointer to the JSON or nullptr if the cache is disabled or the JSON couldn't be rendered.
+     */
+    const uint8_t* getJson(uint16_t& length) const;
+
     /**
      * Sets unique ID of the device based on the given byte array.
      * Each byte is converted to its hexadecimal string representation, so the final length of the unique ID will be twice the original number of bytes.
@@ -166,6 +185,13 @@ public:
     void publishAvailability() const;
 
 private:
+    /**
+     * Marks the cached JSON as outdated.
+     * It's called each time the device's properties change.
+     */
+    inline void invalidateJson()
+        { _jsonDirty = true; }
+
     /// The unique ID of the device. It can be a memory allocated by HADevice::setUniqueId method.
     const char* _uniqueId;
 
@@ -186,6 +212,18 @@ private:
 
     /// Specifies whether extended unique IDs feature is enabled.
     bool _extendedUniqueIds;
+
+    /// Specifies whether the cache of the JSON representation is enabled.
+    bool _jsonCacheEnabled;
+
+    /// Specifies whether the cached JSON needs to be rendered again.
+    mutable bool _jsonDirty;
+
+    /// The cached JSON representation of the device. It's allocated by HADevice::getJson method.
+    mutable uint8_t* _json;
+
+    /// Length of the cached JSON.
+    mutable uint16_t _jsonLength;
 };
 
 #endif
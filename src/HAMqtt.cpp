@@ -1,12 +1,55 @@
 #include "HAMqtt.h"
 
 #ifndef ARDUINOHA_TEST
+#ifdef ARDUINOHA_NATIVE_MQTT
+#include "HAMqttClient.h"
+#else
 #include <PubSubClient.h>
 #endif
+#endif
 
 #include "HADevice.h"
 #include "device-types/HABaseDeviceType.h"
 #include "mocks/PubSubClientMock.h"
+#include "utils/HADictionary.h"
+#include "utils/HASerializer.h"
+#include "utils/HAUtils.h"
+#include "utils/HAPublishQueue.h"
+#include "utils/HASubscriptionBatch.h"
+#include "utils/HATopicCache.h"
+
+#ifdef ARDUINOHA_TOPIC_CACHE
+#define HAMQTT_INIT_TOPIC_CACHE \
+    _topicCache(nullptr),
+#else
+#define HAMQTT_INIT_TOPIC_CACHE
+#endif
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+#define HAMQTT_INIT_SUBSCRIPTION_BATCH \
+    _subscriptionBatch(nullptr), \
+    _subscriptionsBatched(false), \
+    _subscriptionPacketId(0),
+#else
+#define HAMQTT_INIT_SUBSCRIPTION_BATCH
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+#define HAMQTT_INIT_PUBLISH_QUEUE \
+    _publishQueue(nullptr), \
+    _publishQueueDrainInterval(0), \
+    _publishQueueDrainLimit(0), \
+    _publishQueueDrainedAt(0),
+#else
+#define HAMQTT_INIT_PUBLISH_QUEUE
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+#define HAMQTT_INIT_PUBLISH_SCHEDULER \
+    _publishScheduler(nullptr),
+#else
+#define HAMQTT_INIT_PUBLISH_SCHEDULER
+#endif
 
 #define HAMQTT_INIT \
     _device(device), \
@@ -17,22 +60,85 @@
     _initialized(false), \
     _discoveryPrefix(DefaultDiscoveryPrefix), \
     _dataPrefix(DefaultDataPrefix), \
+    _topicAbbreviation(false), \
+    _deviceDiscovery(false), \
+    _discoveryOnBirthMessage(false), \
+    _configPublished(false), \
+    _configSuppressed(false), \
+    _persistentSession(false), \
+    _wildcardSubscription(false), \
+    _resubscriptionSuppressed(false), \
     _username(nullptr), \
     _password(nullptr), \
     _lastConnectionAttemptAt(0), \
+    _reconnectMinDelay(ReconnectInterval), \
+    _reconnectMaxDelay(ReconnectInterval), \
+    _reconnectMultiplier(1), \
+    _reconnectJitter(0), \
+    _reconnectBaseDelay(0), \
+    _reconnectDelay(0), \
+    _connectionAttemptsNb(0), \
+    _randomState(0), \
+    _dirtyDevicesTypes(nullptr), \
+    _statesPublished(false), \
+    _statePublishingSuppressed(false), \
+    _stateRestoreWindow(0), \
+    _stateRestoreActive(false), \
+    _stateRestoreDone(false), \
+    _stateRestoreStartedAt(0), \
+    _configStorage(nullptr), \
+    _configPublishingForced(false), \
+    _skippedConfigsNb(0), \
+    _pacedDiscovery(false), \
+    _discoveryEntitiesLimit(0), \
+    _discoveryBytesLimit(0), \
+    _discoveryTimeLimit(0), \
+    _discoveryPending(false), \
+    _discoveryIndex(0), \
+    _singleShot(false), \
+    _singleShotDiscovery(false), \
+    _subscriptionSuppressed(false), \
+    _publishedBytesNb(0), \
+    _serverHostname(nullptr), \
+    _serverPort(0), \
+    _phasedConnection(false), \
+    _connectionPhase(ConnectionPhaseIdle), \
+    _connectionFailed(false), \
     _devicesTypesNb(0), \
     _maxDevicesTypesNb(maxDevicesTypesNb), \
     _devicesTypes(new HABaseDeviceType*[maxDevicesTypesNb]), \
+    _devicesTypesIndexSize(calculateIndexSize(maxDevicesTypesNb)), \
+    _devicesTypesIndex(new uint8_t[_devicesTypesIndexSize]()), \
     _lastWillTopic(nullptr), \
     _lastWillMessage(nullptr), \
     _lastWillRetain(false), \
-    _currentState(StateDisconnected)
+    _currentState(StateDisconnected), \
+    HAMQTT_INIT_TOPIC_CACHE \
+    HAMQTT_INIT_PUBLISH_QUEUE \
+    HAMQTT_INIT_PUBLISH_SCHEDULER \
+    HAMQTT_INIT_SUBSCRIPTION_BATCH \
+    _payloadBuffer(nullptr), \
+    _payloadBufferSize(0), \
+    _payloadBufferLength(0), \
+    _payloadFragmentsNb(0), \
+    _payloadWritesNb(0)
 
 static const char* DefaultDiscoveryPrefix = "homeassistant";
 static const char* DefaultDataPrefix = "aha";
 
 HAMqtt* HAMqtt::_instance = nullptr;
 
+static uint16_t calculateIndexSize(uint8_t maxDevicesTypesNb)
+{
+    // the index is kept at most half full to keep the probing sequences short
+    uint16_t size = 2;
+    while (size < maxDevicesTypesNb * 2) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
 void onMessageReceived(char* topic, uint8_t* payload, unsigned int length)
 {
     if (HAMqtt::instance() == nullptr || length > UINT16_MAX) {
@@ -59,7 +165,12 @@ HAMqtt::HAMqtt(
     HADevice& device,
     uint8_t maxDevicesTypesNb
 ) :
+#ifdef ARDUINOHA_NATIVE_MQTT
+    _mqtt(new HAMqttClient(netClient)),
+#else
     _mqtt(new PubSubClient(netClient)),
+#endif
+    _netClient(&netClient),
     HAMQTT_INIT
 {
     _instance = this;
@@ -69,6 +180,24 @@ HAMqtt::HAMqtt(
 HAMqtt::~HAMqtt()
 {
     delete[] _devicesTypes;
+    delete[] _devicesTypesIndex;
+    delete[] _dirtyDevicesTypes;
+#ifdef ARDUINOHA_TOPIC_CACHE
+    disableTopicCache();
+#endif
+    disablePayloadBuffer();
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+    disablePublishQueue();
+#endif
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    disableSubscriptionBatching();
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    if (_publishScheduler) {
+        delete _publishScheduler;
+    }
+#endif
 
     if (_mqtt) {
         delete _mqtt;
@@ -77,6 +206,17 @@ HAMqtt::~HAMqtt()
     _instance = nullptr;
 }
 
+void HAMqtt::setDataPrefix(const char* prefix)
+{
+    _dataPrefix = prefix;
+
+#ifdef ARDUINOHA_TOPIC_CACHE
+    if (_topicCache) {
+        _topicCache->clear(); // cached topics contain the previous prefix
+    }
+#endif
+}
+
 bool HAMqtt::begin(
     const IPAddress serverIp,
     const uint16_t serverPort,
@@ -102,6 +242,8 @@ bool HAMqtt::begin(
     _username = username;
     _password = password;
     _initialized = true;
+    _serverIp = serverIp;
+    _serverPort = serverPort;
 
     _mqtt->setServer(serverIp, serverPort);
     _mqtt->setCallback(onMessageReceived);
@@ -143,6 +285,8 @@ bool HAMqtt::begin(
     _username = username;
     _password = password;
     _initialized = true;
+    _serverHostname = serverHostname;
+    _serverPort = serverPort;
 
     _mqtt->setServer(serverHostname, serverPort);
     _mqtt->setCallback(onMessageReceived);
@@ -169,6 +313,12 @@ bool HAMqtt::disconnect()
 
     _initialized = false;
     _lastConnectionAttemptAt = 0;
+    _reconnectBaseDelay = 0;
+    _reconnectDelay = 0;
+    _connectionAttemptsNb = 0;
+    _connectionPhase = ConnectionPhaseIdle;
+    _connectionFailed = false;
+    finishDiscovery();
     _mqtt->disconnect();
 
     return true;
@@ -181,179 +331,1450 @@ void HAMqtt::loop()
     }
 
     bool result = _mqtt->loop();
-    if (_currentState != _mqtt->state()) {
+    if (
+        _connectionPhase == ConnectionPhaseIdle &&
+        !_connectionFailed &&
+        _currentState != _mqtt->state()
+    ) {
         setState(static_cast<ConnectionState>(_mqtt->state()));
     }
 
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    if (_publishScheduler) {
+        processPublishScheduler();
+    }
+#endif
+
     if (!result) {
         connectToServer();
+    } else {
+        if (_discoveryPending) {
+            processDiscovery();
+        }
+
+        if (
+            _stateRestoreActive &&
+            (millis() - _stateRestoreStartedAt) >= _stateRestoreWindow
+        ) {
+            finishStateRestore();
+        }
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+        if (_publishQueue) {
+            drainPublishQueue();
+        }
+#endif
     }
 }
 
-bool HAMqtt::isConnected() const
+bool HAMqtt::publishAndDisconnect(
+    const uint32_t timeout,
+    const bool discovery,
+    SingleShotReport* report
+)
 {
-    return _mqtt->connected();
+    if (!_initialized) {
+        return false;
+    }
+
+    SingleShotReport phases;
+    const uint32_t startedAt = millis();
+    uint32_t phaseStartedAt = startedAt;
+    _singleShot = true;
+    _singleShotDiscovery = discovery;
+
+    // the device wakes up from the deep sleep, so the reconnect delay doesn't apply to the first attempt
+    _lastConnectionAttemptAt = 0;
+    _connectionPhase = ConnectionPhaseIdle;
+
+    while (!isConnected() && (millis() - startedAt) < timeout) {
+        connectToServer();
+
+        if (!isConnected() && _connectionPhase == ConnectionPhaseIdle) {
+            _lastConnectionAttemptAt = 0;
+            delay(1); // gives the network stack time to process the failure
+        }
+    }
+
+    phases.connectTime = millis() - phaseStartedAt;
+    phaseStartedAt = millis();
+
+    if (isConnected()) {
+        // the discovery is started by HAMqtt::onConnectedLogic
+        while (
+            _discoveryPending &&
+            isConnected() &&
+            (millis() - startedAt) < timeout
+        ) {
+            processDiscovery();
+        }
+
+        phases.discoveryTime = millis() - phaseStartedAt;
+        phaseStartedAt = millis();
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+        if (_publishQueue && isConnected()) {
+            const uint8_t drainLimit = _publishQueueDrainLimit;
+            _publishQueueDrainLimit = 0;
+            _publishQueueDrainedAt = 0;
+            drainPublishQueue();
+            _publishQueueDrainLimit = drainLimit;
+        }
+#endif
+
+        _mqtt->loop();
+#ifndef ARDUINOHA_TEST
+        _netClient->flush();
+#endif
+
+        phases.flushTime = millis() - phaseStartedAt;
+        phaseStartedAt = millis();
+    }
+
+    const bool result = isConnected() && !_discoveryPending && (millis() - startedAt) < timeout;
+
+    _connectionPhase = ConnectionPhaseIdle;
+    _mqtt->disconnect();
+    setState(StateDisconnected);
+
+    phases.disconnectTime = millis() - phaseStartedAt;
+    _singleShot = false;
+
+    if (report) {
+        *report = phases;
+    }
+
+    return result;
 }
 
-void HAMqtt::setKeepAlive(uint16_t keepAlive)
+bool HAMqtt::isConnected() const
 {
-    _mqtt->setKeepAlive(keepAlive);
+    return _mqtt->connected();
 }
 
-bool HAMqtt::setBufferSize(uint16_t size)
+void HAMqtt::setConnectionTimeouts(
+    const uint32_t networkTimeout,
+    const uint32_t connackTimeout
+)
 {
-    return _mqtt->setBufferSize(size);
+    if (networkTimeout > 0) {
+#ifdef ARDUINOHA_TEST
+        _mqtt->setNetworkTimeout(networkTimeout);
+#else
+        _netClient->setTimeout(networkTimeout);
+#endif
+    }
+
+    if (connackTimeout > 0) {
+        // PubSubClient's timeout is expressed in seconds
+        const uint32_t seconds = (connackTimeout + 999) / 1000;
+        _mqtt->setSocketTimeout(seconds > UINT16_MAX ? UINT16_MAX : seconds);
+    }
 }
 
-void HAMqtt::addDeviceType(HABaseDeviceType* deviceType)
+void HAMqtt::enableOfflineBuffering()
 {
-    if (_devicesTypesNb + 1 > _maxDevicesTypesNb) {
+    if (_dirtyDevicesTypes) {
         return;
     }
 
-    _devicesTypes[_devicesTypesNb++] = deviceType;
+    _dirtyDevicesTypes = new uint8_t[(_maxDevicesTypesNb + 7) / 8]();
 }
 
-bool HAMqtt::publish(const char* topic, const char* payload, bool retained)
+void HAMqtt::enableStateRestore(const uint16_t window)
 {
-    if (!isConnected()) {
+    _stateRestoreWindow = window;
+}
+
+bool HAMqtt::markStateDirty(const HABaseDeviceType* deviceType)
+{
+    if (!_dirtyDevicesTypes) {
         return false;
     }
 
-    ARDUINOHA_DEBUG_PRINT(F("AHA: publishing "))
-    ARDUINOHA_DEBUG_PRINT(topic)
-    ARDUINOHA_DEBUG_PRINT(F(", len: "))
-    ARDUINOHA_DEBUG_PRINTLN(strlen(payload))
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        if (_devicesTypes[i] == deviceType) {
+            _dirtyDevicesTypes[i / 8] |= (1 << (i % 8));
+            return true;
+        }
+    }
 
-    _mqtt->beginPublish(topic, strlen(payload), retained);
-    _mqtt->write((const uint8_t*)(payload), strlen(payload));
-    return _mqtt->endPublish();
+    return false;
 }
 
-bool HAMqtt::beginPublish(
-    const char* topic,
-    uint16_t payloadLength,
-    bool retained
-)
+uint8_t HAMqtt::getDirtyDevicesTypesNb() const
 {
-    ARDUINOHA_DEBUG_PRINT(F("AHA: begin publish "))
-    ARDUINOHA_DEBUG_PRINT(topic)
-    ARDUINOHA_DEBUG_PRINT(F(", len: "))
-    ARDUINOHA_DEBUG_PRINTLN(payloadLength)
+    if (!_dirtyDevicesTypes) {
+        return 0;
+    }
 
-    return _mqtt->beginPublish(topic, payloadLength, retained);
+    uint8_t dirtyNb = 0;
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        if (_dirtyDevicesTypes[i / 8] & (1 << (i % 8))) {
+            dirtyNb++;
+        }
+    }
+
+    return dirtyNb;
 }
 
-void HAMqtt::writePayload(const char* data, const uint16_t length)
+void HAMqtt::enablePacedDiscovery(
+    const uint8_t entitiesLimit,
+    const uint16_t bytesLimit,
+    const uint32_t timeLimit
+)
 {
-    writePayload(reinterpret_cast<const uint8_t*>(data), length);
+    _pacedDiscovery = true;
+    _discoveryEntitiesLimit = entitiesLimit;
+    _discoveryBytesLimit = bytesLimit;
+    _discoveryTimeLimit = timeLimit;
 }
 
-void HAMqtt::writePayload(const uint8_t* data, const uint16_t length)
+void HAMqtt::setReconnectPolicy(
+    const uint32_t minDelay,
+    const uint32_t maxDelay,
+    const uint8_t multiplier,
+    const uint8_t jitter
+)
 {
-    _mqtt->write(data, length);
+    _reconnectMinDelay = minDelay;
+    _reconnectMaxDelay = maxDelay < minDelay ? minDelay : maxDelay;
+    _reconnectMultiplier = multiplier > 0 ? multiplier : 1;
+    _reconnectJitter = jitter > 100 ? 100 : jitter;
 }
 
-void HAMqtt::writePayload(const __FlashStringHelper* src)
+bool HAMqtt::isSessionPresent() const
 {
-    _mqtt->print(src);
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    return _mqtt->isSessionPresent();
+#else
+    return false; // PubSubClient doesn't expose the session present flag of the CONNACK packet
+#endif
 }
 
-bool HAMqtt::endPublish()
+void HAMqtt::setKeepAlive(uint16_t keepAlive)
 {
-    return _mqtt->endPublish();
+    _mqtt->setKeepAlive(keepAlive);
 }
 
-bool HAMqtt::subscribe(const char* topic)
+bool HAMqtt::setBufferSize(uint16_t size)
 {
-    ARDUINOHA_DEBUG_PRINT(F("AHA: subscribing "))
-    ARDUINOHA_DEBUG_PRINTLN(topic)
+    return _mqtt->setBufferSize(size);
+}
 
-    return _mqtt->subscribe(topic);
+#ifdef ARDUINOHA_TOPIC_CACHE
+bool HAMqtt::enableTopicCache(
+    const uint16_t arenaSize,
+    const uint8_t maxTopicsNb
+)
+{
+    disableTopicCache();
+
+    if (arenaSize == 0 || maxTopicsNb == 0) {
+        return false;
+    }
+
+    _topicCache = new HATopicCache(arenaSize, maxTopicsNb);
+    return true;
 }
 
-void HAMqtt::processMessage(const char* topic, const uint8_t* payload, uint16_t length)
+void HAMqtt::disableTopicCache()
 {
-    ARDUINOHA_DEBUG_PRINT(F("AHA: received call "))
-    ARDUINOHA_DEBUG_PRINT(topic)
-    ARDUINOHA_DEBUG_PRINT(F(", len: "))
-    ARDUINOHA_DEBUG_PRINTLN(length)
+    if (_topicCache) {
+        delete _topicCache;
+        _topicCache = nullptr;
+    }
+}
+#endif
 
-    if (_messageCallback) {
-        _messageCallback(topic, payload, length);
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+bool HAMqtt::enablePublishQueue(
+    const uint8_t maxMessagesNb,
+    const uint16_t maxPayloadSize,
+    const uint16_t drainInterval,
+    const uint8_t drainLimit
+)
+{
+    disablePublishQueue();
+
+    if (maxMessagesNb == 0 || maxPayloadSize == 0) {
+        return false;
     }
 
-    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
-        _devicesTypes[i]->onMqttMessage(topic, payload, length);
+    _publishQueue = new HAPublishQueue(maxMessagesNb, maxPayloadSize);
+    _publishQueueDrainInterval = drainInterval;
+    _publishQueueDrainLimit = drainLimit;
+    _publishQueueDrainedAt = 0;
+    return true;
+}
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+bool HAMqtt::enablePublishScheduler(
+    const uint16_t resolution,
+    const uint8_t slotsNb
+)
+{
+    if (_publishScheduler) {
+        return false; // policies of device types are linked into the existing wheel
     }
+
+    _publishScheduler = new HATimerWheel(resolution, slotsNb, millis());
+    return true;
 }
 
-void HAMqtt::connectToServer()
+void HAMqtt::schedulePublish(
+    HATimerWheel::Timer* timer,
+    const uint32_t deadline
+)
 {
-    if (_lastConnectionAttemptAt > 0 &&
-            (millis() - _lastConnectionAttemptAt) < ReconnectInterval) {
-        return;
+    if (!_publishScheduler) {
+        enablePublishScheduler();
     }
 
-    _lastConnectionAttemptAt = millis();
-    setState(StateConnecting);
+    _publishScheduler->schedule(timer, deadline);
+}
+
+void HAMqtt::cancelPublish(HATimerWheel::Timer* timer)
+{
+    if (_publishScheduler) {
+        _publishScheduler->cancel(timer);
+    }
+}
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+void HAMqtt::disablePublishQueue()
+{
+    if (_publishQueue) {
+        delete _publishQueue;
+        _publishQueue = nullptr;
+    }
+}
 
-    ARDUINOHA_DEBUG_PRINT(F("AHA: MQTT connecting, client ID: "))
-    ARDUINOHA_DEBUG_PRINTLN(_device.getUniqueId())
+bool HAMqtt::queueDataMessage(
+    const char* objectId,
+    const __FlashStringHelper* topic,
+    const uint8_t* payload,
+    const uint16_t length,
+    const bool retained,
+    const bool isProgmemData,
+    const uint8_t qos
+)
+{
+    if (!_publishQueue) {
+        return false;
+    }
 
-    _mqtt->connect(
-        _device.getUniqueId(),
-        _username,
-        _password,
-        _lastWillTopic,
-        0,
-        _lastWillRetain,
-        _lastWillMessage,
-        true
+    return _publishQueue->push(
+        objectId,
+        topic,
+        payload,
+        length,
+        retained,
+        isProgmemData,
+        qos
     );
+}
+#endif
 
-    if (isConnected()) {
-        setState(StateConnected);
-    } else {
-        ARDUINOHA_DEBUG_PRINTLN(F("AHA: failed to connect"))
+#ifdef ARDUINOHA_TOPIC_CACHE
+const char* HAMqtt::getCachedDataTopic(
+    const char* objectId,
+    const __FlashStringHelper* topic,
+    uint16_t& length
+) const
+{
+    if (!_topicCache) {
+        return nullptr;
     }
+
+    return _topicCache->get(objectId, topic, length);
 }
+#endif
 
-void HAMqtt::onConnectedLogic()
+bool HAMqtt::enableQos1Publishing(
+    const uint8_t windowSize,
+    const uint16_t maxPacketSize,
+    const uint16_t retryInterval,
+    const uint8_t maxRetries
+)
 {
-    if (_connectedCallback) {
-        _connectedCallback();
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    return _mqtt->setInflightWindow(windowSize, maxPacketSize, retryInterval, maxRetries);
+#else
+    (void)windowSize;
+    (void)maxPacketSize;
+    (void)retryInterval;
+    (void)maxRetries;
+
+    return false; // PubSubClient publishes messages with QoS 0 only
+#endif
+}
+
+uint8_t HAMqtt::getInflightMessagesNb() const
+{
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    return _mqtt->getInflightMessagesNb();
+#else
+    return 0;
+#endif
+}
+
+uint32_t HAMqtt::getRetriedMessagesNb() const
+{
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    return _mqtt->getRetriedMessagesNb();
+#else
+    return 0;
+#endif
+}
+
+uint32_t HAMqtt::getDroppedMessagesNb() const
+{
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    return _mqtt->getDroppedMessagesNb();
+#else
+    return 0;
+#endif
+}
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+bool HAMqtt::enableSubscriptionBatching(const uint16_t maxPacketSize)
+{
+    disableSubscriptionBatching();
+
+    if (maxPacketSize == 0) {
+        return false;
     }
 
-    _device.publishAvailability();
+    _subscriptionBatch = new HASubscriptionBatch(maxPacketSize);
+    return true;
+}
 
-    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
-        _devicesTypes[i]->onMqttConnected();
+void HAMqtt::disableSubscriptionBatching()
+{
+    if (_subscriptionBatch) {
+        delete _subscriptionBatch;
+        _subscriptionBatch = nullptr;
     }
+
+    _subscriptionsBatched = false;
 }
+#endif
 
-void HAMqtt::setState(ConnectionState state)
+bool HAMqtt::enablePayloadBuffer(const uint16_t size)
 {
-    ConnectionState previousState = _currentState;
-    _currentState = state;
+    disablePayloadBuffer();
 
-    ARDUINOHA_DEBUG_PRINT(F("AHA: MQTT state changed to "))
-    ARDUINOHA_DEBUG_PRINT(_currentState)
-    ARDUINOHA_DEBUG_PRINT(F(", previous state: "))
-    ARDUINOHA_DEBUG_PRINTLN(previousState)
+    if (size == 0) {
+        return false;
+    }
 
-    if (_currentState == StateConnected) {
-        ARDUINOHA_DEBUG_PRINTLN(F("AHA: MQTT connected"))
-        onConnectedLogic();
-    } else if (previousState == StateConnected && _currentState != StateConnected) {
-        ARDUINOHA_DEBUG_PRINTLN(F("AHA: MQTT disconnected"))
+    _payloadBuffer = new uint8_t[size];
+    _payloadBufferSize = size;
+    return true;
+}
 
-        if (_disconnectedCallback) {
-            _disconnectedCallback();
-        }
+void HAMqtt::disablePayloadBuffer()
+{
+    if (_payloadBuffer) {
+        delete[] _payloadBuffer;
+        _payloadBuffer = nullptr;
     }
 
-    if (_stateChangedCallback) {
-        _stateChangedCallback(_currentState);
+    _payloadBufferSize = 0;
+    _payloadBufferLength = 0;
+}
+
+void HAMqtt::addDeviceType(HABaseDeviceType* deviceType)
+{
+    if (_devicesTypesNb + 1 > _maxDevicesTypesNb) {
+        return;
     }
-}
\ No newline at end of file
+
+    _devicesTypes[_devicesTypesNb] = deviceType;
+    indexDeviceType(_devicesTypesNb++);
+}
+
+bool HAMqtt::publish(
+    const char* topic,
+    const char* payload,
+    bool retained,
+    uint8_t qos
+)
+{
+    if (!isConnected()) {
+        return false;
+    }
+
+    ARDUINOHA_DEBUG_PRINT(F("AHA: publishing "))
+    ARDUINOHA_DEBUG_PRINT(topic)
+    ARDUINOHA_DEBUG_PRINT(F(", len: "))
+    ARDUINOHA_DEBUG_PRINTLN(strlen(payload))
+
+    if (!beginPublish(topic, strlen(payload), retained, qos)) {
+        return false;
+    }
+
+    _mqtt->write((const uint8_t*)(payload), strlen(payload));
+    return _mqtt->endPublish();
+}
+
+bool HAMqtt::beginPublish(
+    const char* topic,
+    uint32_t payloadLength,
+    bool retained,
+    uint8_t qos
+)
+{
+    ARDUINOHA_DEBUG_PRINT(F("AHA: begin publish "))
+    ARDUINOHA_DEBUG_PRINT(topic)
+    ARDUINOHA_DEBUG_PRINT(F(", len: "))
+    ARDUINOHA_DEBUG_PRINTLN(payloadLength)
+
+    const uint32_t topicLength = strlen(topic);
+    _payloadBufferLength = 0; // leftovers of the aborted message
+
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    _publishedBytesNb += topicLength + payloadLength;
+    return _mqtt->beginPublish(topic, payloadLength, retained, qos);
+#else
+    (void)qos; // PubSubClient publishes messages with QoS 0 only
+
+    // PubSubClient encodes the remaining length of the packet on 16 bits
+    if (2 + topicLength + payloadLength > 0xFFFF) {
+        return false;
+    }
+
+    _publishedBytesNb += topicLength + payloadLength;
+    return _mqtt->beginPublish(topic, payloadLength, retained);
+#endif
+}
+
+void HAMqtt::writePayload(const char* data, const uint32_t length)
+{
+    writePayload(reinterpret_cast<const uint8_t*>(data), length);
+}
+
+void HAMqtt::writePayload(const uint8_t* data, const uint32_t length)
+{
+    if (_payloadBuffer) {
+        bufferPayload(data, length, false);
+    } else {
+        _mqtt->write(data, length);
+    }
+}
+
+void HAMqtt::writePayload(const __FlashStringHelper* src)
+{
+    if (_payloadBuffer) {
+        bufferPayload(
+            reinterpret_cast<const uint8_t*>(src),
+            strlen_P(AHAFROMFSTR(src)),
+            true
+        );
+    } else {
+        _mqtt->print(src);
+    }
+}
+
+bool HAMqtt::endPublish()
+{
+    flushPayloadBuffer();
+    return _mqtt->endPublish();
+}
+
+bool HAMqtt::subscribe(const char* topic)
+{
+    ARDUINOHA_DEBUG_PRINT(F("AHA: subscribing "))
+    ARDUINOHA_DEBUG_PRINTLN(topic)
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    if (_subscriptionsBatched) {
+        if (_subscriptionBatch->add(topic)) {
+            return true;
+        }
+
+        // the packet is full, so it's sent and the topic is added to the next one
+        flushSubscriptionBatch();
+        beginSubscriptionBatch();
+
+        if (_subscriptionBatch->add(topic)) {
+            return true;
+        }
+    }
+#endif
+
+    return _mqtt->subscribe(topic);
+}
+
+bool HAMqtt::unsubscribe(const char* topic)
+{
+    ARDUINOHA_DEBUG_PRINT(F("AHA: unsubscribing "))
+    ARDUINOHA_DEBUG_PRINTLN(topic)
+
+    return _mqtt->unsubscribe(topic);
+}
+
+void HAMqtt::processMessage(const char* topic, const uint8_t* payload, uint16_t length)
+{
+    ARDUINOHA_DEBUG_PRINT(F("AHA: received call "))
+    ARDUINOHA_DEBUG_PRINT(topic)
+    ARDUINOHA_DEBUG_PRINT(F(", len: "))
+    ARDUINOHA_DEBUG_PRINTLN(length)
+
+    if (_messageCallback) {
+        _messageCallback(topic, payload, length);
+    }
+
+    if (_discoveryOnBirthMessage && isBirthMessage(topic, payload, length)) {
+        ARDUINOHA_DEBUG_PRINTLN(F("AHA: Home Assistant is online"))
+        publishConfigs();
+        return;
+    }
+
+    uint16_t objectIdLength = 0;
+    const char* objectId = parseObjectId(topic, objectIdLength);
+    if (objectId && dispatchMessage(
+        objectId,
+        objectIdLength,
+        topic,
+        payload,
+        length
+    )) {
+        return;
+    }
+
+    // the message doesn't belong to any indexed device type
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        _devicesTypes[i]->onMqttMessage(topic, payload, length);
+    }
+}
+
+void HAMqtt::connectToServer()
+{
+    if (_connectionPhase == ConnectionPhaseIdle) {
+        if (_lastConnectionAttemptAt > 0 &&
+                (millis() - _lastConnectionAttemptAt) < _reconnectDelay) {
+            return;
+        }
+
+        _lastConnectionAttemptAt = millis();
+        _connectionAttemptsNb++;
+        _connectionFailed = false;
+        setState(StateConnecting);
+
+        ARDUINOHA_DEBUG_PRINT(F("AHA: MQTT connecting, client ID: "))
+        ARDUINOHA_DEBUG_PRINTLN(_device.getUniqueId())
+
+        // without the phased connection PubSubClient opens the network connection on its own
+        if (_phasedConnection) {
+            _connectionPhase = ConnectionPhaseNetwork;
+        } else {
+            _connectionPhase = ConnectionPhaseConnect;
+        }
+    }
+
+    if (_connectionPhase == ConnectionPhaseNetwork) {
+        if (!connectNetwork()) {
+            ARDUINOHA_DEBUG_PRINTLN(F("AHA: failed to open network connection"))
+
+            // the MQTT client isn't aware of the failure, so its state can't override it
+            _connectionPhase = ConnectionPhaseIdle;
+            _connectionFailed = true;
+            scheduleReconnect();
+            setState(StateConnectionFailed);
+            return;
+        }
+
+        // the CONNECT packet is sent in the next loop
+        _connectionPhase = ConnectionPhaseConnect;
+        return;
+    }
+
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    if (_phasedConnection && _connectionPhase == ConnectionPhaseConnect) {
+        const bool started = _mqtt->beginConnect(
+            _device.getUniqueId(),
+            _username,
+            _password,
+            _lastWillTopic,
+            0,
+            _lastWillRetain,
+            _lastWillMessage,
+            !_persistentSession
+        );
+
+        if (started && _mqtt->isConnecting()) {
+            // the CONNACK packet is awaited in the next loops
+            _connectionPhase = ConnectionPhaseConnack;
+            return;
+        }
+
+        _connectionPhase = ConnectionPhaseIdle;
+    } else if (_connectionPhase == ConnectionPhaseConnack) {
+        _mqtt->pollConnack();
+        if (_mqtt->isConnecting()) {
+            return;
+        }
+
+        _connectionPhase = ConnectionPhaseIdle;
+    }
+#endif
+
+    if (_connectionPhase == ConnectionPhaseConnect) {
+        _connectionPhase = ConnectionPhaseIdle;
+        _mqtt->connect(
+            _device.getUniqueId(),
+            _username,
+            _password,
+            _lastWillTopic,
+            0,
+            _lastWillRetain,
+            _lastWillMessage,
+            !_persistentSession
+        );
+    }
+
+    if (isConnected()) {
+        _reconnectBaseDelay = 0;
+        _reconnectDelay = 0;
+        setState(StateConnected);
+        _connectionAttemptsNb = 0;
+    } else {
+        ARDUINOHA_DEBUG_PRINTLN(F("AHA: failed to connect"))
+        scheduleReconnect();
+    }
+}
+
+void HAMqtt::scheduleReconnect()
+{
+    if (_reconnectBaseDelay == 0) {
+        _reconnectBaseDelay = _reconnectMinDelay;
+    } else if (_reconnectBaseDelay > _reconnectMaxDelay / _reconnectMultiplier) {
+        _reconnectBaseDelay = _reconnectMaxDelay;
+    } else {
+        _reconnectBaseDelay *= _reconnectMultiplier;
+    }
+
+    _reconnectDelay = _reconnectBaseDelay - nextRandom(
+        (_reconnectBaseDelay / 100) * _reconnectJitter
+    );
+
+    ARDUINOHA_DEBUG_PRINT(F("AHA: next connection attempt in "))
+    ARDUINOHA_DEBUG_PRINTLN(_reconnectDelay)
+}
+
+uint32_t HAMqtt::nextRandom(const uint32_t max)
+{
+    if (max == 0) {
+        return 0;
+    }
+
+    if (_randomState == 0) {
+        const char* uniqueId = _device.getUniqueId();
+        _randomState = HAUtils::hash(
+            uniqueId,
+            uniqueId ? strlen(uniqueId) : 0
+        );
+
+        if (_randomState == 0) {
+            _randomState = 1;
+        }
+    }
+
+    // xorshift32
+    _randomState ^= _randomState << 13;
+    _randomState ^= _randomState >> 17;
+    _randomState ^= _randomState << 5;
+
+    return _randomState % (max + 1);
+}
+
+bool HAMqtt::connectNetwork()
+{
+#ifdef ARDUINOHA_TEST
+    return _mqtt->connectNetwork();
+#else
+    if (_netClient->connected()) {
+        return true;
+    }
+
+    if (_serverHostname) {
+        return _netClient->connect(_serverHostname, _serverPort) == 1;
+    }
+
+    return _netClient->connect(_serverIp, _serverPort) == 1;
+#endif
+}
+
+void HAMqtt::onConnectedLogic()
+{
+    beginSubscriptionBatch();
+
+    if (_connectedCallback) {
+        _connectedCallback();
+    }
+
+    _device.publishAvailability();
+
+    // retained states are requested before the discovery, so they arrive as soon as possible
+    if (_stateRestoreWindow > 0 && !_stateRestoreDone && !_singleShot) {
+        _stateRestoreActive = true;
+        _stateRestoreStartedAt = millis();
+
+        for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+            _devicesTypes[i]->onStateRestore(true);
+        }
+    }
+
+    // the configuration is published again only when Home Assistant sends the birth message
+    _configSuppressed = _discoveryOnBirthMessage && _configPublished;
+
+    // the single shot may skip the discovery if the configuration is retained by the broker
+    if (_singleShot && !_singleShotDiscovery) {
+        _configSuppressed = true;
+    }
+
+    // the broker still holds subscriptions of the previous session
+    _resubscriptionSuppressed = _persistentSession && isSessionPresent();
+
+    if (_discoveryOnBirthMessage && !_resubscriptionSuppressed && !_singleShot) {
+        subscribeStatusTopic();
+    }
+
+    // device types skip their subscriptions and rely on the local dispatch of messages
+    if (
+        _wildcardSubscription &&
+        !_resubscriptionSuppressed &&
+        (!_singleShot || hasCommandCallbacks())
+    ) {
+        subscribeWildcardTopic();
+    }
+
+    if (_deviceDiscovery && !_configSuppressed) {
+        publishDeviceConfig();
+    }
+
+    // states of all device types are published on the first connection, so pending changes are outdated
+    _statePublishingSuppressed = _dirtyDevicesTypes && _statesPublished;
+    if (_dirtyDevicesTypes && !_statePublishingSuppressed) {
+        memset(_dirtyDevicesTypes, 0, (_maxDevicesTypesNb + 7) / 8);
+    }
+
+    _discoveryIndex = 0;
+    _discoveryPending = true;
+
+    // the paced discovery is continued in the next loop cycles, the single shot announces device types on its own
+    if (!_pacedDiscovery && !_singleShot) {
+        processDiscovery();
+    }
+
+    flushSubscriptionBatch();
+}
+
+void HAMqtt::processDiscovery()
+{
+    const uint32_t startedAt = micros();
+    const uint32_t publishedBytesNb = _publishedBytesNb;
+    uint8_t processedNb = 0;
+    beginSubscriptionBatch();
+
+    while (_discoveryIndex < _devicesTypesNb) {
+        HABaseDeviceType* deviceType = _devicesTypes[_discoveryIndex++];
+        _subscriptionSuppressed = _singleShot && !deviceType->hasCommandCallbacks();
+        deviceType->onMqttConnected();
+        processedNb++;
+
+        if (!_pacedDiscovery) {
+            continue;
+        }
+
+        if (
+            (_discoveryEntitiesLimit > 0 && processedNb >= _discoveryEntitiesLimit) ||
+            (_discoveryBytesLimit > 0 && (_publishedBytesNb - publishedBytesNb) >= _discoveryBytesLimit) ||
+            (_discoveryTimeLimit > 0 && (micros() - startedAt) >= _discoveryTimeLimit)
+        ) {
+            break;
+        }
+    }
+
+    _subscriptionSuppressed = false;
+    flushSubscriptionBatch();
+
+    if (_discoveryIndex >= _devicesTypesNb) {
+        _configPublished = true;
+        _statesPublished = true;
+        finishDiscovery();
+
+        if (_dirtyDevicesTypes) {
+            replayDirtyStates();
+        }
+    }
+}
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+void HAMqtt::processPublishScheduler()
+{
+    HATimerWheel::Timer* timer = nullptr;
+    while ((timer = _publishScheduler->poll(millis())) != nullptr) {
+        static_cast<HABaseDeviceType::PublishPolicy*>(timer)->deviceType->onPublishTimer();
+    }
+}
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+void HAMqtt::drainPublishQueue()
+{
+    if (
+        _publishQueue->getMessagesNb() == 0 ||
+        (_publishQueueDrainInterval > 0 && _publishQueueDrainedAt > 0 &&
+            (millis() - _publishQueueDrainedAt) < _publishQueueDrainInterval)
+    ) {
+        return;
+    }
+
+    _publishQueueDrainedAt = millis();
+    uint8_t publishedNb = 0;
+
+    while (_publishQueueDrainLimit == 0 || publishedNb < _publishQueueDrainLimit) {
+        const HAPublishQueue::Message* message = _publishQueue->front();
+        if (!message) {
+            return;
+        }
+
+        uint16_t topicLength = 0;
+        const char* cachedTopic = getCachedDataTopic(
+            message->objectId,
+            message->topic,
+            topicLength
+        );
+
+        bool result = false;
+        if (cachedTopic) {
+            result = beginPublish(cachedTopic, message->length, message->retained, message->qos);
+        } else {
+            topicLength = HASerializer::calculateDataTopicLength(
+                message->objectId,
+                message->topic
+            );
+
+            if (topicLength == 0) {
+                _publishQueue->pop(); // the topic can't be generated, the message is dropped
+                continue;
+            }
+
+            char topic[topicLength];
+            HASerializer::generateDataTopic(topic, message->objectId, message->topic);
+            result = beginPublish(topic, message->length, message->retained, message->qos);
+        }
+
+        if (!result) {
+            return; // the message stays in the queue until the next drain
+        }
+
+        writePayload(message->payload, message->length);
+        endPublish();
+
+        _publishQueue->pop();
+        publishedNb++;
+    }
+}
+#endif
+
+void HAMqtt::replayDirtyStates()
+{
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        const uint8_t mask = (1 << (i % 8));
+        if (!(_dirtyDevicesTypes[i / 8] & mask)) {
+            continue;
+        }
+
+        if (!isConnected()) {
+            return; // remaining states are published after reconnecting
+        }
+
+        _dirtyDevicesTypes[i / 8] &= ~mask;
+        _devicesTypes[i]->publishCurrentState();
+    }
+}
+
+void HAMqtt::finishStateRestore()
+{
+    ARDUINOHA_DEBUG_PRINTLN(F("AHA: state restore finished"))
+
+    _stateRestoreActive = false;
+    _stateRestoreDone = true;
+
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        HABaseDeviceType* deviceType = _devicesTypes[i];
+        deviceType->onStateRestore(false);
+
+        // device types that are not announced yet (paced discovery) or don't publish states on connect are skipped
+        if (deviceType->_stateRestorePending) {
+            deviceType->_stateRestorePending = false;
+            deviceType->publishCurrentState();
+        }
+    }
+}
+
+void HAMqtt::finishDiscovery()
+{
+    _discoveryPending = false;
+    _statePublishingSuppressed = false;
+    _configSuppressed = false;
+    _resubscriptionSuppressed = false;
+}
+
+void HAMqtt::subscribeWildcardTopic()
+{
+    const char* deviceId = _device.getUniqueId();
+    if (!_dataPrefix || !deviceId) {
+        return;
+    }
+
+    char topic[strlen(_dataPrefix) + strlen(deviceId) + strlen_P(HAWildcardTopic) + 3]; // with slashes and null terminator
+    strcpy(topic, _dataPrefix);
+    strcat_P(topic, HASerializerSlash);
+    strcat(topic, deviceId);
+    strcat_P(topic, HASerializerSlash);
+    strcat_P(topic, HAWildcardTopic);
+
+    subscribe(topic);
+}
+
+bool HAMqtt::hasCommandCallbacks() const
+{
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        if (_devicesTypes[i]->hasCommandCallbacks()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+void HAMqtt::flushSubscriptionBatch()
+{
+    _subscriptionsBatched = false;
+
+    if (!_subscriptionBatch || _subscriptionBatch->getTopicsNb() == 0) {
+        return;
+    }
+
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+    // identifiers are shared with QoS 1 messages, so the client skips identifiers of in-flight messages
+    const uint16_t packetId = _mqtt->nextPacketId();
+#else
+    // PubSubClient ignores SUBACK packets and publishes with QoS 0, so identifiers don't need to be tracked
+    if (++_subscriptionPacketId == 0) {
+        _subscriptionPacketId = 1;
+    }
+
+    const uint16_t packetId = _subscriptionPacketId;
+#endif
+
+    uint16_t length = 0;
+    const uint8_t* packet = _subscriptionBatch->build(packetId, length);
+
+    ARDUINOHA_DEBUG_PRINT(F("AHA: subscribing batch of topics: "))
+    ARDUINOHA_DEBUG_PRINTLN(_subscriptionBatch->getTopicsNb())
+
+    if (packet && isConnected()) {
+#if defined(ARDUINOHA_TEST) || defined(ARDUINOHA_NATIVE_MQTT)
+        _mqtt->writePacket(packet, length);
+#else
+        _mqtt->write(packet, length);
+#endif
+    }
+
+    _subscriptionBatch->clear();
+}
+#endif
+
+void HAMqtt::subscribeStatusTopic()
+{
+    char topic[strlen(_discoveryPrefix) + strlen_P(HAStatusTopic) + 2]; // with slash and null terminator
+    strcpy(topic, _discoveryPrefix);
+    strcat_P(topic, HASerializerSlash);
+    strcat_P(topic, HAStatusTopic);
+
+    subscribe(topic);
+}
+
+bool HAMqtt::isBirthMessage(
+    const char* topic,
+    const uint8_t* payload,
+    const uint16_t length
+) const
+{
+    const uint16_t prefixLength = strlen(_discoveryPrefix);
+
+    return
+        strncmp(topic, _discoveryPrefix, prefixLength) == 0 &&
+        topic[prefixLength] == '/' &&
+        strcmp_P(&topic[prefixLength + 1], HAStatusTopic) == 0 &&
+        length == strlen_P(HAOnline) &&
+        memcmp_P(payload, HAOnline, length) == 0;
+}
+
+void HAMqtt::publishConfigs()
+{
+    if (_deviceDiscovery) {
+        publishDeviceConfig();
+        return;
+    }
+
+    // Home Assistant restarted, so the configurations are needed even if they didn't change
+    _configPublishingForced = true;
+
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        _devicesTypes[i]->publishConfig();
+    }
+
+    _configPublishingForced = false;
+}
+
+void HAMqtt::publishDeviceConfig()
+{
+    const uint16_t topicLength = HASerializer::calculateDeviceConfigTopicLength();
+    const uint32_t dataLength = calculateDeviceConfigSize();
+
+    if (topicLength == 0 || dataLength == 0) {
+        return;
+    }
+
+    char topic[topicLength];
+    HASerializer::generateDeviceConfigTopic(topic);
+
+    if (beginPublish(topic, dataLength, true)) {
+        flushDeviceConfig();
+        endPublish();
+    }
+}
+
+uint32_t HAMqtt::calculateDeviceConfigSize()
+{
+    const uint16_t propertySize =
+        strlen_P(HASerializerJsonPropertyPrefix) +
+        strlen_P(HASerializerJsonPropertySuffix);
+
+    uint16_t deviceLength = 0;
+    if (!_device.getJson(deviceLength)) {
+        deviceLength = _device.getSerializer()->calculateSize();
+    }
+
+    // device
+    uint32_t size =
+        strlen_P(HASerializerJsonDataPrefix) +
+        propertySize + strlen_P(HADeviceProperty) +
+        deviceLength;
+
+    // origin
+    size +=
+        strlen_P(HASerializerJsonPropertiesSeparator) +
+        propertySize + strlen_P(HAOriginProperty) +
+        strlen_P(HASerializerJsonDataPrefix) +
+        propertySize + strlen_P(HANameProperty) +
+        2 * strlen_P(HASerializerJsonEscapeChar) + strlen_P(HAOriginName) +
+        strlen_P(HASerializerJsonDataSuffix);
+
+    // shared availability
+    if (_device.isSharedAvailabilityEnabled()) {
+        size +=
+            strlen_P(HASerializerJsonPropertiesSeparator) +
+            propertySize + strlen_P(HAAvailabilityTopic) +
+            2 * strlen_P(HASerializerJsonEscapeChar) +
+            strlen(_device.getAvailabilityTopic());
+    }
+
+    // components
+    size +=
+        strlen_P(HASerializerJsonPropertiesSeparator) +
+        propertySize + strlen_P(HAComponentsProperty) +
+        strlen_P(HASerializerJsonDataPrefix);
+
+    uint8_t componentsNb = 0;
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        HABaseDeviceType* deviceType = _devicesTypes[i];
+        deviceType->buildSerializer();
+
+        if (!deviceType->_serializer) {
+            continue;
+        }
+
+        deviceType->_serializer->enableNestedMode();
+
+        if (componentsNb++ > 0) {
+            size += strlen_P(HASerializerJsonPropertiesSeparator);
+        }
+
+        size +=
+            propertySize + strlen(deviceType->uniqueId()) +
+            deviceType->_serializer->calculateSize();
+
+        deviceType->destroySerializer();
+    }
+
+    size +=
+        strlen_P(HASerializerJsonDataSuffix) + // components
+        strlen_P(HASerializerJsonDataSuffix); // root object
+
+#if defined(ARDUINOHA_NATIVE_MQTT) && !defined(ARDUINOHA_TEST)
+    // the remaining length of the packet is encoded on at most 4 bytes
+    const uint32_t maxSize = 268435455;
+#else
+    // PubSubClient encodes the remaining length of the packet on 16 bits
+    const uint32_t maxSize = 0xFFFF;
+#endif
+
+    return size > maxSize ? 0 : size;
+}
+
+bool HAMqtt::flushDeviceConfig()
+{
+    writePayload(AHATOFSTR(HASerializerJsonDataPrefix));
+
+    // device
+    writeJsonProperty(AHATOFSTR(HADeviceProperty));
+
+    uint16_t deviceLength = 0;
+    const uint8_t* deviceJson = _device.getJson(deviceLength);
+    if (deviceJson) {
+        writePayload(deviceJson, deviceLength);
+    } else if (!_device.getSerializer()->flush()) {
+        return false;
+    }
+
+    // origin
+    writePayload(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+    writeJsonProperty(AHATOFSTR(HAOriginProperty));
+    writePayload(AHATOFSTR(HASerializerJsonDataPrefix));
+    writeJsonProperty(AHATOFSTR(HANameProperty));
+    writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+    writePayload(AHATOFSTR(HAOriginName));
+    writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+    writePayload(AHATOFSTR(HASerializerJsonDataSuffix));
+
+    // shared availability
+    if (_device.isSharedAvailabilityEnabled()) {
+        const char* availabilityTopic = _device.getAvailabilityTopic();
+
+        writePayload(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+        writeJsonProperty(AHATOFSTR(HAAvailabilityTopic));
+        writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+        writePayload(availabilityTopic, strlen(availabilityTopic));
+        writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+    }
+
+    // components
+    writePayload(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+    writeJsonProperty(AHATOFSTR(HAComponentsProperty));
+    writePayload(AHATOFSTR(HASerializerJsonDataPrefix));
+
+    uint8_t componentsNb = 0;
+    for (uint8_t i = 0; i < _devicesTypesNb; i++) {
+        HABaseDeviceType* deviceType = _devicesTypes[i];
+        deviceType->buildSerializer();
+
+        if (!deviceType->_serializer) {
+            continue;
+        }
+
+        deviceType->_serializer->enableNestedMode();
+
+        if (componentsNb++ > 0) {
+            writePayload(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+        }
+
+        writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
+        writePayload(deviceType->uniqueId(), strlen(deviceType->uniqueId()));
+        writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+
+        const bool result = deviceType->_serializer->flush();
+        deviceType->destroySerializer();
+
+        if (!result) {
+            return false;
+        }
+    }
+
+    writePayload(AHATOFSTR(HASerializerJsonDataSuffix)); // components
+    writePayload(AHATOFSTR(HASerializerJsonDataSuffix)); // root object
+    return true;
+}
+
+void HAMqtt::writeJsonProperty(const __FlashStringHelper* property)
+{
+    writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
+    writePayload(property);
+    writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+}
+
+void HAMqtt::setState(ConnectionState state)
+{
+    ConnectionState previousState = _currentState;
+    _currentState = state;
+
+    ARDUINOHA_DEBUG_PRINT(F("AHA: MQTT state changed to "))
+    ARDUINOHA_DEBUG_PRINT(_currentState)
+    ARDUINOHA_DEBUG_PRINT(F(", previous state: "))
+    ARDUINOHA_DEBUG_PRINTLN(previousState)
+
+    if (_currentState == StateConnected) {
+        ARDUINOHA_DEBUG_PRINTLN(F("AHA: MQTT connected"))
+        onConnectedLogic();
+    } else if (previousState == StateConnected && _currentState != StateConnected) {
+        ARDUINOHA_DEBUG_PRINTLN(F("AHA: MQTT disconnected"))
+
+        // the discovery starts over after reconnecting
+        finishDiscovery();
+
+        // subscriptions of the restore are gone, the window starts over after reconnecting
+        _stateRestoreActive = false;
+
+        // spreads the first reconnect of devices that lost the connection at the same time
+        _lastConnectionAttemptAt = millis();
+        _reconnectDelay = nextRandom((_reconnectMinDelay / 100) * _reconnectJitter);
+
+        if (_disconnectedCallback) {
+            _disconnectedCallback();
+        }
+    }
+
+    if (_stateChangedCallback) {
+        _stateChangedCallback(_currentState);
+    }
+}
+
+void HAMqtt::bufferPayload(
+    const uint8_t* data,
+    uint32_t length,
+    const bool isProgmemData
+)
+{
+    _payloadFragmentsNb++;
+
+    // big chunks of RAM data are sent as they are, there is nothing to combine
+    if (!isProgmemData && length >= _payloadBufferSize) {
+        flushPayloadBuffer();
+        _mqtt->write(data, length);
+        _payloadWritesNb++;
+        return;
+    }
+
+    while (length > 0) {
+        const uint16_t space = _payloadBufferSize - _payloadBufferLength;
+        const uint16_t chunkLength = length < space ? length : space;
+
+        if (isProgmemData) {
+            memcpy_P(&_payloadBuffer[_payloadBufferLength], data, chunkLength);
+        } else {
+            memcpy(&_payloadBuffer[_payloadBufferLength], data, chunkLength);
+        }
+
+        _payloadBufferLength += chunkLength;
+        data += chunkLength;
+        length -= chunkLength;
+
+        if (_payloadBufferLength == _payloadBufferSize) {
+            flushPayloadBuffer();
+        }
+    }
+}
+
+void HAMqtt::flushPayloadBuffer()
+{
+    if (_payloadBufferLength == 0) {
+        return;
+    }
+
+    _mqtt->write(_payloadBuffer, _payloadBufferLength);
+    _payloadBufferLength = 0;
+    _payloadWritesNb++;
+}
+
+void HAMqtt::indexDeviceType(uint8_t index)
+{
+    const char* uniqueId = _devicesTypes[index]->uniqueId();
+    if (!uniqueId) {
+        return;
+    }
+
+    const uint16_t mask = _devicesTypesIndexSize - 1;
+    uint16_t slot = HAUtils::hash(uniqueId, strlen(uniqueId)) & mask;
+
+    while (_devicesTypesIndex[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+
+    _devicesTypesIndex[slot] = index + 1;
+}
+
+const char* HAMqtt::parseObjectId(
+    const char* topic,
+    uint16_t& objectIdLength
+) const
+{
+    if (!topic || !_dataPrefix || !_device.getUniqueId()) {
+        return nullptr;
+    }
+
+    const uint16_t prefixLength = strlen(_dataPrefix);
+    if (strncmp(topic, _dataPrefix, prefixLength) != 0 || topic[prefixLength] != '/') {
+        return nullptr;
+    }
+
+    topic += prefixLength + 1;
+
+    const uint16_t deviceIdLength = strlen(_device.getUniqueId());
+    if (
+        strncmp(topic, _device.getUniqueId(), deviceIdLength) != 0 ||
+        topic[deviceIdLength] != '/'
+    ) {
+        return nullptr;
+    }
+
+    topic += deviceIdLength + 1;
+
+    const char* separator = strchr(topic, '/');
+    if (!separator || separator == topic) {
+        return nullptr; // device-level topic (e.g. shared availability)
+    }
+
+    objectIdLength = separator - topic;
+    return topic;
+}
+
+bool HAMqtt::dispatchMessage(
+    const char* objectId,
+    const uint16_t objectIdLength,
+    const char* topic,
+    const uint8_t* payload,
+    const uint16_t length
+)
+{
+    const uint16_t mask = _devicesTypesIndexSize - 1;
+    uint16_t slot = HAUtils::hash(objectId, objectIdLength) & mask;
+    bool dispatched = false;
+
+    // all device types with the same ID receive the message
+    while (_devicesTypesIndex[slot] != 0) {
+        HABaseDeviceType* deviceType = _devicesTypes[_devicesTypesIndex[slot] - 1];
+        const char* uniqueId = deviceType->uniqueId();
+
+        if (
+            strncmp(uniqueId, objectId, objectIdLength) == 0 &&
+            uniqueId[objectIdLength] == 0
+        ) {
+            deviceType->onMqttMessage(topic, payload, length);
+            dispatched = true;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return dispatched;
+}
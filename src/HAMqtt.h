@@ -5,6 +5,7 @@
 #include <Client.h>
 #include <IPAddress.h>
 #include "ArduinoHADefines.h"
+#include "utils/HATimerWheel.h"
 
 #if defined(ARDUINOHA_USE_STD_FUNCTION)
     #define HAMQTT_CALLBACK(name) std::function<void()> name
@@ -20,6 +21,8 @@
 
 #ifdef ARDUINOHA_TEST
     class PubSubClientMock;
+#elif defined(ARDUINOHA_NATIVE_MQTT)
+    class HAMqttClient;
 #else
     class PubSubClient;
 #endif
@@ -32,6 +35,10 @@
 
 class HADevice;
 class HABaseDeviceType;
+class HATopicCache;
+class HAPublishQueue;
+class HASubscriptionBatch;
+class HAStorage;
 
 #if defined(ARDUINO_API_VERSION)
     using namespace arduino;
@@ -58,6 +65,36 @@ public:
         StateUnauthorized = 5
     };
 
+    /// Phases of the connection with the MQTT broker (see HAMqtt::enablePhasedConnection).
+    enum ConnectionPhase {
+        ConnectionPhaseIdle = 0,
+        ConnectionPhaseNetwork,
+        ConnectionPhaseConnect,
+        ConnectionPhaseConnack
+    };
+
+    /// Elapsed time (milliseconds) of the phases of HAMqtt::publishAndDisconnect.
+    struct SingleShotReport {
+        /// Time of opening the connection with the MQTT broker.
+        uint32_t connectTime;
+
+        /// Time of announcing the device types (configuration, states and subscriptions).
+        uint32_t discoveryTime;
+
+        /// Time of publishing the queued messages and flushing the network client.
+        uint32_t flushTime;
+
+        /// Time of closing the connection.
+        uint32_t disconnectTime;
+
+        SingleShotReport():
+            connectTime(0),
+            discoveryTime(0),
+            flushTime(0),
+            disconnectTime(0)
+        { }
+    };
+
     /**
      * Returns existing instance (singleton) of the HAMqtt class.
      * It may be a null pointer if the HAMqtt object was never constructed or it was destroyed.
@@ -115,8 +152,7 @@ public:
      *
      * @param prefix The data topics' prefix.
      */
-    inline void setDataPrefix(const char* prefix)
-        { _dataPrefix = prefix; }
+    void setDataPrefix(const char* prefix);
 
     /**
      * Returns the data topics' prefix.
@@ -124,6 +160,273 @@ public:
     inline const char* getDataPrefix() const
         { return _dataPrefix; }
 
+    /**
+     * Enables the abbreviation of the data topics in the discovery payloads.
+     * The common part of the entity's topics (`[data prefix]/[device ID]/[object ID]`) is published
+     * only once as the `~` property and each topic is published as `~/[topic]`.
+     * This feature is supported by Home Assistant since the MQTT discovery was introduced.
+     */
+    inline void enableTopicAbbreviation()
+        { _topicAbbreviation = true; }
+
+    /**
+     * Returns `true` if the abbreviation of the data topics is enabled.
+     */
+    inline bool isTopicAbbreviationEnabled() const
+        { return _topicAbbreviation; }
+
+    /**
+     * Enables the device-based discovery.
+     * Instead of publishing a separate configuration for each device type,
+     * a single configuration of the whole device is published on the `[discovery prefix]/device/[device ID]/config` topic.
+     * The device's representation and the shared availability are published only once in this mode.
+     *
+     * @note This feature requires Home Assistant 2024.11 or newer.
+     */
+    inline void enableDeviceDiscovery()
+        { _deviceDiscovery = true; }
+
+    /**
+     * Returns `true` if the device-based discovery is enabled.
+     */
+    inline bool isDeviceDiscoveryEnabled() const
+        { return _deviceDiscovery; }
+
+    /**
+     * Enables publishing of the discovery configuration driven by the Home Assistant's birth message.
+     * The HAMqtt subscribes to the `[discovery prefix]/status` topic and the configuration is published
+     * only on the first connection and each time Home Assistant publishes the `online` message on this topic.
+     * Reconnections to the broker don't produce configuration messages in this mode.
+     */
+    inline void enableDiscoveryOnBirthMessage()
+        { _discoveryOnBirthMessage = true; }
+
+    /**
+     * Returns `true` if the discovery is driven by the Home Assistant's birth message.
+     */
+    inline bool isDiscoveryOnBirthMessageEnabled() const
+        { return _discoveryOnBirthMessage; }
+
+    /**
+     * Enables the persistent MQTT session (the `cleanSession` flag is not set in the CONNECT packet).
+     * The broker keeps subscriptions of the device between connections, so when the broker reports
+     * that the session is present the device types don't subscribe their topics again.
+     * If the session is not present, all topics are subscribed as usual.
+     *
+     * @note PubSubClient doesn't report the session present flag, so the topics are always subscribed when it's used.
+     *       The built-in MQTT client (see `ARDUINOHA_NATIVE_MQTT`) reports the flag.
+     */
+    inline void enablePersistentSession()
+        { _persistentSession = true; }
+
+    /**
+     * Returns `true` if the persistent MQTT session is enabled.
+     */
+    inline bool isPersistentSessionEnabled() const
+        { return _persistentSession; }
+
+    /**
+     * Enables the wildcard subscription.
+     * By default, each device type subscribes its command topics separately, which results in dozens
+     * of SUBSCRIBE packets after each connection (e.g. HALight subscribes up to 4 topics, HAHVAC up to 6).
+     * With the wildcard subscription, the device subscribes a single `[data prefix]/[device ID]/#` topic
+     * and received messages are dispatched to the device types locally.
+     *
+     * @note The broker also delivers the messages published by the device itself (e.g. states) back to the device.
+     *       They are ignored by the device types, but they're passed to the HAMqtt::onMessage callback.
+     */
+    inline void enableWildcardSubscription()
+        { _wildcardSubscription = true; }
+
+    /**
+     * Returns `true` if the wildcard subscription is enabled.
+     */
+    inline bool isWildcardSubscriptionEnabled() const
+        { return _wildcardSubscription; }
+
+    /**
+     * Enables publishing of messages with QoS 1 (see HAMqtt::publish and HABaseDeviceType::setQos).
+     * Messages published with QoS 1 are kept in the in-flight window until the broker acknowledges them.
+     * Unacknowledged messages are retransmitted by the HAMqtt::loop method.
+     * It requires the built-in MQTT client (see `ARDUINOHA_NATIVE_MQTT`), PubSubClient publishes messages with QoS 0 only.
+     *
+     * @param windowSize The maximum number of unacknowledged messages. Publishing fails if the window is full.
+     * @param maxPacketSize The maximum size of a single message (topic and payload) kept in the window (bytes).
+     *                      Bigger messages are published with QoS 0.
+     * @param retryInterval Time (milliseconds) of waiting for the acknowledgment before the message is retransmitted.
+     * @param maxRetries The maximum number of retransmissions. The message is dropped afterwards.
+     * @returns Returns `true` if QoS 1 has been enabled.
+     */
+    bool enableQos1Publishing(
+        const uint8_t windowSize,
+        const uint16_t maxPacketSize,
+        const uint16_t retryInterval = 5000,
+        const uint8_t maxRetries = 3
+    );
+
+    /**
+     * Returns the number of QoS 1 messages that wait for the acknowledgment.
+     */
+    uint8_t getInflightMessagesNb() const;
+
+    /**
+     * Returns the number of retransmissions of QoS 1 messages.
+     */
+    uint32_t getRetriedMessagesNb() const;
+
+    /**
+     * Returns the number of QoS 1 messages that were dropped because the window was full
+     * or because they were not acknowledged after the maximum number of retransmissions.
+     */
+    uint32_t getDroppedMessagesNb() const;
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    /**
+     * Enables batching of subscriptions.
+     * PubSubClient sends a separate SUBSCRIBE packet for each topic. With the batching, topics subscribed
+     * while the device types are announced are packed into as few SUBSCRIBE packets as the given size allows.
+     * It's an alternative to the wildcard subscription (see HAMqtt::enableWildcardSubscription) if the broker's ACLs don't allow wildcards.
+     * Calling this method again replaces the existing batch.
+     *
+     * @param maxPacketSize The maximum size of a single SUBSCRIBE packet (bytes). It shouldn't exceed the limit of the broker.
+     * @returns Returns `true` if the batching has been enabled.
+     * @note The batching is available only if the `ARDUINOHA_SUBSCRIPTION_BATCH` macro is defined (see ArduinoHADefines.h).
+     */
+    bool enableSubscriptionBatching(const uint16_t maxPacketSize);
+
+    /**
+     * Disables batching of subscriptions and frees its memory.
+     */
+    void disableSubscriptionBatching();
+
+    /**
+     * Returns `true` if batching of subscriptions is enabled.
+     */
+    inline bool isSubscriptionBatchingEnabled() const
+        { return _subscriptionBatch != nullptr; }
+#endif
+
+    /**
+     * Returns `true` if the broker reported that the session was present during the last connection.
+     */
+    bool isSessionPresent() const;
+
+    /**
+     * Returns `true` if the device types need to skip subscribing of their topics.
+     * It's the case when the persistent session is enabled and the broker holds the previous session.
+     *
+     * @note Do not use this method on your own. It's only for the internal purpose.
+     */
+    inline bool isResubscriptionSuppressed() const
+        { return _resubscriptionSuppressed; }
+
+    /**
+     * Returns `true` if the device type that's being announced needs to skip subscribing of its topics.
+     * Apart from the resubscription (see HAMqtt::isResubscriptionSuppressed), it's the case when the wildcard
+     * subscription is enabled or when the device type without command callbacks is announced by HAMqtt::publishAndDisconnect.
+     *
+     * @note Do not use this method on your own. It's only for the internal purpose.
+     */
+    inline bool isSubscriptionSuppressed() const
+        { return _resubscriptionSuppressed || _subscriptionSuppressed || _wildcardSubscription; }
+
+    /**
+     * Returns `true` if the device types need to skip publishing of the configuration.
+     * It's the case when the device-based discovery is enabled or when the configuration
+     * was already published and Home Assistant didn't send the birth message since then.
+     *
+     * @note Do not use this method on your own. It's only for the internal purpose.
+     */
+    inline bool isConfigPublishingSuppressed() const
+        { return _deviceDiscovery || _configSuppressed; }
+
+    /**
+     * Enables the offline buffering of states.
+     * When a state can't be published (e.g. the connection is lost), the device type keeps the new value
+     * and it's marked as dirty. After reconnecting, only states of the dirty device types are published
+     * (in one batch after the discovery) instead of states of all device types.
+     * States of all device types are published on the first connection since the boot.
+     *
+     * @note The buffering uses one bit of RAM per device type.
+     */
+    void enableOfflineBuffering();
+
+    /**
+     * Returns `true` if the offline buffering of states is enabled.
+     */
+    inline bool isOfflineBufferingEnabled() const
+        { return _dirtyDevicesTypes != nullptr; }
+
+    /**
+     * Returns `true` if the device types need to skip publishing of their states when the connection is acquired.
+     */
+    inline bool isStatePublishingSuppressed() const
+        { return _statePublishingSuppressed || _stateRestoreActive; }
+
+    /**
+     * Enables restoring states of device types from the retained messages at boot.
+     * On the first connection since the boot, device types that support restoring (HASwitch, HANumber, HALight and HASelect)
+     * subscribe to their own state topics. Retained values received within the given window are passed
+     * to the command callbacks, so the application can bring back the previous state (e.g. of a relay) and report it using `setState`.
+     * States of device types announced within the window are published when the window ends instead of right after connecting.
+     * Device types announced later (see HAMqtt::enablePacedDiscovery) publish their states as usual.
+     *
+     * @param window Time (milliseconds) of waiting for the retained messages.
+     */
+    void enableStateRestore(const uint16_t window);
+
+    /**
+     * Returns `true` if the device types accept the retained values of their state topics.
+     */
+    inline bool isStateRestoreActive() const
+        { return _stateRestoreActive; }
+
+    /**
+     * Sets the storage of the discovery configurations' hashes.
+     * Before publishing the configuration, each device type calculates the FNV-1a hash of the serialized payload
+     * and compares it with the hash kept in the storage (the unique ID of the device type is used as a key).
+     * Unchanged configurations are not published. The configurations are always published when Home Assistant
+     * sends the birth message (see HAMqtt::enableDiscoveryOnBirthMessage).
+     *
+     * @param storage The key-value storage. Set nullptr to publish all configurations.
+     * @note The HAMqtt class doesn't take ownership of the given pointer.
+     * @note The device-based discovery (see HAMqtt::enableDeviceDiscovery) doesn't use the storage.
+     */
+    inline void setConfigStorage(HAStorage* storage)
+        { _configStorage = storage; }
+
+    /**
+     * Returns the storage of the configurations' hashes.
+     * It's nullptr if the storage is not set or the configurations need to be published regardless of their hashes.
+     */
+    inline HAStorage* getConfigStorage() const
+        { return _configPublishingForced ? nullptr : _configStorage; }
+
+    /**
+     * Marks the configuration of a device type as skipped because it's unchanged.
+     */
+    inline void markConfigSkipped()
+        { _skippedConfigsNb++; }
+
+    /**
+     * Returns the number of configurations that were not published because they were unchanged.
+     */
+    inline uint16_t getSkippedConfigsNb() const
+        { return _skippedConfigsNb; }
+
+    /**
+     * Marks the state of the given device type as changed while it couldn't be published.
+     *
+     * @param deviceType The device type to mark.
+     * @returns Returns `false` if the offline buffering is disabled or the device type is not registered.
+     */
+    bool markStateDirty(const HABaseDeviceType* deviceType);
+
+    /**
+     * Returns the number of device types whose states wait for being published.
+     */
+    uint8_t getDirtyDevicesTypesNb() const;
+
     /**
      * Returns instance of the device assigned to the HAMqtt class.
      * It's the same object (pointer) that was passed to the HAMqtt constructor.
@@ -173,6 +476,118 @@ public:
     inline ConnectionState getState() const
         { return _currentState; }
 
+    /**
+     * Enables the phased connection with the MQTT broker.
+     * The connection is split into phases that are processed in the subsequent calls of the HAMqtt::loop method:
+     * 1) the network connection (DNS resolution and TCP connection), 2) sending of the CONNECT packet
+     * and 3) waiting for the CONNACK packet, which is polled in each loop until it arrives or the CONNACK timeout elapses.
+     * The connection state is StateConnecting between the phases, so the rest of your loop keeps running
+     * while the connection is being established.
+     *
+     * @note The DNS resolution and the TCP connection are performed by a single call of `Client::connect`, so the network phase
+     * is limited by the blocking API of the network client. Use HAMqtt::setConnectionTimeouts to bound it.
+     * PubSubClient doesn't allow to send the CONNECT packet without waiting for the CONNACK packet,
+     * so it's awaited in the second phase unless the built-in client is used (see `ARDUINOHA_NATIVE_MQTT`).
+     */
+    inline void enablePhasedConnection()
+        { _phasedConnection = true; }
+
+    /**
+     * Returns the current phase of the connection with the MQTT broker.
+     */
+    inline ConnectionPhase getConnectionPhase() const
+        { return _connectionPhase; }
+
+    /**
+     * Sets timeouts of the connection phases.
+     *
+     * @param networkTimeout Timeout of the network connection (milliseconds). It's passed to the network client using `Client::setTimeout`. Set `0` to keep the client's default.
+     * @param connackTimeout Maximum time of waiting for the CONNACK packet (milliseconds). Set `0` to keep the default (15 seconds).
+     */
+    void setConnectionTimeouts(const uint32_t networkTimeout, const uint32_t connackTimeout);
+
+    /**
+     * Sets the policy of reconnecting to the MQTT broker.
+     * The delay between failed connection attempts starts at `minDelay` and it's multiplied by `multiplier`
+     * after each failure until it reaches `maxDelay`. It's reset after a successful connection.
+     * The jitter shortens each delay by a random part of it, so devices don't reconnect in lockstep after the broker restarts.
+     * The random generator is seeded with the unique ID of the device.
+     * By default, the library reconnects every 10 seconds without the jitter.
+     *
+     * @param minDelay The delay after the first failed attempt (milliseconds).
+     * @param maxDelay The maximum delay between attempts (milliseconds).
+     * @param multiplier The multiplier of the delay applied after each failed attempt.
+     * @param jitter The maximum part of the delay (percent) that's randomly subtracted from it.
+     */
+    void setReconnectPolicy(
+        const uint32_t minDelay,
+        const uint32_t maxDelay,
+        const uint8_t multiplier = 2,
+        const uint8_t jitter = 50
+    );
+
+    /**
+     * Returns the number of connection attempts made since the last successful connection (including the current one).
+     * It can be used in the HAMqtt::onStateChanged callback.
+     * The counter is reset after the callback for the StateConnected state is called.
+     */
+    inline uint16_t getConnectionAttemptsNb() const
+        { return _connectionAttemptsNb; }
+
+    /**
+     * Returns the delay (milliseconds) that needs to elapse before the next connection attempt.
+     */
+    inline uint32_t getReconnectDelay() const
+        { return _reconnectDelay; }
+
+    /**
+     * Enables the paced discovery.
+     * By default, all device types publish their configuration, availability and state, and subscribe their topics
+     * in the same loop cycle in which the connection is acquired. With the paced discovery, the device types are announced
+     * in the subsequent calls of the HAMqtt::loop method. Each call processes device types until one of the limits is reached
+     * (at least one device type is processed in each call).
+     *
+     * @param entitiesLimit The maximum number of device types processed in a single loop cycle. Set `0` to disable the limit.
+     * @param bytesLimit The maximum number of bytes (topics and payloads) published in a single loop cycle. Set `0` to disable the limit.
+     * @param timeLimit The maximum time (microseconds) spent on the discovery in a single loop cycle. Set `0` to disable the limit.
+     */
+    void enablePacedDiscovery(
+        const uint8_t entitiesLimit,
+        const uint16_t bytesLimit = 0,
+        const uint32_t timeLimit = 0
+    );
+
+    /**
+     * Returns `true` if all device types were announced since the connection was acquired.
+     */
+    inline bool isDiscoveryCompleted() const
+        { return _currentState == StateConnected && !_discoveryPending; }
+
+    /**
+     * Returns the number of device types announced since the connection was acquired.
+     */
+    inline uint8_t getDiscoveryProgress() const
+        { return _discoveryIndex; }
+
+    /**
+     * Connects to the MQTT broker, announces all device types, publishes the queued messages and closes the connection.
+     * The whole sequence is executed synchronously and it's designed for battery powered devices that wake up,
+     * publish a few values and go back to the deep sleep. The HAMqtt::begin method needs to be called before.
+     * Device types without command callbacks don't subscribe their topics as there is nothing that could handle the commands.
+     * The status topic of Home Assistant and the state restore are skipped for the same reason.
+     *
+     * @param timeout The maximum time (milliseconds) of the whole sequence.
+     * @param discovery Specifies whether the configuration of device types should be published.
+     *                  Set `false` if the retained configuration was already published (e.g. during the first boot).
+     * @param report Optional pointer to the report with the elapsed time of each phase.
+     * @returns `true` if all device types were announced before the timeout and the connection was closed.
+     */
+    bool publishAndDisconnect(
+        const uint32_t timeout,
+        const bool discovery = true,
+        SingleShotReport* report = nullptr
+    );
+
     /**
      * Sets parameters of the MQTT connection using the IP address and port.
      * The library will try to connect to the broker in first loop cycle.
@@ -269,10 +684,191 @@ public:
      */
     bool setBufferSize(uint16_t size);
 
+#ifdef ARDUINOHA_TOPIC_CACHE
+    /**
+     * Enables the cache of the data topics.
+     * Once enabled, the data topics of all device types (state topics, command topics, etc.)
+     * are resolved on the first use and stored in a single arena owned by the HAMqtt.
+     * Publishing and comparing topics uses the stored topics instead of generating them each time.
+     * If the cache is full, topics are generated on the fly as usual.
+     * The cache is disabled by default. Calling this method again replaces the existing cache.
+     *
+     * @param arenaSize Size of the memory (bytes) where the topics are stored. Each topic uses its length + 1 bytes.
+     * @param maxTopicsNb The maximum number of topics that can be stored.
+     * @returns Returns `true` if the cache has been enabled.
+     * @note You can check the RAM used by the cache using `getTopicCache()->calculateMemoryUsage()`.
+     * The cache is available only if the `ARDUINOHA_TOPIC_CACHE` macro is defined (see ArduinoHADefines.h).
+     */
+    bool enableTopicCache(const uint16_t arenaSize, const uint8_t maxTopicsNb);
+
+    /**
+     * Disables the cache of the data topics and frees its memory.
+     */
+    void disableTopicCache();
+
+    /**
+     * Returns the cache of the data topics.
+     * It's nullptr if the cache is not enabled.
+     */
+    inline const HATopicCache* getTopicCache() const
+        { return _topicCache; }
+
+    /**
+     * Returns the cached data topic for the given object ID and topic name.
+     *
+     * @param objectId The unique ID of a device type that owns the topic. It can be nullptr.
+     * @param topic The topic name (progmem string).
+     * @param length Length of the returned topic (excluding the null terminator).
+     * @returns Pointer to the cached topic or nullptr if the cache is disabled or full.
+     */
+    const char* getCachedDataTopic(
+        const char* objectId,
+        const __FlashStringHelper* topic,
+        uint16_t& length
+    ) const;
+#else
+    inline const char* getCachedDataTopic(
+        const char* objectId,
+        const __FlashStringHelper* topic,
+        uint16_t& length
+    ) const
+        { (void)objectId; (void)topic; (void)length; return nullptr; }
+#endif
+
+    /**
+     * Enables the write-combining buffer of the payloads.
+     * Fragments written using HAMqtt::writePayload methods are collected in the buffer
+     * and sent to the network client in chunks of the given size.
+     * The remaining data is sent in the HAMqtt::endPublish method.
+     *
+     * @param size Size of the buffer (bytes). The MTU of the network (1460 bytes for the WiFi) is a good choice.
+     * @returns Returns `true` if the buffer has been enabled.
+     */
+    bool enablePayloadBuffer(const uint16_t size);
+
+    /**
+     * Disables the write-combining buffer of the payloads and frees its memory.
+     */
+    void disablePayloadBuffer();
+
+    /**
+     * Returns size of the payload buffer (bytes). It's `0` if the buffer is disabled.
+     */
+    inline uint16_t getPayloadBufferSize() const
+        { return _payloadBufferSize; }
+
+    /**
+     * Returns the number of writes to the network client that were saved by the payload buffer.
+     */
+    inline uint32_t getSavedPayloadWritesNb() const
+        { return _payloadFragmentsNb > _payloadWritesNb ? _payloadFragmentsNb - _payloadWritesNb : 0; }
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+    /**
+     * Enables the outbound queue of the data messages (states, availability, etc.).
+     * Messages published by device types are kept in the queue and published by the HAMqtt::loop method.
+     * A newer value for the same topic replaces the pending one, so each topic is published at most once per drain.
+     * If the message can't be queued (the queue is full or the payload is too big), it's published right away.
+     * The queue is disabled by default. Calling this method again replaces the existing queue (pending messages are dropped).
+     *
+     * @param maxMessagesNb The maximum number of pending messages.
+     * @param maxPayloadSize The maximum size of a single payload (bytes).
+     * @param drainInterval The minimum interval between drains of the queue (milliseconds). Set `0` to drain the queue in each loop cycle.
+     * @param drainLimit The maximum number of messages published in a single drain. Set `0` to publish all pending messages.
+     * @returns Returns `true` if the queue has been enabled.
+     * @note You can check the RAM used by the queue using `getPublishQueue()->calculateMemoryUsage()`.
+     * The queue is available only if the `ARDUINOHA_PUBLISH_QUEUE` macro is defined (see ArduinoHADefines.h).
+     */
+    bool enablePublishQueue(
+        const uint8_t maxMessagesNb,
+        const uint16_t maxPayloadSize,
+        const uint16_t drainInterval = 0,
+        const uint8_t drainLimit = 0
+    );
+
+    /**
+     * Disables the outbound queue and frees its memory. Pending messages are dropped.
+     */
+    void disablePublishQueue();
+
+    /**
+     * Returns the outbound queue of the data messages.
+     * It's nullptr if the queue is not enabled.
+     */
+    inline const HAPublishQueue* getPublishQueue() const
+        { return _publishQueue; }
+
+    /**
+     * Adds the message of the data topic to the outbound queue.
+     *
+     * @param objectId The unique ID of a device type that owns the topic. It can be nullptr.
+     * @param topic The topic name (progmem string).
+     * @param payload The message's payload.
+     * @param length The length of the payload.
+     * @param retained Specifies whether the message should be retained.
+     * @param isProgmemData Specifies whether the payload is stored in the flash memory.
+     * @param qos QoS of the message.
+     * @returns Returns `false` if the queue is disabled or the message can't be queued.
+     */
+    bool queueDataMessage(
+        const char* objectId,
+        const __FlashStringHelper* topic,
+        const uint8_t* payload,
+        const uint16_t length,
+        const bool retained,
+        const bool isProgmemData,
+        const uint8_t qos = 0
+    );
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /**
+     * Enables the scheduler of the publish policies (see HABaseDeviceType::setPublishInterval).
+     * The scheduler is a timer wheel processed in the HAMqtt::loop method, so the cost of each loop cycle
+     * depends on the number of expiring policies instead of the number of device types.
+     * It's enabled with the default settings when the first policy is set, so this method is only needed to tune the wheel.
+     * Timers further than one revolution (`resolution * slotsNb`) are supported, they're just visited more often.
+     *
+     * @param resolution Time covered by a single slot of the wheel (milliseconds).
+     * @param slotsNb The number of slots of the wheel.
+     * @returns Returns `false` if the scheduler is already enabled.
+     */
+    bool enablePublishScheduler(
+        const uint16_t resolution = 100,
+        const uint8_t slotsNb = 32
+    );
+
+    /**
+     * Returns the scheduler of the publish policies.
+     * It's nullptr if the scheduler is not enabled.
+     */
+    inline const HATimerWheel* getPublishScheduler() const
+        { return _publishScheduler; }
+
+    /**
+     * Schedules the timer of the publish policy.
+     *
+     * @param timer The timer to schedule.
+     * @param deadline Time when the timer expires (milliseconds since boot).
+     * @note Do not use this method on your own. It's only for the internal purpose.
+     */
+    void schedulePublish(HATimerWheel::Timer* timer, const uint32_t deadline);
+
+    /**
+     * Removes the timer of the publish policy from the scheduler.
+     *
+     * @param timer The timer to remove.
+     * @note Do not use this method on your own. It's only for the internal purpose.
+     */
+    void cancelPublish(HATimerWheel::Timer* timer);
+#endif
+
     /**
      * Adds a new device's type to the MQTT.
      * Each time the connection with MQTT broker is acquired, the HAMqtt class
      * calls "onMqttConnected" method in all devices' types instances.
+     * The device type is also added to the routing index, so messages received
+     * on its data topics are dispatched directly to it.
      *
      * @note The HAMqtt class doesn't take ownership of the given pointer.
      * @param deviceType Instance of the device's type (HASwitch, HABinarySensor, etc.).
@@ -287,8 +883,9 @@ public:
      * @param topic The topic to publish.
      * @param payload The payload to publish (it may be empty const char).
      * @param retained Specifies whether message should be retained.
+     * @param qos QoS of the message (0 or 1). QoS 1 requires HAMqtt::enableQos1Publishing to be called before.
      */
-    bool publish(const char* topic, const char* payload, bool retained = false);
+    bool publish(const char* topic, const char* payload, bool retained = false, uint8_t qos = 0);
 
     /**
      * Begins publishing of a message with the given properties.
@@ -296,32 +893,39 @@ public:
      *
      * @param topic Topic of the published message.
      * @param payloadLength Length of the payload (bytes) that's going to be published.
+     *                      Payloads bigger than 64 KB require the built-in MQTT client (see `ARDUINOHA_NATIVE_MQTT`).
      * @param retained Specifies whether the published message should be retained.
+     * @param qos QoS of the message (0 or 1). QoS 1 requires HAMqtt::enableQos1Publishing to be called before.
      */
-    bool beginPublish(const char* topic, uint16_t payloadLength, bool retained = false);
+    bool beginPublish(
+        const char* topic,
+        uint32_t payloadLength,
+        bool retained = false,
+        uint8_t qos = 0
+    );
 
     /**
-     * Writes given string to the TCP stream.
+     * Writes given string to the TCP stream (or to the payload buffer if it's enabled).
      * Please note that before writing any data the HAMqtt::beginPublish method
      * needs to be called.
      *
      * @param data The string to publish.
      * @param length Length of the data (bytes).
      */
-    void writePayload(const char* data, const uint16_t length);
+    void writePayload(const char* data, const uint32_t length);
 
     /**
-     * Writes given data to the TCP stream.
+     * Writes given data to the TCP stream (or to the payload buffer if it's enabled).
      * Please note that before writing any data the HAMqtt::beginPublish method
      * needs to be called.
      *
      * @param data The data to publish.
      * @param length Length of the data (bytes).
      */
-    void writePayload(const uint8_t* data, const uint16_t length);
+    void writePayload(const uint8_t* data, const uint32_t length);
 
     /**
-     * Writes given progmem data to the TCP stream.
+     * Writes given progmem data to the TCP stream (or to the payload buffer if it's enabled).
      * Please note that before writing any data the HAMqtt::beginPublish method
      * needs to be called.
      *
@@ -331,6 +935,7 @@ public:
 
     /**
      * Finishes publishing of a message.
+     * The remaining content of the payload buffer is sent before the message is finished.
      * After calling this method the message will be processed by the broker.
      */
     bool endPublish();
@@ -347,6 +952,13 @@ public:
      */
     bool subscribe(const char* topic);
 
+    /**
+     * Unsubscribes from the given topic.
+     *
+     * @param topic Topic to unsubscribe.
+     */
+    bool unsubscribe(const char* topic);
+
     /**
      * Enables the last will message that will be produced when the device disconnects from the broker.
      * If you want to change availability of the device in Home Assistant panel
@@ -368,6 +980,9 @@ public:
 
     /**
      * Processes MQTT message received from the broker (subscription).
+     * Messages received on the data topics of this device (`[data prefix]/[device ID]/[object ID]/...`)
+     * are dispatched only to the device type that owns the object ID.
+     * All other messages are passed to all registered device types.
      *
      * @note Do not use this method on your own. It's only for the internal purpose.
      * @param topic Topic of the message.
@@ -385,7 +1000,7 @@ public:
 #endif
 
 private:
-    /// Interval between MQTT reconnects (milliseconds).
+    /// The default interval between MQTT reconnects (milliseconds).
     static const uint16_t ReconnectInterval = 10000;
 
     /// Living instance of the HAMqtt class. It can be nullptr.
@@ -397,23 +1012,200 @@ private:
      */
     void connectToServer();
 
+    /**
+     * Opens the network connection with the MQTT broker (the first phase of the phased connection).
+     */
+    bool connectNetwork();
+
+    /**
+     * Calculates the delay of the next connection attempt after the failed one.
+     */
+    void scheduleReconnect();
+
+    /**
+     * Returns a random value in range [0, max] based on the xorshift generator.
+     *
+     * @param max The maximum value.
+     */
+    uint32_t nextRandom(const uint32_t max);
+
     /**
      * This method is called each time the connection with MQTT broker is acquired.
      */
     void onConnectedLogic();
 
+    /**
+     * Announces the pending device types within the limits of the paced discovery.
+     */
+    void processDiscovery();
+
+    /**
+     * Finishes the discovery job (or aborts it if the connection is lost).
+     */
+    void finishDiscovery();
+
+    /**
+     * Subscribes the wildcard topic that covers data topics of all device types (see HAMqtt::enableWildcardSubscription).
+     */
+    void subscribeWildcardTopic();
+
+    /**
+     * Returns `true` if at least one device type has callbacks for commands.
+     */
+    bool hasCommandCallbacks() const;
+
+    /**
+     * Starts collecting subscriptions in the batch (if the batching is enabled).
+     */
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    inline void beginSubscriptionBatch()
+        { _subscriptionsBatched = (_subscriptionBatch != nullptr); }
+#else
+    inline void beginSubscriptionBatch()
+        { }
+#endif
+
+    /**
+     * Sends the collected subscriptions in a single SUBSCRIBE packet and stops collecting them.
+     */
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    void flushSubscriptionBatch();
+#else
+    inline void flushSubscriptionBatch()
+        { }
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+    /**
+     * Publishes pending messages of the outbound queue.
+     */
+    void drainPublishQueue();
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /**
+     * Processes the expired timers of the publish policies.
+     */
+    void processPublishScheduler();
+#endif
+
+    /**
+     * Publishes states of the dirty device types.
+     */
+    void replayDirtyStates();
+
+    /**
+     * Ends the window of restoring states and publishes states of all device types.
+     */
+    void finishStateRestore();
+
+    /**
+     * Subscribes to the Home Assistant's status topic (`[discovery prefix]/status`).
+     */
+    void subscribeStatusTopic();
+
+    /**
+     * Checks whether the given message is the Home Assistant's birth message.
+     *
+     * @param topic Topic of the message.
+     * @param payload Content of the message.
+     * @param length Length of the message.
+     */
+    bool isBirthMessage(const char* topic, const uint8_t* payload, const uint16_t length) const;
+
+    /**
+     * Publishes the discovery configuration of all registered device types.
+     */
+    void publishConfigs();
+
+    /**
+     * Publishes the device-based discovery configuration (see HAMqtt::enableDeviceDiscovery).
+     */
+    void publishDeviceConfig();
+
+    /**
+     * Calculates the size of the device-based discovery payload.
+     * Returns `0` if the payload is too big to be published by the MQTT client.
+     */
+    uint32_t calculateDeviceConfigSize();
+
+    /**
+     * Flushes the device-based discovery payload to the MQTT stream.
+     */
+    bool flushDeviceConfig();
+
+    /**
+     * Writes the JSON property's name to the MQTT stream.
+     *
+     * @param property The property name (progmem string).
+     */
+    void writeJsonProperty(const __FlashStringHelper* property);
+
     /**
      * Sets the state of the MQTT connection.
      */
     void setState(ConnectionState state);
 
+    /**
+     * Appends the given data to the payload buffer.
+     * The buffer is flushed each time it's full.
+     *
+     * @param data The data to append.
+     * @param length Length of the data (bytes).
+     * @param isProgmemData Specifies whether the data is stored in the flash memory.
+     */
+    void bufferPayload(const uint8_t* data, uint32_t length, const bool isProgmemData);
+
+    /**
+     * Sends the content of the payload buffer to the network client.
+     */
+    void flushPayloadBuffer();
+
+    /**
+     * Adds the device type with the given index to the routing index.
+     *
+     * @param index Index of the device type in the `_devicesTypes` array.
+     */
+    void indexDeviceType(uint8_t index);
+
+    /**
+     * Extracts the object ID from the given data topic.
+     * The topic needs to have the following structure: `[data prefix]/[device ID]/[object ID]/[topic]`.
+     *
+     * @param topic The topic to parse.
+     * @param objectIdLength Length of the object ID (output).
+     * @returns Pointer to the beginning of the object ID within the topic or nullptr if the topic doesn't match.
+     */
+    const char* parseObjectId(const char* topic, uint16_t& objectIdLength) const;
+
+    /**
+     * Dispatches the message to device types that own the given object ID.
+     *
+     * @returns `true` if at least one device type received the message.
+     */
+    bool dispatchMessage(
+        const char* objectId,
+        const uint16_t objectIdLength,
+        const char* topic,
+        const uint8_t* payload,
+        const uint16_t length
+    );
+
 #ifdef ARDUINOHA_TEST
     PubSubClientMock* _mqtt;
+#else
+#ifdef ARDUINOHA_NATIVE_MQTT
+    /// Instance of the built-in MQTT client. It's initialized in the constructor.
+    HAMqttClient* _mqtt;
 #else
     /// Instance of the PubSubClient class. It's initialized in the constructor.
     PubSubClient* _mqtt;
 #endif
 
+    /// The network client passed to the constructor.
+    Client* _netClient;
+#endif
+
     /// Instance of the HADevice passed to the constructor.
     const HADevice& _device;
 
@@ -438,6 +1230,30 @@ private:
     /// The data prefix that's used for publishing data messages.
     const char* _dataPrefix;
 
+    /// Specifies whether the data topics are abbreviated in the discovery payloads.
+    bool _topicAbbreviation;
+
+    /// Specifies whether the device-based discovery is enabled.
+    bool _deviceDiscovery;
+
+    /// Specifies whether the discovery is driven by the Home Assistant's birth message.
+    bool _discoveryOnBirthMessage;
+
+    /// Specifies whether the configuration was published since the boot.
+    bool _configPublished;
+
+    /// Specifies whether the device types need to skip publishing of the configuration.
+    bool _configSuppressed;
+
+    /// Specifies whether the persistent MQTT session is enabled.
+    bool _persistentSession;
+
+    /// Specifies whether the device subscribes a single wildcard topic instead of topics of device types.
+    bool _wildcardSubscription;
+
+    /// Specifies whether the device types need to skip subscribing of their topics.
+    bool _resubscriptionSuppressed;
+
     /// The username used for the authentication. It's set in the HAMqtt::begin method.
     const char* _username;
 
@@ -447,6 +1263,108 @@ private:
     /// Time of the last connection attemps (milliseconds since boot).
     uint32_t _lastConnectionAttemptAt;
 
+    /// The minimum delay between connection attempts (milliseconds).
+    uint32_t _reconnectMinDelay;
+
+    /// The maximum delay between connection attempts (milliseconds).
+    uint32_t _reconnectMaxDelay;
+
+    /// The multiplier of the delay applied after each failed attempt.
+    uint8_t _reconnectMultiplier;
+
+    /// The maximum part of the delay (percent) that's randomly subtracted from it.
+    uint8_t _reconnectJitter;
+
+    /// The delay before applying the jitter (milliseconds). It's `0` if no attempt has failed yet.
+    uint32_t _reconnectBaseDelay;
+
+    /// The delay that needs to elapse before the next connection attempt (milliseconds).
+    uint32_t _reconnectDelay;
+
+    /// The number of connection attempts made since the last successful connection.
+    uint16_t _connectionAttemptsNb;
+
+    /// The state of the random generator. It's seeded with the unique ID of the device on the first use.
+    uint32_t _randomState;
+
+    /// The bitset of device types whose states changed while they couldn't be published. It's nullptr if the buffering is disabled.
+    uint8_t* _dirtyDevicesTypes;
+
+    /// Specifies whether states of all device types were published since the boot.
+    bool _statesPublished;
+
+    /// Specifies whether the device types need to skip publishing of their states.
+    bool _statePublishingSuppressed;
+
+    /// Time of waiting for the retained states (milliseconds). It's `0` if the restore is disabled.
+    uint16_t _stateRestoreWindow;
+
+    /// Specifies whether the device types accept the retained values of their state topics.
+    bool _stateRestoreActive;
+
+    /// Specifies whether the states were restored since the boot.
+    bool _stateRestoreDone;
+
+    /// Time when the window of restoring states started (milliseconds since boot).
+    uint32_t _stateRestoreStartedAt;
+
+    /// The storage of the configurations' hashes. It's nullptr if all configurations need to be published.
+    HAStorage* _configStorage;
+
+    /// Specifies whether the configurations need to be published regardless of their hashes.
+    bool _configPublishingForced;
+
+    /// The number of configurations that were not published because they were unchanged.
+    uint16_t _skippedConfigsNb;
+
+    /// Specifies whether the paced discovery is enabled.
+    bool _pacedDiscovery;
+
+    /// The maximum number of device types announced in a single loop cycle.
+    uint8_t _discoveryEntitiesLimit;
+
+    /// The maximum number of bytes published by the discovery in a single loop cycle.
+    uint16_t _discoveryBytesLimit;
+
+    /// The maximum time (microseconds) spent on the discovery in a single loop cycle.
+    uint32_t _discoveryTimeLimit;
+
+    /// Specifies whether some device types still need to be announced.
+    bool _discoveryPending;
+
+    /// Index of the next device type to announce.
+    uint8_t _discoveryIndex;
+
+    /// Specifies whether the HAMqtt::publishAndDisconnect sequence is in progress.
+    bool _singleShot;
+
+    /// Specifies whether the HAMqtt::publishAndDisconnect sequence publishes the configuration of device types.
+    bool _singleShotDiscovery;
+
+    /// Specifies whether the device type that's being announced needs to skip subscribing of its topics.
+    bool _subscriptionSuppressed;
+
+    /// The number of bytes (topics and payloads) published since the boot.
+    uint32_t _publishedBytesNb;
+
+    /// The hostname of the MQTT broker. It's nullptr if the IP address is used.
+    const char* _serverHostname;
+
+    /// The IP address of the MQTT broker.
+    IPAddress _serverIp;
+
+    /// The port of the MQTT broker.
+    uint16_t _serverPort;
+
+    /// Specifies whether the phased connection is enabled.
+    bool _phasedConnection;
+
+    /// The current phase of the connection with the MQTT broker.
+    ConnectionPhase _connectionPhase;
+
+    /// Specifies whether the network phase failed. The state isn't synchronized with the MQTT client until the next attempt.
+    bool _connectionFailed;
+
     /// The amount of registered devices types.
     uint8_t _devicesTypesNb;
 
@@ -456,6 +1374,12 @@ private:
     /// Pointers of all registered devices types (array of pointers).
     HABaseDeviceType** _devicesTypes;
 
+    /// The number of slots in the routing index (power of two).
+    uint16_t _devicesTypesIndexSize;
+
+    /// The open addressing hash table of object IDs. Each slot holds the index of the device type + 1 (0 means an empty slot).
+    uint8_t* _devicesTypesIndex;
+
     /// The last will topic set by HAMqtt::setLastWill
     const char* _lastWillTopic;
 
@@ -467,6 +1391,56 @@ private:
 
     /// The last known state of the MQTT connection.
     ConnectionState _currentState;
+
+#ifdef ARDUINOHA_TOPIC_CACHE
+    /// The cache of the data topics. It's nullptr if the cache is disabled.
+    HATopicCache* _topicCache;
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+    /// The outbound queue of the data messages. It's nullptr if the queue is disabled.
+    HAPublishQueue* _publishQueue;
+
+    /// The minimum interval between drains of the queue (milliseconds).
+    uint16_t _publishQueueDrainInterval;
+
+    /// The maximum number of messages published in a single drain.
+    uint8_t _publishQueueDrainLimit;
+
+    /// Time of the last drain of the queue (milliseconds since boot).
+    uint32_t _publishQueueDrainedAt;
+#endif
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /// The scheduler of the publish policies. It's nullptr if no policy was set.
+    HATimerWheel* _publishScheduler;
+#endif
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    /// The batch of subscriptions. It's nullptr if the batching is disabled.
+    HASubscriptionBatch* _subscriptionBatch;
+
+    /// Specifies whether subscriptions are collected in the batch at the moment.
+    bool _subscriptionsBatched;
+
+    /// The identifier of the last batched SUBSCRIBE packet. It's used only with PubSubClient (other clients assign identifiers on their own).
+    uint16_t _subscriptionPacketId;
+#endif
+
+    /// The write-combining buffer of the payloads. It's nullptr if the buffer is disabled.
+    uint8_t* _payloadBuffer;
+
+    /// Size of the payload buffer (bytes).
+    uint16_t _payloadBufferSize;
+
+    /// The number of bytes that are waiting in the payload buffer.
+    uint16_t _payloadBufferLength;
+
+    /// The number of fragments written to the payload buffer.
+    uint32_t _payloadFragmentsNb;
+
+    /// The number of writes of the payload buffer to the network client.
+    uint32_t _payloadWritesNb;
 };
 
 #endif
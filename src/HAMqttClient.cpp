@@ -0,0 +1,814 @@
+#include "HAMqttClient.h"
+
+/// Length of the CONNECT packet's variable header for MQTT 3.1.1.
+static const uint8_t ConnectHeaderLength = 10;
+
+HAMqttClient::HAMqttClient(Client& client) :
+    _client(&client),
+    _domain(nullptr),
+    _port(0),
+    _callback(nullptr),
+    _keepAlive(15),
+    _socketTimeout(15),
+    _state(StateDisconnected),
+    _sessionPresent(false),
+    _connackPending(false),
+    _connectStartedAt(0),
+    _pingOutstanding(false),
+    _lastOutActivity(0),
+    _lastInActivity(0),
+    _packetId(0),
+    _rxBuffer(new uint8_t[DefaultBufferSize]),
+    _rxBufferSize(DefaultBufferSize),
+    _rxPhase(RxPhaseHeader),
+    _rxHeader(0),
+    _rxLength(0),
+    _rxLengthMultiplier(1),
+    _rxPosition(0),
+    _txLength(0),
+    _txFailed(false),
+    _inflightMessages(nullptr),
+    _inflightData(nullptr),
+    _inflightWindowSize(0),
+    _inflightPacketSize(0),
+    _retryInterval(0),
+    _maxRetries(0),
+    _capturedMessage(nullptr),
+    _retriedMessagesNb(0),
+    _droppedMessagesNb(0)
+{
+
+}
+
+HAMqttClient::~HAMqttClient()
+{
+    delete[] _rxBuffer;
+    delete[] _inflightMessages;
+    delete[] _inflightData;
+}
+
+HAMqttClient& HAMqttClient::setServer(IPAddress ip, uint16_t port)
+{
+    _ip = ip;
+    _port = port;
+    _domain = nullptr;
+    return *this;
+}
+
+HAMqttClient& HAMqttClient::setServer(const char* domain, uint16_t port)
+{
+    _domain = domain;
+    _port = port;
+    return *this;
+}
+
+HAMqttClient& HAMqttClient::setCallback(HAMQTTCLIENT_CALLBACK(callback))
+{
+    _callback = callback;
+    return *this;
+}
+
+bool HAMqttClient::setInflightWindow(
+    const uint8_t windowSize,
+    const uint16_t maxPacketSize,
+    const uint16_t retryInterval,
+    const uint8_t maxRetries
+)
+{
+    delete[] _inflightMessages;
+    delete[] _inflightData;
+    _inflightMessages = nullptr;
+    _inflightData = nullptr;
+    _inflightWindowSize = 0;
+    _capturedMessage = nullptr;
+
+    if (windowSize == 0 || maxPacketSize == 0) {
+        return false;
+    }
+
+    _inflightMessages = new InflightMessage[windowSize]();
+    _inflightData = new uint8_t[(uint32_t)windowSize * maxPacketSize];
+    _inflightWindowSize = windowSize;
+    _inflightPacketSize = maxPacketSize;
+    _retryInterval = retryInterval;
+    _maxRetries = maxRetries;
+
+    return true;
+}
+
+uint8_t HAMqttClient::getInflightMessagesNb() const
+{
+    uint8_t messagesNb = 0;
+    for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+        if (_inflightMessages[i].packetId != 0) {
+            messagesNb++;
+        }
+    }
+
+    return messagesNb;
+}
+
+bool HAMqttClient::setBufferSize(uint16_t size)
+{
+    if (size == 0) {
+        return false;
+    }
+
+    uint8_t* buffer = new uint8_t[size];
+    if (!buffer) {
+        return false;
+    }
+
+    delete[] _rxBuffer;
+    _rxBuffer = buffer;
+    _rxBufferSize = size;
+    resetParser(); // the packet that's being parsed is lost
+
+    return true;
+}
+
+bool HAMqttClient::connect(
+    const char* id,
+    const char* user,
+    const char* pass,
+    const char* willTopic,
+    uint8_t willQos,
+    bool willRetain,
+    const char* willMessage,
+    bool cleanSession
+)
+{
+    if (connected()) {
+        return true;
+    }
+
+    if (!beginConnect(id, user, pass, willTopic, willQos, willRetain, willMessage, cleanSession)) {
+        return false;
+    }
+
+    while (!pollConnack() && _connackPending) {
+        delay(1);
+    }
+
+    return _state == StateConnected;
+}
+
+bool HAMqttClient::beginConnect(
+    const char* id,
+    const char* user,
+    const char* pass,
+    const char* willTopic,
+    uint8_t willQos,
+    bool willRetain,
+    const char* willMessage,
+    bool cleanSession
+)
+{
+    if (connected()) {
+        return true;
+    }
+
+    if (!id) {
+        return false;
+    }
+
+    if (!_client->connected()) {
+        const int result = _domain
+            ? _client->connect(_domain, _port)
+            : _client->connect(_ip, _port);
+
+        if (result != 1) {
+            _state = StateConnectFailed;
+            return false;
+        }
+    }
+
+    _state = StateDisconnected;
+    _sessionPresent = false;
+    _pingOutstanding = false;
+    _txLength = 0;
+    _txFailed = false;
+    resetParser();
+
+    const bool hasWill = willTopic && willMessage;
+    uint8_t flags = cleanSession ? 0x02 : 0x00;
+    uint32_t length = ConnectHeaderLength + 2 + strlen(id);
+
+    if (hasWill) {
+        flags |= 0x04 | ((willQos & 0x03) << 3) | (willRetain ? 0x20 : 0x00);
+        length += 2 + strlen(willTopic) + 2 + strlen(willMessage);
+    }
+
+    if (user) {
+        flags |= 0x80;
+        length += 2 + strlen(user);
+
+        if (pass) {
+            flags |= 0x40;
+            length += 2 + strlen(pass);
+        }
+    }
+
+    writeHeader(PacketConnect << 4, length);
+    writeString("MQTT");
+    writeByte(0x04); // protocol level of MQTT 3.1.1
+    writeByte(flags);
+    writeUInt16(_keepAlive);
+    writeString(id);
+
+    if (hasWill) {
+        writeString(willTopic);
+        writeString(willMessage);
+    }
+
+    if (user) {
+        writeString(user);
+
+        if (pass) {
+            writeString(pass);
+        }
+    }
+
+    if (!flush()) {
+        close(StateConnectFailed);
+        return false;
+    }
+
+    _connackPending = true;
+    _connectStartedAt = millis();
+    _lastInActivity = _connectStartedAt;
+
+    return true;
+}
+
+bool HAMqttClient::pollConnack()
+{
+    if (!_connackPending) {
+        return connected();
+    }
+
+    if (!_client->connected()) {
+        close(StateConnectFailed);
+        return false;
+    }
+
+    // the CONNACK packet changes the state
+    readPackets();
+
+    if (_state == StateDisconnected) {
+        if ((millis() - _connectStartedAt) >= _socketTimeout * 1000UL) {
+            close(StateConnectionTimeout);
+        }
+
+        return false;
+    }
+
+    _connackPending = false;
+
+    if (_state != StateConnected) {
+        close(_state); // the broker refused the connection
+        return false;
+    }
+
+    // unacknowledged messages are retransmitted only if the broker resumed the session
+    for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+        if (!_sessionPresent) {
+            _inflightMessages[i].packetId = 0;
+        } else {
+            _inflightMessages[i].sentAt = millis() - _retryInterval;
+        }
+    }
+
+    return true;
+}
+
+void HAMqttClient::disconnect()
+{
+    if (_client->connected()) {
+        writeHeader(PacketDisconnect << 4, 0);
+        flush();
+        _client->flush();
+    }
+
+    close(StateDisconnected);
+}
+
+bool HAMqttClient::connected()
+{
+    if (!_client->connected()) {
+        if (_state == StateConnected) {
+            close(StateConnectionLost);
+        }
+
+        return false;
+    }
+
+    return _state == StateConnected;
+}
+
+bool HAMqttClient::loop()
+{
+    if (!connected()) {
+        return false;
+    }
+
+    const uint32_t now = millis();
+    const uint32_t keepAlive = _keepAlive * 1000UL;
+
+    if (
+        keepAlive > 0 &&
+        ((now - _lastOutActivity) >= keepAlive || (now - _lastInActivity) >= keepAlive)
+    ) {
+        if (_pingOutstanding) {
+            close(StateConnectionTimeout);
+            return false;
+        }
+
+        writeHeader(PacketPingReq << 4, 0);
+        flush();
+
+        _pingOutstanding = true;
+        _lastInActivity = now;
+    }
+
+    readPackets();
+
+    // retransmitted data can't be mixed with the unfinished message
+    if (_inflightWindowSize > 0 && !_capturedMessage) {
+        retransmitMessages();
+    }
+
+    return connected();
+}
+
+bool HAMqttClient::beginPublish(const char* topic, uint32_t length, bool retained, uint8_t qos)
+{
+    if (!topic || !connected()) {
+        return false;
+    }
+
+    abortCapture(); // leftovers of the unfinished message
+    const uint32_t topicLength = strlen(topic);
+
+    // messages that don't fit in the slot are published with QoS 0
+    if (
+        qos > 0 &&
+        _inflightWindowSize > 0 &&
+        2 + topicLength + 2 + length <= _inflightPacketSize
+    ) {
+        InflightMessage* message = nullptr;
+        for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+            if (_inflightMessages[i].packetId == 0) {
+                message = &_inflightMessages[i];
+                break;
+            }
+        }
+
+        if (!message) {
+            _droppedMessagesNb++;
+            return false;
+        }
+
+        writeHeader((PacketPublish << 4) | 0x02 | (retained ? 0x01 : 0x00), 2 + topicLength + 2 + length);
+
+        message->packetId = nextPacketId();
+        message->length = 0;
+        message->retriesNb = 0;
+        message->retained = retained;
+
+        // the body of the packet is stored in the slot, so it can be retransmitted
+        _capturedMessage = message;
+        writeString(topic);
+        writeUInt16(message->packetId);
+
+        return true;
+    }
+
+    writeHeader((PacketPublish << 4) | (retained ? 0x01 : 0x00), 2 + topicLength + length);
+    writeString(topic);
+
+    return true;
+}
+
+size_t HAMqttClient::write(const uint8_t* data, size_t length)
+{
+    if (!data || length == 0 || _txFailed) {
+        return 0;
+    }
+
+    if (length > static_cast<size_t>(TxBufferSize - _txLength)) {
+        flush();
+    }
+
+    // big chunks (e.g. images) are sent without copying
+    if (length >= TxBufferSize) {
+        if (_capturedMessage) {
+            captureData(data, length);
+        }
+
+        const size_t writtenLength = _client->write(data, length);
+        _lastOutActivity = millis();
+
+        if (writtenLength != length) {
+            failTransmission();
+        }
+
+        return writtenLength;
+    }
+
+    memcpy(&_txBuffer[_txLength], data, length);
+    _txLength += length;
+
+    if (_capturedMessage) {
+        captureData(data, length);
+    }
+
+    return length;
+}
+
+size_t HAMqttClient::print(const __FlashStringHelper* data)
+{
+    if (!data) {
+        return 0;
+    }
+
+    const char* src = reinterpret_cast<const char*>(data);
+    size_t length = 0;
+    uint8_t value = pgm_read_byte(src);
+
+    while (value != 0) {
+        writeByte(value);
+        length++;
+        value = pgm_read_byte(++src);
+    }
+
+    return length;
+}
+
+int HAMqttClient::endPublish()
+{
+    if (_capturedMessage) {
+        _capturedMessage->sentAt = millis();
+        _capturedMessage = nullptr;
+    }
+
+    return flush() ? 1 : 0;
+}
+
+bool HAMqttClient::subscribe(const char* topic)
+{
+    if (!topic || topic[0] == 0 || !connected()) {
+        return false;
+    }
+
+    writeHeader((PacketSubscribe << 4) | 0x02, 2 + 2 + strlen(topic) + 1);
+    writeUInt16(nextPacketId());
+    writeString(topic);
+    writeByte(0); // QoS 0
+
+    return flush();
+}
+
+bool HAMqttClient::unsubscribe(const char* topic)
+{
+    if (!topic || topic[0] == 0 || !connected()) {
+        return false;
+    }
+
+    writeHeader((PacketUnsubscribe << 4) | 0x02, 2 + 2 + strlen(topic));
+    writeUInt16(nextPacketId());
+    writeString(topic);
+
+    return flush();
+}
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+bool HAMqttClient::writePacket(const uint8_t* packet, uint16_t length)
+{
+    if (!connected()) {
+        return false;
+    }
+
+    write(packet, length);
+    return flush();
+}
+#endif
+
+void HAMqttClient::readPackets()
+{
+    while (_client->available() > 0) {
+        if (_rxPhase == RxPhaseBody) {
+            if (_rxPosition < _rxBufferSize) {
+                // the body is read in chunks directly to the buffer
+                uint32_t chunkLength = _rxLength - _rxPosition;
+                if (chunkLength > static_cast<uint32_t>(_rxBufferSize - _rxPosition)) {
+                    chunkLength = _rxBufferSize - _rxPosition;
+                }
+
+                const int readLength = _client->read(&_rxBuffer[_rxPosition], chunkLength);
+                if (readLength <= 0) {
+                    return;
+                }
+
+                _rxPosition += readLength;
+            } else {
+                // the packet doesn't fit in the buffer, so the remaining bytes are skipped
+                if (_client->read() < 0) {
+                    return;
+                }
+
+                _rxPosition++;
+            }
+
+            _lastInActivity = millis();
+
+            if (_rxPosition >= _rxLength) {
+                handlePacket();
+                resetParser();
+            }
+
+            continue;
+        }
+
+        const int value = _client->read();
+        if (value < 0) {
+            return;
+        }
+
+        _lastInActivity = millis();
+
+        if (_rxPhase == RxPhaseHeader) {
+            _rxHeader = value;
+            _rxPhase = RxPhaseLength;
+            continue;
+        }
+
+        // the remaining length is encoded using the variable length encoding
+        _rxLength += (value & 0x7F) * _rxLengthMultiplier;
+        _rxLengthMultiplier *= 128;
+
+        if (value & 0x80) {
+            if (_rxLengthMultiplier > 128UL * 128 * 128) {
+                close(StateConnectionLost); // malformed packet
+                return;
+            }
+
+            continue;
+        }
+
+        if (_rxLength == 0) {
+            handlePacket();
+            resetParser();
+        } else {
+            _rxPhase = RxPhaseBody;
+        }
+    }
+}
+
+void HAMqttClient::handlePacket()
+{
+    if (_rxLength > _rxBufferSize) {
+        return; // the packet was too big
+    }
+
+    switch (_rxHeader >> 4) {
+        case PacketConnAck:
+            if (_rxLength >= 2) {
+                _sessionPresent = (_rxBuffer[0] & 0x01);
+                _state = (_rxBuffer[1] == 0) ? static_cast<int>(StateConnected) : _rxBuffer[1];
+            }
+            break;
+
+        case PacketPublish:
+            handlePublish();
+            break;
+
+        case PacketPingReq:
+            writeHeader(PacketPingResp << 4, 0);
+            flush();
+            break;
+
+        case PacketPingResp:
+            _pingOutstanding = false;
+            break;
+
+        case PacketPubAck:
+            if (_rxLength >= 2) {
+                acknowledgeMessage((_rxBuffer[0] << 8) | _rxBuffer[1]);
+            }
+            break;
+
+        default:
+            break; // SUBACK and UNSUBACK packets are not tracked
+    }
+}
+
+void HAMqttClient::handlePublish()
+{
+    if (_rxLength < 2) {
+        return;
+    }
+
+    const uint8_t qos = (_rxHeader >> 1) & 0x03;
+    const uint16_t topicLength = (_rxBuffer[0] << 8) | _rxBuffer[1];
+    const uint32_t payloadOffset = 2 + topicLength + (qos > 0 ? 2 : 0);
+
+    if (payloadOffset > _rxLength) {
+        return; // malformed packet
+    }
+
+    uint16_t packetId = 0;
+    if (qos > 0) {
+        packetId = (_rxBuffer[2 + topicLength] << 8) | _rxBuffer[2 + topicLength + 1];
+    }
+
+    // the topic is moved to the beginning of the buffer, so it can be null terminated
+    memmove(_rxBuffer, &_rxBuffer[2], topicLength);
+    _rxBuffer[topicLength] = 0;
+
+    if (_callback) {
+        _callback(
+            reinterpret_cast<char*>(_rxBuffer),
+            &_rxBuffer[payloadOffset],
+            _rxLength - payloadOffset
+        );
+    }
+
+    if (qos == 1) {
+        writeHeader(PacketPubAck << 4, 2);
+        writeUInt16(packetId);
+        flush();
+    }
+}
+
+void HAMqttClient::acknowledgeMessage(const uint16_t packetId)
+{
+    for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+        if (_inflightMessages[i].packetId == packetId) {
+            _inflightMessages[i].packetId = 0;
+            return;
+        }
+    }
+}
+
+void HAMqttClient::retransmitMessages()
+{
+    const uint32_t now = millis();
+
+    for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+        InflightMessage* message = &_inflightMessages[i];
+        if (
+            message->packetId == 0 ||
+            (now - message->sentAt) < _retryInterval
+        ) {
+            continue;
+        }
+
+        if (message->retriesNb >= _maxRetries) {
+            message->packetId = 0;
+            _droppedMessagesNb++;
+            continue;
+        }
+
+        writeHeader((PacketPublish << 4) | 0x08 | 0x02 | (message->retained ? 0x01 : 0x00), message->length); // with the DUP flag
+        write(getInflightData(message), message->length);
+        flush();
+
+        message->sentAt = now;
+        message->retriesNb++;
+        _retriedMessagesNb++;
+    }
+}
+
+void HAMqttClient::captureData(const uint8_t* data, const size_t length)
+{
+    if (_capturedMessage->length + length > _inflightPacketSize) {
+        return; // the length was verified in HAMqttClient::beginPublish
+    }
+
+    memcpy(getInflightData(_capturedMessage) + _capturedMessage->length, data, length);
+    _capturedMessage->length += length;
+}
+
+void HAMqttClient::resetParser()
+{
+    _rxPhase = RxPhaseHeader;
+    _rxHeader = 0;
+    _rxLength = 0;
+    _rxLengthMultiplier = 1;
+    _rxPosition = 0;
+}
+
+uint16_t HAMqttClient::nextPacketId()
+{
+    bool inUse = true;
+
+    while (inUse) {
+        if (++_packetId == 0) {
+            _packetId = 1;
+        }
+
+        // identifiers of in-flight messages can't be reused
+        inUse = false;
+        for (uint8_t i = 0; i < _inflightWindowSize; i++) {
+            if (_inflightMessages[i].packetId == _packetId) {
+                inUse = true;
+                break;
+            }
+        }
+    }
+
+    return _packetId;
+}
+
+void HAMqttClient::writeHeader(const uint8_t header, uint32_t length)
+{
+    // the packet starts on the healthy connection, a failure of the previous packet closed it
+    _txFailed = false;
+    writeByte(header);
+
+    do {
+        uint8_t digit = length % 128;
+        length /= 128;
+
+        if (length > 0) {
+            digit |= 0x80;
+        }
+
+        writeByte(digit);
+    } while (length > 0);
+}
+
+void HAMqttClient::writeString(const char* data)
+{
+    const uint16_t length = strlen(data);
+
+    writeUInt16(length);
+    write(reinterpret_cast<const uint8_t*>(data), length);
+}
+
+void HAMqttClient::writeUInt16(const uint16_t value)
+{
+    writeByte(value >> 8);
+    writeByte(value & 0xFF);
+}
+
+void HAMqttClient::writeByte(const uint8_t value)
+{
+    if (_txFailed) {
+        return;
+    }
+
+    if (_txLength >= TxBufferSize) {
+        flush();
+    }
+
+    _txBuffer[_txLength++] = value;
+
+    if (_capturedMessage) {
+        captureData(&value, 1);
+    }
+}
+
+bool HAMqttClient::flush()
+{
+    if (_txLength > 0) {
+        const size_t writtenLength = _client->write(_txBuffer, _txLength);
+        const bool failed = (writtenLength != _txLength);
+
+        _txLength = 0;
+        _lastOutActivity = millis();
+
+        if (failed) {
+            failTransmission();
+        }
+    }
+
+    return !_txFailed;
+}
+
+void HAMqttClient::failTransmission()
+{
+    // the remaining part of the packet can't be sent, so the stream is broken
+    close(StateConnectionLost);
+    _txFailed = true;
+}
+
+void HAMqttClient::abortCapture()
+{
+    if (_capturedMessage) {
+        _capturedMessage->packetId = 0;
+        _capturedMessage = nullptr;
+    }
+}
+
+void HAMqttClient::close(const int state)
+{
+    abortCapture();
+    _client->stop();
+    _state = state;
+    _connackPending = false;
+    _pingOutstanding = false;
+    _txLength = 0;
+    resetParser();
+}
@@ -0,0 +1,541 @@
+#ifndef AHA_HAMQTTCLIENT_H
+#define AHA_HAMQTTCLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+#include "ArduinoHADefines.h"
+
+#define HAMQTTCLIENT_CALLBACK(name) void (*name)(char* topic, uint8_t* payload, unsigned int length)
+
+/**
+ * HAMqttClient is a built-in MQTT 3.1.1 client that can be used by HAMqtt instead of PubSubClient.
+ * It's enabled by defining the `ARDUINOHA_NATIVE_MQTT` macro (see ArduinoHADefines.h).
+ *
+ * Incoming packets are parsed incrementally, so the loop never waits for the remaining bytes of a packet.
+ * Outgoing packets are streamed to the network client through a small scratch buffer, so the payload
+ * of a message doesn't need to fit in memory. Incoming and outgoing data use separate buffers,
+ * which means that messages can be published from the message callback.
+ * The public API mirrors the subset of PubSubClient's API used by HAMqtt.
+ */
+class HAMqttClient
+{
+public:
+    /// States of the client. The values match states of PubSubClient (and HAMqtt::ConnectionState).
+    enum State {
+        StateConnectionTimeout = -4,
+        StateConnectionLost = -3,
+        StateConnectFailed = -2,
+        StateDisconnected = -1,
+        StateConnected = 0
+    };
+
+    /// The default size of the buffer for incoming packets (bytes).
+    static const uint16_t DefaultBufferSize = 256;
+
+    /// Size of the scratch buffer for outgoing packets (bytes).
+    static const uint8_t TxBufferSize = 64;
+
+    /**
+     * Creates a new instance of the client.
+     *
+     * @param client The network client that's going to be used for the communication.
+     */
+    explicit HAMqttClient(Client& client);
+
+    /**
+     * Frees the memory allocated by the client.
+     */
+    ~HAMqttClient();
+
+    /**
+     * Sets the address of the broker using the IP address.
+     *
+     * @param ip The IP address of the broker.
+     * @param port The port of the broker.
+     */
+    HAMqttClient& setServer(IPAddress ip, uint16_t port);
+
+    /**
+     * Sets the address of the broker using the hostname.
+     *
+     * @param domain The hostname of the broker.
+     * @param port The port of the broker.
+     */
+    HAMqttClient& setServer(const char* domain, uint16_t port);
+
+    /**
+     * Sets the callback that's called for each received PUBLISH packet.
+     * The topic and the payload are valid only during the call.
+     *
+     * @param callback The callback.
+     */
+    HAMqttClient& setCallback(HAMQTTCLIENT_CALLBACK(callback));
+
+    /**
+     * Sets the keep alive interval (seconds) sent in the CONNECT packet.
+     */
+    inline void setKeepAlive(uint16_t keepAlive)
+        { _keepAlive = keepAlive; }
+
+    /**
+     * Sets the maximum time (seconds) of waiting for the CONNACK packet.
+     */
+    inline void setSocketTimeout(uint16_t timeout)
+        { _socketTimeout = timeout; }
+
+    /**
+     * Enables publishing with QoS 1. Messages published with QoS 1 are kept in the in-flight window
+     * until the broker acknowledges them. Unacknowledged messages are retransmitted by the HAMqttClient::loop method.
+     * Calling this method again replaces the existing window (in-flight messages are dropped).
+     * After reconnecting, in-flight messages are retransmitted only if the broker resumed the previous session.
+     *
+     * @param windowSize The maximum number of unacknowledged messages.
+     * @param maxPacketSize The maximum size of a single message (topic and payload) kept in the window (bytes).
+     *                      Bigger messages are published with QoS 0.
+     * @param retryInterval Time (milliseconds) of waiting for the acknowledgment before the message is retransmitted.
+     * @param maxRetries The maximum number of retransmissions. The message is dropped afterwards.
+     * @returns Returns `true` if the window has been allocated.
+     */
+    bool setInflightWindow(
+        const uint8_t windowSize,
+        const uint16_t maxPacketSize,
+        const uint16_t retryInterval,
+        const uint8_t maxRetries
+    );
+
+    /**
+     * Returns the number of messages that wait for the acknowledgment.
+     */
+    uint8_t getInflightMessagesNb() const;
+
+    /**
+     * Returns the number of retransmissions of QoS 1 messages.
+     */
+    inline uint32_t getRetriedMessagesNb() const
+        { return _retriedMessagesNb; }
+
+    /**
+     * Returns the number of QoS 1 messages that were dropped because the window was full
+     * or because they were not acknowledged after the maximum number of retransmissions.
+     */
+    inline uint32_t getDroppedMessagesNb() const
+        { return _droppedMessagesNb; }
+
+    /**
+     * Sets size of the buffer for incoming packets.
+     * Packets bigger than the buffer are dropped. Outgoing packets are not limited by this size.
+     *
+     * @param size The size of the buffer (bytes).
+     * @returns Returns `true` if the buffer was allocated.
+     */
+    bool setBufferSize(uint16_t size);
+
+    /**
+     * Returns size of the buffer for incoming packets (bytes).
+     */
+    inline uint16_t getBufferSize() const
+        { return _rxBufferSize; }
+
+    /**
+     * Opens the network connection (if it's not opened yet), sends the CONNECT packet and waits for the CONNACK packet.
+     *
+     * @param id The client ID.
+     * @param user The username. It can be nullptr.
+     * @param pass The password. It can be nullptr. It's skipped if the username is not set.
+     * @param willTopic The topic of the last will message. It can be nullptr.
+     * @param willQos QoS of the last will message.
+     * @param willRetain Specifies whether the last will message should be retained.
+     * @param willMessage The last will message. It can be nullptr.
+     * @param cleanSession Specifies whether the broker should discard the previous session.
+     */
+    bool connect(
+        const char* id,
+        const char* user,
+        const char* pass,
+        const char* willTopic,
+        uint8_t willQos,
+        bool willRetain,
+        const char* willMessage,
+        bool cleanSession
+    );
+
+    /**
+     * Opens the network connection (if it's not opened yet) and sends the CONNECT packet without waiting for the CONNACK packet.
+     * The CONNACK packet needs to be awaited using HAMqttClient::pollConnack.
+     * The parameters are the same as for HAMqttClient::connect.
+     *
+     * @returns Returns `false` if the network connection couldn't be opened or the packet wasn't sent.
+     */
+    bool beginConnect(
+        const char* id,
+        const char* user,
+        const char* pass,
+        const char* willTopic,
+        uint8_t willQos,
+        bool willRetain,
+        const char* willMessage,
+        bool cleanSession
+    );
+
+    /**
+     * Processes the available incoming bytes of the connection started by HAMqttClient::beginConnect.
+     * The connection is closed with StateConnectionTimeout if the CONNACK packet doesn't arrive
+     * within the socket timeout (see HAMqttClient::setSocketTimeout).
+     *
+     * @returns Returns `true` if the client is connected to the broker.
+     */
+    bool pollConnack();
+
+    /**
+     * Returns `true` if the CONNECT packet was sent and the CONNACK packet is awaited.
+     */
+    inline bool isConnecting() const
+        { return _connackPending; }
+
+    /**
+     * Sends the DISCONNECT packet and closes the network connection.
+     */
+    void disconnect();
+
+    /**
+     * Returns `true` if the client is connected to the broker.
+     * The state is changed to StateConnectionLost if the network connection was closed.
+     */
+    bool connected();
+
+    /**
+     * Returns the current state of the client (see HAMqttClient::State).
+     * Positive values are the return codes of the CONNACK packet.
+     */
+    inline int state() const
+        { return _state; }
+
+    /**
+     * Returns the session present flag of the last CONNACK packet.
+     */
+    inline bool isSessionPresent() const
+        { return _sessionPresent; }
+
+    /**
+     * Handles the keep alive and processes the available incoming bytes.
+     * This method needs to be called periodically.
+     *
+     * @returns Returns `true` if the client is still connected.
+     */
+    bool loop();
+
+    /**
+     * Starts the PUBLISH packet. The payload needs to be written using HAMqttClient::write
+     * and HAMqttClient::print methods, and the packet needs to be finished by calling HAMqttClient::endPublish.
+     *
+     * @param topic The topic of the message.
+     * @param length The total length of the payload (bytes).
+     * @param retained Specifies whether the message should be retained.
+     * @param qos QoS of the message (0 or 1). QoS 1 requires the in-flight window (see HAMqttClient::setInflightWindow).
+     * @returns Returns `false` if the client is not connected or the in-flight window is full.
+     */
+    bool beginPublish(const char* topic, uint32_t length, bool retained, uint8_t qos = 0);
+
+    /**
+     * Writes the given data to the current packet.
+     *
+     * @param data The data to write.
+     * @param length The length of the data.
+     * @returns The number of written bytes.
+     */
+    size_t write(const uint8_t* data, size_t length);
+
+    /**
+     * Writes the given progmem string to the current packet.
+     *
+     * @param data The progmem string to write.
+     * @returns The number of written bytes.
+     */
+    size_t print(const __FlashStringHelper* data);
+
+    /**
+     * Finishes the PUBLISH packet and sends the buffered data to the network client.
+     *
+     * @returns Returns `1` if the data was sent.
+     */
+    int endPublish();
+
+    /**
+     * Subscribes the given topic with QoS 0.
+     *
+     * @param topic The topic filter.
+     */
+    bool subscribe(const char* topic);
+
+    /**
+     * Unsubscribes the given topic.
+     *
+     * @param topic The topic filter.
+     */
+    bool unsubscribe(const char* topic);
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+    /**
+     * Sends the complete packet prepared by the caller (e.g. the batch of subscriptions).
+     *
+     * @param packet The packet to send.
+     * @param length The length of the packet.
+     */
+    bool writePacket(const uint8_t* packet, uint16_t length);
+#endif
+
+    /**
+     * Returns the identifier for the next packet.
+     * Identifiers of messages waiting for the acknowledgment are skipped, so packets prepared
+     * by the caller (see HAMqttClient::writePacket) can share the identifiers' space with QoS 1 messages.
+     */
+    uint16_t nextPacketId();
+
+private:
+    /// Phases of parsing an incoming packet.
+    enum RxPhase {
+        RxPhaseHeader = 0,
+        RxPhaseLength,
+        RxPhaseBody
+    };
+
+    /// Representation of the QoS 1 message that waits for the acknowledgment.
+    struct InflightMessage {
+        /// The identifier of the packet. The slot is free if it's `0`.
+        uint16_t packetId;
+
+        /// Length of the stored packet's body (topic, packet identifier and payload).
+        uint16_t length;
+
+        /// Time of the last transmission (milliseconds since boot).
+        uint32_t sentAt;
+
+        /// The number of retransmissions.
+        uint8_t retriesNb;
+
+        /// Specifies whether the message is retained.
+        bool retained;
+    };
+
+    /// Types of MQTT control packets.
+    enum PacketType {
+        PacketConnect = 1,
+        PacketConnAck = 2,
+        PacketPublish = 3,
+        PacketPubAck = 4,
+        PacketSubscribe = 8,
+        PacketSubAck = 9,
+        PacketUnsubscribe = 10,
+        PacketUnsubAck = 11,
+        PacketPingReq = 12,
+        PacketPingResp = 13,
+        PacketDisconnect = 14
+    };
+
+    /// The network client passed to the constructor.
+    Client* _client;
+
+    /// The hostname of the broker. It's nullptr if the IP address is used.
+    const char* _domain;
+
+    /// The IP address of the broker.
+    IPAddress _ip;
+
+    /// The port of the broker.
+    uint16_t _port;
+
+    /// The callback for received messages.
+    HAMQTTCLIENT_CALLBACK(_callback);
+
+    /// The keep alive interval (seconds).
+    uint16_t _keepAlive;
+
+    /// The maximum time (seconds) of waiting for the CONNACK packet.
+    uint16_t _socketTimeout;
+
+    /// The current state of the client.
+    int _state;
+
+    /// The session present flag of the last CONNACK packet.
+    bool _sessionPresent;
+
+    /// Specifies whether the CONNACK packet is awaited.
+    bool _connackPending;
+
+    /// Time when the CONNECT packet was sent (milliseconds since boot).
+    uint32_t _connectStartedAt;
+
+    /// Specifies whether the PINGRESP packet is awaited.
+    bool _pingOutstanding;
+
+    /// Time of the last outgoing data (milliseconds since boot).
+    uint32_t _lastOutActivity;
+
+    /// Time of the last incoming data (milliseconds since boot).
+    uint32_t _lastInActivity;
+
+    /// The identifier of the last packet that required one.
+    uint16_t _packetId;
+
+    /// The buffer for incoming packets (the variable header and the payload).
+    uint8_t* _rxBuffer;
+
+    /// Size of the buffer for incoming packets.
+    uint16_t _rxBufferSize;
+
+    /// The current phase of parsing.
+    RxPhase _rxPhase;
+
+    /// The fixed header of the packet that's being parsed.
+    uint8_t _rxHeader;
+
+    /// The remaining length of the packet that's being parsed.
+    uint32_t _rxLength;
+
+    /// The multiplier of the next byte of the remaining length.
+    uint32_t _rxLengthMultiplier;
+
+    /// The number of bytes of the packet's body received so far.
+    uint32_t _rxPosition;
+
+    /// The scratch buffer for outgoing packets.
+    uint8_t _txBuffer[TxBufferSize];
+
+    /// The number of bytes in the scratch buffer.
+    uint8_t _txLength;
+
+    /// Specifies whether a write to the network client failed since the current packet was started.
+    bool _txFailed;
+
+    /// Slots of the in-flight window. It's nullptr if QoS 1 is disabled.
+    InflightMessage* _inflightMessages;
+
+    /// The memory where bodies of in-flight packets are stored (`maxPacketSize` bytes per slot).
+    uint8_t* _inflightData;
+
+    /// The number of slots in the in-flight window.
+    uint8_t _inflightWindowSize;
+
+    /// The maximum size of the packet's body stored in the slot.
+    uint16_t _inflightPacketSize;
+
+    /// Time (milliseconds) of waiting for the acknowledgment.
+    uint16_t _retryInterval;
+
+    /// The maximum number of retransmissions.
+    uint8_t _maxRetries;
+
+    /// The slot that captures the packet that's being written. It's nullptr if the packet is not captured.
+    InflightMessage* _capturedMessage;
+
+    /// The number of retransmissions.
+    uint32_t _retriedMessagesNb;
+
+    /// The number of dropped QoS 1 messages.
+    uint32_t _droppedMessagesNb;
+
+    /**
+     * Reads the available bytes from the network client and handles completed packets.
+     */
+    void readPackets();
+
+    /**
+     * Handles the packet stored in the buffer.
+     */
+    void handlePacket();
+
+    /**
+     * Handles the PUBLISH packet stored in the buffer.
+     */
+    void handlePublish();
+
+    /**
+     * Releases the slot of the acknowledged message.
+     *
+     * @param packetId The identifier of the acknowledged packet.
+     */
+    void acknowledgeMessage(const uint16_t packetId);
+
+    /**
+     * Retransmits the messages that were not acknowledged in time and drops the expired ones.
+     */
+    void retransmitMessages();
+
+    /**
+     * Returns the stored body of the packet from the given slot.
+     *
+     * @param message The slot of the in-flight window.
+     */
+    inline uint8_t* getInflightData(const InflightMessage* message) const
+        { return &_inflightData[(uint32_t)(message - _inflightMessages) * _inflightPacketSize]; }
+
+    /**
+     * Appends the given data to the captured packet.
+     *
+     * @param data The data to append.
+     * @param length The length of the data.
+     */
+    void captureData(const uint8_t* data, const size_t length);
+
+    /**
+     * Releases the slot of the message that was started, but not finished.
+     */
+    void abortCapture();
+
+    /**
+     * Resets the parser, so it waits for the next packet.
+     */
+    void resetParser();
+
+    /**
+     * Writes the fixed header of a packet to the scratch buffer.
+     *
+     * @param header The first byte of the fixed header.
+     * @param length The remaining length of the packet.
+     */
+    void writeHeader(const uint8_t header, uint32_t length);
+
+    /**
+     * Writes the given string with its length (UTF-8 string of MQTT) to the scratch buffer.
+     *
+     * @param data The string to write.
+     */
+    void writeString(const char* data);
+
+    /**
+     * Writes the 16-bit value in the network byte order to the scratch buffer.
+     *
+     * @param value The value to write.
+     */
+    void writeUInt16(const uint16_t value);
+
+    /**
+     * Writes a single byte to the scratch buffer.
+     *
+     * @param value The byte to write.
+     */
+    void writeByte(const uint8_t value);
+
+    /**
+     * Sends the content of the scratch buffer to the network client.
+     *
+     * @returns Returns `false` if any write of the current packet failed.
+     */
+    bool flush();
+
+    /**
+     * Marks the current packet as failed and closes the connection, as the stream can't be continued.
+     * Further writes of the packet are ignored.
+     */
+    void failTransmission();
+
+    /**
+     * Closes the network connection and sets the given state.
+     *
+     * @param state The new state of the client.
+     */
+    void close(const int state);
+};
+
+#endif
@@ -44,7 +44,7 @@ bool HAAlarmControlPanel::setPanelState(const PanelState state, const bool force
         return true;
     }
 
-    if (publishPanelState(state)) {
+    if (holdState(force) || publishPanelState(state) || bufferState()) {
         _panelState = state;
         return true;
     }
@@ -161,10 +161,18 @@ void HAAlarmControlPanel::onMqttConnected()
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 
     if (!_retain) {
-        publishPanelState(_panelState);
+        publishStateOnConnect();
+    }
+}
 
+bool HAAlarmControlPanel::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
 
-    }
+void HAAlarmControlPanel::publishCurrentState()
+{
+    publishPanelState(_panelState);
 }
 
 void HAAlarmControlPanel::onMqttMessage(
@@ -3,6 +3,7 @@
 #include "../HADevice.h"
 #include "../utils/HAUtils.h"
 #include "../utils/HASerializer.h"
+#include "../utils/HAStorage.h"
 
 HABaseDeviceType::HABaseDeviceType(
     const __FlashStringHelper* componentName,
@@ -13,19 +14,77 @@ HABaseDeviceType::HABaseDeviceType(
     _name(nullptr),
     _objectId(nullptr),
     _serializer(nullptr),
+    _qos(0),
+    _stateRestorePending(false),
     _availability(AvailabilityDefault)
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    , _publishPolicy(nullptr)
+#endif
 {
     if (mqtt()) {
         mqtt()->addDeviceType(this);
     }
 }
 
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+HABaseDeviceType::~HABaseDeviceType()
+{
+    if (_publishPolicy) {
+        if (mqtt()) {
+            mqtt()->cancelPublish(_publishPolicy);
+        }
+
+        delete _publishPolicy;
+    }
+}
+#endif
+
 void HABaseDeviceType::setAvailability(bool online)
 {
     _availability = (online ? AvailabilityOnline : AvailabilityOffline);
     publishAvailability();
 }
 
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+
+bool HABaseDeviceType::setPublishInterval(
+    const uint32_t minInterval,
+    const uint32_t maxInterval
+)
+{
+    if (minInterval == 0 && maxInterval == 0) {
+        if (_publishPolicy) {
+            mqtt()->cancelPublish(_publishPolicy);
+            delete _publishPolicy;
+            _publishPolicy = nullptr;
+        }
+
+        return true;
+    }
+
+    if (!hasCurrentState()) {
+        return false; // held changes and the heartbeat can't be published
+    }
+
+    if (!_publishPolicy) {
+        _publishPolicy = new PublishPolicy();
+        _publishPolicy->deviceType = this;
+        _publishPolicy->publishedAt = 0;
+        _publishPolicy->published = false;
+        _publishPolicy->held = false;
+    }
+
+    _publishPolicy->minInterval = minInterval;
+    _publishPolicy->maxInterval = maxInterval;
+
+    if (_publishPolicy->published && !_publishPolicy->held) {
+        markStatePublished(_publishPolicy->publishedAt);
+    }
+
+    return true;
+}
+#endif
+
 HAMqtt* HABaseDeviceType::mqtt()
 {
     return HAMqtt::instance();
@@ -36,6 +95,43 @@ void HABaseDeviceType::subscribeTopic(
     const __FlashStringHelper* topic
 )
 {
+    if (HAMqtt::instance()->isSubscriptionSuppressed()) {
+        return; // the broker holds the subscription of the previous session or the device type can't handle commands
+    }
+
+    changeSubscription(uniqueId, topic, true);
+}
+
+void HABaseDeviceType::unsubscribeTopic(
+    const char* uniqueId,
+    const __FlashStringHelper* topic
+)
+{
+    changeSubscription(uniqueId, topic, false);
+}
+
+void HABaseDeviceType::changeSubscription(
+    const char* uniqueId,
+    const __FlashStringHelper* topic,
+    const bool subscribe
+)
+{
+    uint16_t cachedTopicLength = 0;
+    const char* cachedTopic = HAMqtt::instance()->getCachedDataTopic(
+        uniqueId,
+        topic,
+        cachedTopicLength
+    );
+    if (cachedTopic) {
+        if (subscribe) {
+            HAMqtt::instance()->subscribe(cachedTopic);
+        } else {
+            HAMqtt::instance()->unsubscribe(cachedTopic);
+        }
+
+        return;
+    }
+
     const uint16_t topicLength = HASerializer::calculateDataTopicLength(
         uniqueId,
         topic
@@ -53,7 +149,11 @@ void HABaseDeviceType::subscribeTopic(
         return;
     }
 
-    HAMqtt::instance()->subscribe(fullTopic);
+    if (subscribe) {
+        HAMqtt::instance()->subscribe(fullTopic);
+    } else {
+        HAMqtt::instance()->unsubscribe(fullTopic);
+    }
 }
 
 void HABaseDeviceType::onMqttMessage(
@@ -77,6 +177,10 @@ void HABaseDeviceType::destroySerializer()
 
 void HABaseDeviceType::publishConfig()
 {
+    if (mqtt()->isConfigPublishingSuppressed()) {
+        return; // the config is published by HAMqtt as a part of the device's config or it's not needed
+    }
+
     buildSerializer();
 
     if (_serializer == nullptr) {
@@ -97,15 +201,132 @@ void HABaseDeviceType::publishConfig()
             uniqueId()
         );
 
-        if (mqtt()->beginPublish(topic, dataLength, true)) {
+        HAStorage* storage = mqtt()->getConfigStorage();
+        uint32_t hash = 0;
+        uint32_t storedHash = 0;
+
+        if (storage) {
+            // the topic contains the discovery prefix, so changing the prefix invalidates the hash
+            hash = HAUtils::hash(topic, topicLength - 1, _serializer->calculateHash());
+        }
+
+        if (storage && storage->read(uniqueId(), storedHash) && storedHash == hash) {
+            mqtt()->markConfigSkipped();
+        } else if (mqtt()->beginPublish(topic, dataLength, true)) {
             _serializer->flush();
-            mqtt()->endPublish();
+
+            if (mqtt()->endPublish() && storage) {
+                storage->write(uniqueId(), hash);
+            }
         }
     }
 
     destroySerializer();
 }
 
+void HABaseDeviceType::publishStateOnConnect()
+{
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    if (_publishPolicy) {
+        // the state is up to date after connecting, so held changes are published along with it
+        _publishPolicy->held = false;
+        markStatePublished(millis());
+    }
+#endif
+
+    if (mqtt()->isStateRestoreActive()) {
+        _stateRestorePending = true; // the state is published by HAMqtt when the window ends
+        return;
+    }
+
+    if (mqtt()->isStatePublishingSuppressed()) {
+        return; // the state is published by HAMqtt only if it changed while the device was offline
+    }
+
+    publishCurrentState();
+}
+
+bool HABaseDeviceType::isRestoreMessage(
+    const char* topic,
+    const __FlashStringHelper* stateTopic
+) const
+{
+    return mqtt()->isStateRestoreActive() && HASerializer::compareDataTopics(
+        topic,
+        uniqueId(),
+        stateTopic
+    );
+}
+
+bool HABaseDeviceType::bufferState()
+{
+    return mqtt()->markStateDirty(this);
+}
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+bool HABaseDeviceType::holdState(const bool force)
+{
+    if (!_publishPolicy || !mqtt()->isConnected()) {
+        return false; // the offline buffering takes care of changes made while the device is offline
+    }
+
+    PublishPolicy* policy = _publishPolicy;
+    if (force) {
+        if (!policy->held) {
+            markStatePublished(millis());
+        }
+
+        return false; // the held changes of other attributes are still published by the scheduler
+    }
+
+    if (policy->held) {
+        return true;
+    }
+
+    const uint32_t now = millis();
+    if (policy->published && (now - policy->publishedAt) < policy->minInterval) {
+        policy->held = true;
+        mqtt()->schedulePublish(policy, policy->publishedAt + policy->minInterval);
+        return true;
+    }
+
+    markStatePublished(now);
+    return false;
+}
+
+void HABaseDeviceType::markStatePublished(const uint32_t now)
+{
+    _publishPolicy->published = true;
+    _publishPolicy->publishedAt = now;
+
+    if (_publishPolicy->maxInterval > 0) {
+        mqtt()->schedulePublish(_publishPolicy, now + _publishPolicy->maxInterval);
+    } else {
+        mqtt()->cancelPublish(_publishPolicy);
+    }
+}
+
+void HABaseDeviceType::onPublishTimer()
+{
+    const uint32_t now = millis();
+    const bool held = _publishPolicy->held;
+    _publishPolicy->held = false;
+
+    if (mqtt()->isConnected()) {
+        markStatePublished(now);
+        publishCurrentState();
+    } else {
+        if (held) {
+            bufferState();
+        }
+
+        if (_publishPolicy->maxInterval > 0) {
+            mqtt()->schedulePublish(_publishPolicy, now + _publishPolicy->maxInterval);
+        }
+    }
+}
+#endif
+
 void HABaseDeviceType::publishAvailability()
 {
     const HADevice* device = mqtt()->getDevice();
@@ -175,6 +396,78 @@ bool HABaseDeviceType::publishOnDataTopic(
         return false;
     }
 
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+    if (mqtt()->queueDataMessage(
+        uniqueId(),
+        topic,
+        payload,
+        length,
+        retained,
+        isProgmemData,
+        _qos
+    )) {
+        return true;
+    }
+#endif
+
+    uint16_t cachedTopicLength = 0;
+    const char* cachedTopic = mqtt()->getCachedDataTopic(
+        uniqueId(),
+        topic,
+        cachedTopicLength
+    );
+    if (cachedTopic) {
+        return publishOnTopic(
+            cachedTopic,
+            payload,
+            length,
+            retained,
+            isProgmemData
+        );
+    }
+
+    const uint16_t topicLength = HASerializer::calculateDataTopicLength(
+        uniqueId(),
+        topic
+    );
+    if (topicLength == 0) {
+        return false;
+    }
+
+    char fullTopic[topicLength];
+    if (!HASerializer::generateDataTopic(
+        fullTopic,
+        uniqueId(),
+        topic
+    )) {
+        return false;
+    }
+
+    return publishOnTopic(
+        fullTopic,
+        payload,
+        length,
+        retained,
+        isProgmemData
+    );
+}
+
+bool HABaseDeviceType::beginPublishOnDataTopic(
+    const __FlashStringHelper* topic,
+    const uint32_t length,
+    bool retained
+)
+{
+    uint16_t cachedTopicLength = 0;
+    const char* cachedTopic = mqtt()->getCachedDataTopic(
+        uniqueId(),
+        topic,
+        cachedTopicLength
+    );
+    if (cachedTopic) {
+        return mqtt()->beginPublish(cachedTopic, length, retained, _qos);
+    }
+
     const uint16_t topicLength = HASerializer::calculateDataTopicLength(
         uniqueId(),
         topic
@@ -192,7 +485,18 @@ bool HABaseDeviceType::publishOnDataTopic(
         return false;
     }
 
-    if (mqtt()->beginPublish(fullTopic, length, retained)) {
+    return mqtt()->beginPublish(fullTopic, length, retained, _qos);
+}
+
+bool HABaseDeviceType::publishOnTopic(
+    const char* topic,
+    const uint8_t* payload,
+    const uint16_t length,
+    bool retained,
+    bool isProgmemData
+)
+{
+    if (mqtt()->beginPublish(topic, length, retained, _qos)) {
         if (isProgmemData) {
             mqtt()->writePayload(AHATOFSTR(payload));
         } else {
@@ -203,4 +507,4 @@ bool HABaseDeviceType::publishOnDataTopic(
     }
 
     return false;
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "../ArduinoHADefines.h"
+#include "../utils/HATimerWheel.h"
 
 class HAMqtt;
 class HASerializer;
@@ -37,6 +38,13 @@ public:
         const char* uniqueId
     );
 
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /**
+     * Frees the memory allocated by the publish policy.
+     */
+    ~HABaseDeviceType();
+#endif
+
     /**
      * Returns unique ID of the device type.
      */
@@ -104,6 +112,47 @@ public:
      */
     virtual void setAvailability(bool online);
 
+    /**
+     * Sets QoS of the data messages (states, attributes, availability) published by the device type.
+     * QoS 1 requires HAMqtt::enableQos1Publishing to be called before, otherwise messages are published with QoS 0.
+     *
+     * @param qos QoS of the messages (0 or 1).
+     */
+    inline void setQos(uint8_t qos)
+        { _qos = (qos > 1 ? 1 : qos); }
+
+    /**
+     * Returns QoS of the data messages published by the device type.
+     */
+    inline uint8_t getQos() const
+        { return _qos; }
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /**
+     * Sets the publish policy of the device type's state.
+     * Changes made within the minimum interval since the last publish are held (the latest value is kept)
+     * and published together once the interval elapses. The current state is republished when nothing was published
+     * for the maximum interval, which keeps the entity alive in Home Assistant (see HASensor::setExpireAfter).
+     * Setting `force` argument of the `set*` methods publishes the value immediately regardless of the minimum interval.
+     * The policy is evaluated by the scheduler running in HAMqtt::loop (see HAMqtt::enablePublishScheduler).
+     * It's supported only by device types that keep their current state (see HABaseDeviceType::hasCurrentState),
+     * e.g. HASensorNumber, but not HASensor that publishes text values without keeping them.
+     *
+     * @param minInterval The minimum time between publishes (milliseconds). Set `0` to publish changes immediately.
+     * @param maxInterval The maximum time between publishes (milliseconds). Set `0` to disable republishing.
+     * @returns Returns `false` if the device type doesn't support the policy.
+     * @note Setting both intervals to `0` removes the policy.
+     * The method is available only if the `ARDUINOHA_PUBLISH_SCHEDULER` macro is defined (see ArduinoHADefines.h).
+     */
+    bool setPublishInterval(const uint32_t minInterval, const uint32_t maxInterval = 0);
+
+    /**
+     * Returns `true` if a change of the state is held by the publish policy.
+     */
+    inline bool isStateHeld() const
+        { return _publishPolicy && _publishPolicy->held; }
+#endif
+
 #ifdef ARDUINOHA_TEST
     inline HASerializer* getSerializer() const
         { return _serializer; }
@@ -129,6 +178,31 @@ protected:
         const __FlashStringHelper* topic
     );
 
+    /**
+     * Unsubscribes from the given data topic.
+     *
+     * @param uniqueId THe unique ID of the device type assigned via the constructor.
+     * @param topic Topic to unsubscribe (progmem string).
+     */
+    static void unsubscribeTopic(
+        const char* uniqueId,
+        const __FlashStringHelper* topic
+    );
+
+    /**
+     * Subscribes to or unsubscribes from the given data topic.
+     * Unlike HABaseDeviceType::subscribeTopic, the subscription is made even if the broker holds the previous session.
+     *
+     * @param uniqueId THe unique ID of the device type assigned via the constructor.
+     * @param topic The topic (progmem string).
+     * @param subscribe Specifies whether the topic should be subscribed or unsubscribed.
+     */
+    static void changeSubscription(
+        const char* uniqueId,
+        const __FlashStringHelper* topic,
+        const bool subscribe
+    );
+
     /**
      * This method should build serializer that will be used for publishing the configuration.
      * The serializer is built each time the MQTT connection is acquired.
@@ -157,6 +231,37 @@ protected:
         const uint16_t length
     );
 
+    /**
+     * This method should publish the current state of the device type on its state topics.
+     * It's called when the connection is acquired and when HAMqtt replays states that changed while the device was offline.
+     */
+    virtual void publishCurrentState() { };
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /**
+     * Returns `true` if the device type keeps its current state and republishes it in HABaseDeviceType::publishCurrentState.
+     * Device types that override HABaseDeviceType::publishCurrentState should override this method as well,
+     * otherwise the publish policy (see HABaseDeviceType::setPublishInterval) is not available.
+     */
+    virtual bool hasCurrentState() const { return false; };
+#endif
+
+    /**
+     * This method is called when the window of restoring states starts and ends.
+     * Device types that support restoring should subscribe to their state topics when the window starts
+     * and unsubscribe when it ends. Messages received on the state topics in the meantime should be handled like commands.
+     *
+     * @param started Specifies whether the window starts or ends.
+     */
+    virtual void onStateRestore(const bool started) { (void)started; };
+
+    /**
+     * Returns `true` if the device type has at least one callback for commands sent by Home Assistant.
+     * Device types without callbacks don't subscribe their command topics in HAMqtt::publishAndDisconnect.
+     * The default implementation returns `true`, so custom device types always subscribe their topics.
+     */
+    virtual bool hasCommandCallbacks() const { return true; };
+
     /**
      * Destroys the existing serializer.
      */
@@ -173,6 +278,43 @@ protected:
      */
     void publishAvailability();
 
+    /**
+     * Publishes the current state of the device type after the connection is acquired.
+     * It's skipped if HAMqtt replays only the states that changed while the device was offline.
+     */
+    void publishStateOnConnect();
+
+    /**
+     * Returns `true` if the given topic is the state topic of this device type and the state restore is active.
+     *
+     * @param topic The topic on which the message was produced.
+     * @param stateTopic The state topic of this device type (progmem string).
+     */
+    bool isRestoreMessage(const char* topic, const __FlashStringHelper* stateTopic) const;
+
+    /**
+     * Marks the state of the device type as changed while it couldn't be published.
+     * The state is published again after the connection is acquired.
+     *
+     * @returns Returns `true` if the offline buffering is enabled.
+     */
+    bool bufferState();
+
+    /**
+     * Applies the publish policy (see HABaseDeviceType::setPublishInterval) to a new value of the state.
+     * The `set*` methods should call it before publishing. If the change is held,
+     * the new value should be stored without publishing and the scheduler publishes the current state later.
+     *
+     * @param force Specifies whether the value needs to be published regardless of the minimum interval.
+     * @returns Returns `true` if the change is held. It's always `false` if the scheduler is not compiled in.
+     */
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    bool holdState(const bool force = false);
+#else
+    inline bool holdState(const bool force = false)
+        { (void)force; return false; }
+#endif
+
     /**
      * Publishes the given flash string on the data topic.
      *
@@ -216,6 +358,38 @@ protected:
         bool isProgmemData = false
     );
 
+    /**
+     * Begins publishing of a message on the data topic.
+     * The payload needs to be written using HAMqtt::writePayload and the message
+     * needs to be finished using HAMqtt::endPublish. The publish queue is bypassed.
+     *
+     * @param topic The topic to publish on (progmem string).
+     * @param length The length of the payload.
+     * @param retained Specifies whether the message should be retained.
+     */
+    bool beginPublishOnDataTopic(
+        const __FlashStringHelper* topic,
+        const uint32_t length,
+        bool retained = false
+    );
+
+    /**
+     * Publishes the given data on the given (full) topic.
+     *
+     * @param topic The topic to publish on.
+     * @param payload The message's payload.
+     * @param length The length of the payload.
+     * @param retained Specifies whether the message should be retained.
+     * @param isProgmemData Specifies whether the given data is stored in the flash memory.
+     */
+    bool publishOnTopic(
+        const char* topic,
+        const uint8_t* payload,
+        const uint16_t length,
+        bool retained,
+        bool isProgmemData
+    );
+
     /// The component name that was assigned via the constructor.
     const __FlashStringHelper* const _componentName;
 
@@ -231,6 +405,9 @@ protected:
     /// HASerializer that belongs to this device type. It can be nullptr.
     HASerializer* _serializer;
 
+    /// QoS of the data messages that was set using setQos method.
+    uint8_t _qos;
+
 private:
     enum Availability {
         AvailabilityDefault = 0,
@@ -238,8 +415,51 @@ private:
         AvailabilityOffline
     };
 
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /// The publish policy of the state. It's scheduled in the timer wheel owned by HAMqtt.
+    struct PublishPolicy : public HATimerWheel::Timer {
+        /// The device type that owns the policy.
+        HABaseDeviceType* deviceType;
+
+        /// The minimum time between publishes (milliseconds).
+        uint32_t minInterval;
+
+        /// The maximum time between publishes (milliseconds). It's `0` if republishing is disabled.
+        uint32_t maxInterval;
+
+        /// Time of the last publish (milliseconds since boot).
+        uint32_t publishedAt;
+
+        /// Specifies whether the state was published at least once.
+        bool published;
+
+        /// Specifies whether a change of the state waits for the minimum interval.
+        bool held;
+    };
+
+    /**
+     * Records the publish of the state and schedules the next republish.
+     *
+     * @param now The current time (milliseconds since boot).
+     */
+    void markStatePublished(const uint32_t now);
+
+    /**
+     * This method is called by HAMqtt when the timer of the publish policy expires.
+     */
+    void onPublishTimer();
+#endif
+
+    /// Specifies whether the state waits for the end of the window of restoring states (see HAMqtt::enableStateRestore).
+    bool _stateRestorePending;
+
     /// The current availability of this device type. AvailabilityDefault means that the initial availability was never set.
     Availability _availability;
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    /// The publish policy set using setPublishInterval method. It's nullptr if changes are published immediately.
+    PublishPolicy* _publishPolicy;
+#endif
     friend class HAMqtt;
 };
 
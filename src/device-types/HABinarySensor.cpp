@@ -22,7 +22,7 @@ bool HABinarySensor::setState(const bool state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -83,6 +83,11 @@ void HABinarySensor::onMqttConnected()
 
     publishConfig();
     publishAvailability();
+    publishStateOnConnect();
+}
+
+void HABinarySensor::publishCurrentState()
+{
     publishState(_currentState);
 }
 
@@ -105,6 +105,10 @@ public:
 protected:
     virtual void buildSerializer() override;
     virtual void onMqttConnected() override;
+    virtual void publishCurrentState() override;
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    virtual bool hasCurrentState() const override { return true; };
+#endif
 
 private:
     /**
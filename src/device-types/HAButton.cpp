@@ -64,6 +64,11 @@ void HAButton::onMqttConnected()
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HAButton::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
 void HAButton::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
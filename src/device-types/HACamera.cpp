@@ -3,22 +3,158 @@
 
 #include "../HAMqtt.h"
 #include "../utils/HASerializer.h"
+#include "../utils/HABase64.h"
+#include "../utils/HAUtils.h"
 
 HACamera::HACamera(const char* uniqueId) :
     HABaseDeviceType(AHATOFSTR(HAComponentCamera), uniqueId),
     _encoding(EncodingBinary),
-    _icon(nullptr)
+    _icon(nullptr),
+    _imageRemainingLength(0),
+    _imageStreaming(false),
+    _imageTailLength(0),
+    _fingerprintSamplesNb(0),
+    _hasFingerprint(false),
+    _blockHashes(nullptr),
+    _lastFrameLength(0),
+    _lengthTolerance(0),
+    _changedBlocksThreshold(0),
+    _keyframeInterval(0),
+    _lastFramePublishedAt(0),
+    _sentFramesNb(0),
+    _suppressedFramesNb(0)
 {
 
 }
 
-bool HACamera::publishImage(const uint8_t* data, const uint16_t length)
+HACamera::~HACamera()
+{
+    disableChangeDetection();
+}
+
+bool HACamera::publishImage(const uint8_t* data, const uint32_t length)
 {
     if (!data) {
         return false;
     }
 
-    return publishOnDataTopic(AHATOFSTR(HATopic), data, length, true);
+    if (_fingerprintSamplesNb == 0) {
+        return publishFrame(data, length);
+    }
+
+    if (
+        _hasFingerprint &&
+        !isFrameChanged(data, length) &&
+        (_keyframeInterval == 0 || (millis() - _lastFramePublishedAt) < _keyframeInterval)
+    ) {
+        _suppressedFramesNb++;
+        return true; // the image displayed in HA is up to date
+    }
+
+    if (!publishFrame(data, length)) {
+        return false;
+    }
+
+    storeFingerprint(data, length);
+    _lastFramePublishedAt = millis();
+
+    return true;
+}
+
+void HACamera::enableChangeDetection(
+    const uint16_t samplesNb,
+    const uint32_t keyframeInterval,
+    const uint8_t lengthTolerance,
+    const uint16_t changedBlocksThreshold
+)
+{
+    disableChangeDetection();
+
+    if (samplesNb == 0) {
+        return;
+    }
+
+    _blockHashes = new uint32_t[samplesNb];
+    _fingerprintSamplesNb = samplesNb;
+    _keyframeInterval = keyframeInterval;
+    _lengthTolerance = lengthTolerance;
+    _changedBlocksThreshold = changedBlocksThreshold > 0 ? changedBlocksThreshold : 1;
+}
+
+void HACamera::disableChangeDetection()
+{
+    if (_blockHashes) {
+        delete[] _blockHashes;
+        _blockHashes = nullptr;
+    }
+
+    _fingerprintSamplesNb = 0;
+    _hasFingerprint = false;
+}
+
+bool HACamera::beginImage(const uint32_t length)
+{
+    const uint32_t payloadLength = _encoding == EncodingBase64
+        ? HABase64::calculateEncodedLength(length)
+        : length;
+
+    if (!uniqueId() || !beginPublishOnDataTopic(AHATOFSTR(HATopic), payloadLength, true)) {
+        return false;
+    }
+
+    _imageRemainingLength = length;
+    _imageStreaming = true;
+    _imageTailLength = 0;
+
+    return true;
+}
+
+bool HACamera::writeImageChunk(const uint8_t* data, const uint32_t length)
+{
+    if (!_imageStreaming || !data || length > _imageRemainingLength) {
+        return false;
+    }
+
+    writeImageData(data, length);
+    _imageRemainingLength -= length;
+
+    return true;
+}
+
+bool HACamera::endImage()
+{
+    if (!_imageStreaming) {
+        return false;
+    }
+
+    const bool complete = (_imageRemainingLength == 0);
+
+    // the broker expects the declared number of bytes, otherwise the next packets would be consumed as the payload
+    static const uint8_t padding[32] = {0};
+    while (_imageRemainingLength > 0) {
+        const uint32_t chunkLength = _imageRemainingLength < sizeof(padding)
+            ? _imageRemainingLength
+            : sizeof(padding);
+
+        writeImageData(padding, chunkLength);
+        _imageRemainingLength -= chunkLength;
+    }
+
+    if (_imageTailLength > 0) {
+        char tail[4];
+        HABase64::encodeTail(tail, _imageTail, _imageTailLength);
+        mqtt()->writePayload(tail, sizeof(tail));
+        _imageTailLength = 0;
+    }
+
+    _imageStreaming = false;
+
+    if (!mqtt()->endPublish() || !complete) {
+        return false;
+    }
+
+    _sentFramesNb++;
+    return true;
 }
 
 void HACamera::buildSerializer()
@@ -52,6 +188,139 @@ void HACamera::onMqttConnected()
     publishAvailability();
 }
 
+bool HACamera::publishFrame(const uint8_t* data, const uint32_t length)
+{
+    if (_encoding != EncodingBase64 && length <= UINT16_MAX) {
+        if (!publishOnDataTopic(AHATOFSTR(HATopic), data, length, true)) {
+            return false;
+        }
+
+        _sentFramesNb++;
+        return true;
+    }
+
+    return beginImage(length) && writeImageChunk(data, length) && endImage();
+}
+
+uint16_t HACamera::calculateBlocksNb(const uint32_t length) const
+{
+    // small frames are covered entirely by consecutive blocks
+    if (length <= (uint32_t)_fingerprintSamplesNb * FingerprintBlockSize) {
+        return (length + FingerprintBlockSize - 1) / FingerprintBlockSize;
+    }
+
+    return _fingerprintSamplesNb;
+}
+
+uint32_t HACamera::calculateBlockOffset(const uint16_t index, const uint32_t length) const
+{
+    if (length <= (uint32_t)_fingerprintSamplesNb * FingerprintBlockSize) {
+        return (uint32_t)index * FingerprintBlockSize;
+    }
+
+    const uint32_t lastOffset = length - FingerprintBlockSize;
+    if (index == _fingerprintSamplesNb - 1) {
+        return lastOffset;
+    }
+
+    return (uint32_t)index * (lastOffset / (_fingerprintSamplesNb > 1 ? _fingerprintSamplesNb - 1 : 1));
+}
+
+bool HACamera::isFrameChanged(const uint8_t* data, const uint32_t length) const
+{
+    const uint32_t lengthDiff = length > _lastFrameLength
+        ? length - _lastFrameLength
+        : _lastFrameLength - length;
+
+    if (lengthDiff > (_lastFrameLength / 100) * _lengthTolerance) {
+        return true;
+    }
+
+    // blocks are compared at positions of the last published frame, so a slightly longer frame doesn't shift them
+    const uint16_t blocksNb = calculateBlocksNb(_lastFrameLength);
+    const uint16_t threshold = _changedBlocksThreshold < blocksNb ? _changedBlocksThreshold : blocksNb;
+    uint16_t changedBlocksNb = 0;
+
+    for (uint16_t i = 0; i < blocksNb; i++) {
+        const uint32_t offset = calculateBlockOffset(i, _lastFrameLength);
+        const uint32_t blockSize = _lastFrameLength - offset < FingerprintBlockSize
+            ? _lastFrameLength - offset
+            : FingerprintBlockSize;
+
+        if (
+            offset + blockSize > length ||
+            HAUtils::hash(&data[offset], blockSize) != _blockHashes[i]
+        ) {
+            changedBlocksNb++;
+            if (changedBlocksNb >= threshold) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void HACamera::storeFingerprint(const uint8_t* data, const uint32_t length)
+{
+    const uint16_t blocksNb = calculateBlocksNb(length);
+    for (uint16_t i = 0; i < blocksNb; i++) {
+        const uint32_t offset = calculateBlockOffset(i, length);
+        const uint32_t blockSize = length - offset < FingerprintBlockSize
+            ? length - offset
+            : FingerprintBlockSize;
+
+        _blockHashes[i] = HAUtils::hash(&data[offset], blockSize);
+    }
+
+    _lastFrameLength = length;
+    _hasFingerprint = true;
+}
+
+void HACamera::writeImageData(const uint8_t* data, uint32_t length)
+{
+    if (_encoding != EncodingBase64) {
+        mqtt()->writePayload(data, length);
+        return;
+    }
+
+    char block[HABase64::BlockSize];
+
+    // the group started by the previous chunk needs to be completed first
+    if (_imageTailLength > 0) {
+        while (_imageTailLength < 3 && length > 0) {
+            _imageTail[_imageTailLength++] = *data++;
+            length--;
+        }
+
+        if (_imageTailLength < 3) {
+            return;
+        }
+
+        HABase64::encodeGroups(block, _imageTail, 1);
+        mqtt()->writePayload(block, 4);
+        _imageTailLength = 0;
+    }
+
+    while (length >= 3) {
+        uint32_t groupsNb = length / 3;
+        if (groupsNb > HABase64::BlockSize / 4) {
+            groupsNb = HABase64::BlockSize / 4;
+        }
+
+        HABase64::encodeGroups(block, data, groupsNb);
+        mqtt()->writePayload(block, groupsNb * 4);
+
+        data += groupsNb * 3;
+        length -= groupsNb * 3;
+    }
+
+    while (length > 0) {
+        _imageTail[_imageTailLength++] = *data++;
+        length--;
+    }
+}
+
 const __FlashStringHelper* HACamera::getEncodingProperty() const
 {
     switch (_encoding) {
@@ -22,20 +22,106 @@ public:
         EncodingBase64
     };
 
+    /// The size of a single block of the frame that's included in the fingerprint (bytes).
+    static const uint8_t FingerprintBlockSize = 16;
+
     /**
      * @param uniqueId The unique ID of the camera. It needs to be unique in a scope of your device.
      */
     HACamera(const char* uniqueId);
 
+    /**
+     * Frees the memory allocated by the change detection.
+     */
+    ~HACamera();
+
     /**
      * Publishes MQTT message with the given image data as a message content.
      * It updates image displayed in the Home Assistant panel.
      *
+     * Images bigger than 64 KB are streamed directly from the given buffer (see HACamera::beginImage).
+     * If the encoding is set to `HACamera::EncodingBase64`, the data is encoded on the fly, so pass the raw image data.
+     *
      * @param data Image data (raw binary data or base64)
      * @param length The length of the data.
      * @returns Returns `true` if MQTT message has been published successfully.
      */
-    bool publishImage(const uint8_t* data, const uint16_t length);
+    bool publishImage(const uint8_t* data, const uint32_t length);
+
+    /**
+     * Enables skipping of frames that didn't change since the last published frame.
+     * HACamera::publishImage samples the given number of evenly spaced blocks of the frame and compares them
+     * with the blocks of the last published frame at the same positions.
+     * The frame is suppressed if its length is within the tolerance and fewer than `changedBlocksThreshold` blocks differ.
+     * Frames streamed using HACamera::beginImage are always published.
+     *
+     * @param samplesNb The number of blocks sampled from the frame. More samples detect smaller changes, but take more time.
+     * @param keyframeInterval The interval (milliseconds) after which the frame is published even if it didn't change.
+     *                         Set `0` to disable the forced keyframes.
+     * @param lengthTolerance The maximum difference of the frame's length (percent of the last published frame's length).
+     * @param changedBlocksThreshold The number of changed blocks that makes the frame published.
+     *                               Frames with fewer blocks are published if all of them changed.
+     */
+    void enableChangeDetection(
+        const uint16_t samplesNb = 64,
+        const uint32_t keyframeInterval = 60000,
+        const uint8_t lengthTolerance = 2,
+        const uint16_t changedBlocksThreshold = 4
+    );
+
+    /**
+     * Disables skipping of unchanged frames.
+     */
+    void disableChangeDetection();
+
+    /**
+     * Returns `true` if the change detection is enabled.
+     */
+    inline bool isChangeDetectionEnabled() const
+        { return (_fingerprintSamplesNb > 0); }
+
+    /**
+     * Returns the number of published frames.
+     */
+    inline uint32_t getSentFramesNb() const
+        { return _sentFramesNb; }
+
+    /**
+     * Returns the number of frames that were skipped by the change detection.
+     */
+    inline uint32_t getSuppressedFramesNb() const
+        { return _suppressedFramesNb; }
+
+    /**
+     * Begins streaming of an image. The data needs to be written using HACamera::writeImageChunk
+     * and the message needs to be finished using HACamera::endImage.
+     * Chunks are sent to the network client as they are, so the image is never copied
+     * and the MQTT buffer doesn't need to fit the image.
+     * If the encoding is set to `HACamera::EncodingBase64`, chunks are encoded on the fly in fixed-size blocks.
+     *
+     * @param length The total length of the raw image (bytes).
+     * @returns Returns `true` if the message has been started.
+     * @note Images bigger than 64 KB require the built-in MQTT client (see `ARDUINOHA_NATIVE_MQTT`).
+     */
+    bool beginImage(const uint32_t length);
+
+    /**
+     * Writes the next chunk of the image started by HACamera::beginImage.
+     *
+     * @param data The chunk of the image.
+     * @param length The length of the chunk.
+     * @returns Returns `false` if the image wasn't started or the chunk exceeds the declared length.
+     */
+    bool writeImageChunk(const uint8_t* data, const uint32_t length);
+
+    /**
+     * Finishes streaming of the image.
+     * If fewer bytes were written than declared in HACamera::beginImage, the message is padded
+     * with zeros to keep the MQTT stream consistent and the method returns `false`.
+     *
+     * @returns Returns `true` if the complete image has been published.
+     */
+    bool endImage();
 
     /**
      * Sets encoding of the image content.
@@ -65,12 +151,102 @@ private:
      */
     const __FlashStringHelper* getEncodingProperty() const;
 
+    /**
+     * Publishes the given frame (without the change detection).
+     *
+     * @param data Image data.
+     * @param length The length of the data.
+     */
+    bool publishFrame(const uint8_t* data, const uint32_t length);
+
+    /**
+     * Returns the number of blocks sampled from the frame of the given length.
+     *
+     * @param length The length of the frame.
+     */
+    uint16_t calculateBlocksNb(const uint32_t length) const;
+
+    /**
+     * Returns the offset of the sampled block in the frame of the given length.
+     * Blocks are evenly spaced and the last one ends at the end of the frame.
+     *
+     * @param index The index of the block.
+     * @param length The length of the frame.
+     */
+    uint32_t calculateBlockOffset(const uint16_t index, const uint32_t length) const;
+
+    /**
+     * Compares the given frame with the last published frame.
+     * Returns `true` if the length exceeds the tolerance or too many sampled blocks differ.
+     *
+     * @param data Image data.
+     * @param length The length of the data.
+     */
+    bool isFrameChanged(const uint8_t* data, const uint32_t length) const;
+
+    /**
+     * Stores hashes of the sampled blocks of the published frame.
+     *
+     * @param data Image data.
+     * @param length The length of the data.
+     */
+    void storeFingerprint(const uint8_t* data, const uint32_t length);
+
+    /**
+     * Writes the chunk of the streamed image to the payload (encodes it if needed).
+     *
+     * @param data The chunk of the image.
+     * @param length The length of the chunk.
+     */
+    void writeImageData(const uint8_t* data, uint32_t length);
+
     /// The encoding of the image's data. By default it's `HACamera::EncodingBinary`.
     ImageEncoding _encoding;
 
     /// The icon of the camera. It can be nullptr.
     const char* _icon;
-    
+
+    /// The number of bytes of the streamed image that weren't written yet.
+    uint32_t _imageRemainingLength;
+
+    /// Specifies whether the image is being streamed.
+    bool _imageStreaming;
+
+    /// Bytes of the incomplete base64 group that are waiting for the next chunk.
+    uint8_t _imageTail[3];
+
+    /// The number of bytes in the `_imageTail`.
+    uint8_t _imageTailLength;
+
+    /// The number of blocks sampled from the frame. `0` means that the change detection is disabled.
+    uint16_t _fingerprintSamplesNb;
+
+    /// Specifies whether the `_blockHashes` belong to a published frame.
+    bool _hasFingerprint;
+
+    /// Hashes of the sampled blocks of the last published frame (`_fingerprintSamplesNb` items).
+    uint32_t* _blockHashes;
+
+    /// The length of the last published frame.
+    uint32_t _lastFrameLength;
+
+    /// The maximum difference of the frame's length (percent).
+    uint8_t _lengthTolerance;
+
+    /// The number of changed blocks that makes the frame published.
+    uint16_t _changedBlocksThreshold;
+
+    /// The interval of forced keyframes (milliseconds).
+    uint32_t _keyframeInterval;
+
+    /// The time when the last frame was published (milliseconds).
+    uint32_t _lastFramePublishedAt;
+
+    /// The number of published frames.
+    uint32_t _sentFramesNb;
+
+    /// The number of frames skipped by the change detection.
+    uint32_t _suppressedFramesNb;
 };
 
 #endif
@@ -26,7 +26,7 @@ bool HACover::setState(const CoverState state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -40,7 +40,7 @@ bool HACover::setPosition(const int16_t position, const bool force)
         return true;
     }
 
-    if (publishPosition(position)) {
+    if (holdState(force) || publishPosition(position) || bufferState()) {
         _currentPosition = position;
         return true;
     }
@@ -97,13 +97,23 @@ void HACover::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
-        publishPosition(_currentPosition);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HACover::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
+void HACover::publishCurrentState()
+{
+    publishState(_currentState);
+    publishPosition(_currentPosition);
+}
+
 void HACover::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
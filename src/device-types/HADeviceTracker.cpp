@@ -19,7 +19,7 @@ bool HADeviceTracker::setState(const TrackerState state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -56,6 +56,11 @@ void HADeviceTracker::onMqttConnected()
 
     publishConfig();
     publishAvailability();
+    publishStateOnConnect();
+}
+
+void HADeviceTracker::publishCurrentState()
+{
     publishState(_currentState);
 }
 
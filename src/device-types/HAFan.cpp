@@ -27,7 +27,7 @@ bool HAFan::setState(const bool state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -41,7 +41,7 @@ bool HAFan::setSpeed(const uint16_t speed, const bool force)
         return true;
     }
 
-    if (publishSpeed(speed)) {
+    if (holdState(force) || publishSpeed(speed) || bufferState()) {
         _currentSpeed = speed;
         return true;
     }
@@ -114,8 +114,7 @@ void HAFan::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
-        publishSpeed(_currentSpeed);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
@@ -125,6 +124,20 @@ void HAFan::onMqttConnected()
     }
 }
 
+bool HAFan::hasCommandCallbacks() const
+{
+    return (
+        _stateCallback != nullptr ||
+        _speedCallback != nullptr
+    );
+}
+
+void HAFan::publishCurrentState()
+{
+    publishState(_currentState);
+    publishSpeed(_currentSpeed);
+}
+
 void HAFan::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -4,6 +4,7 @@
 #include "../HAMqtt.h"
 #include "../utils/HAUtils.h"
 #include "../utils/HASerializer.h"
+#include "../utils/HADeadband.h"
 
 const uint8_t HAHVAC::DefaultFanModes = AutoFanMode | LowFanMode | MediumFanMode | HighFanMode;
 const uint8_t HAHVAC::DefaultSwingModes = OnSwingMode | OffSwingMode;
@@ -20,6 +21,7 @@ HAHVAC::HAHVAC(
     _icon(nullptr),
     _retain(false),
     _currentTemperature(),
+    _currentTemperatureDeadband(nullptr),
     _action(UnknownAction),
     _temperatureUnit(DefaultUnit),
     _minTemp(),
@@ -69,6 +71,8 @@ HAHVAC::~HAHVAC()
     if (_modesSerializer) {
         delete _modesSerializer;
     }
+
+    disableCurrentTemperatureDeadband();
 }
 
 bool HAHVAC::setCurrentTemperature(const HANumeric& temperature, const bool force)
@@ -81,7 +85,16 @@ bool HAHVAC::setCurrentTemperature(const HANumeric& temperature, const bool forc
         return true;
     }
 
-    if (publishCurrentTemperature(temperature)) {
+    if (
+        !force &&
+        _currentTemperatureDeadband &&
+        !_currentTemperatureDeadband->shouldPublish(temperature)
+    ) {
+        _currentTemperature = temperature;
+        return true;
+    }
+
+    if (holdState(force) || publishCurrentTemperature(temperature) || bufferState()) {
         _currentTemperature = temperature;
         return true;
     }
@@ -89,13 +102,31 @@ bool HAHVAC::setCurrentTemperature(const HANumeric& temperature, const bool forc
     return false;
 }
 
+void HAHVAC::setCurrentTemperatureDeadband(
+    const float absolute,
+    const float relative,
+    const float hysteresis
+)
+{
+    disableCurrentTemperatureDeadband();
+    _currentTemperatureDeadband = new HADeadband(absolute, relative, hysteresis, _precision);
+}
+
+void HAHVAC::disableCurrentTemperatureDeadband()
+{
+    if (_currentTemperatureDeadband) {
+        delete _currentTemperatureDeadband;
+        _currentTemperatureDeadband = nullptr;
+    }
+}
+
 bool HAHVAC::setAction(const Action action, const bool force)
 {
     if (!force && action == _action) {
         return true;
     }
 
-    if (publishAction(action)) {
+    if (holdState(force) || publishAction(action) || bufferState()) {
         _action = action;
         return true;
     }
@@ -109,7 +140,7 @@ bool HAHVAC::setAuxState(const bool state, const bool force)
         return true;
     }
 
-    if (publishAuxState(state)) {
+    if (holdState(force) || publishAuxState(state) || bufferState()) {
         _auxState = state;
         return true;
     }
@@ -123,7 +154,7 @@ bool HAHVAC::setFanMode(const FanMode mode, const bool force)
         return true;
     }
 
-    if (publishFanMode(mode)) {
+    if (holdState(force) || publishFanMode(mode) || bufferState()) {
         _fanMode = mode;
         return true;
     }
@@ -137,7 +168,7 @@ bool HAHVAC::setSwingMode(const SwingMode mode, const bool force)
         return true;
     }
 
-    if (publishSwingMode(mode)) {
+    if (holdState(force) || publishSwingMode(mode) || bufferState()) {
         _swingMode = mode;
         return true;
     }
@@ -151,7 +182,7 @@ bool HAHVAC::setMode(const Mode mode, const bool force)
         return true;
     }
 
-    if (publishMode(mode)) {
+    if (holdState(force) || publishMode(mode) || bufferState()) {
         _mode = mode;
         return true;
     }
@@ -169,7 +200,7 @@ bool HAHVAC::setTargetTemperature(const HANumeric& temperature, const bool force
         return true;
     }
 
-    if (publishTargetTemperature(temperature)) {
+    if (holdState(force) || publishTargetTemperature(temperature) || bufferState()) {
         _targetTemperature = temperature;
         return true;
     }
@@ -364,13 +395,7 @@ void HAHVAC::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishCurrentTemperature(_currentTemperature);
-        publishAction(_action);
-        publishAuxState(_auxState);
-        publishFanMode(_fanMode);
-        publishSwingMode(_swingMode);
-        publishMode(_mode);
-        publishTargetTemperature(_targetTemperature);
+        publishStateOnConnect();
     }
 
     if (_features & AuxHeatingFeature) {
@@ -398,6 +423,29 @@ void HAHVAC::onMqttConnected()
     }
 }
 
+bool HAHVAC::hasCommandCallbacks() const
+{
+    return (
+        _auxCallback != nullptr ||
+        _powerCallback != nullptr ||
+        _fanModeCallback != nullptr ||
+        _swingModeCallback != nullptr ||
+        _modeCallback != nullptr ||
+        _targetTemperatureCallback != nullptr
+    );
+}
+
+void HAHVAC::publishCurrentState()
+{
+    publishCurrentTemperature(_currentTemperature);
+    publishAction(_action);
+    publishAuxState(_auxState);
+    publishFanMode(_fanMode);
+    publishSwingMode(_swingMode);
+    publishMode(_mode);
+    publishTargetTemperature(_targetTemperature);
+}
+
 void HAHVAC::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -458,11 +506,19 @@ bool HAHVAC::publishCurrentTemperature(const HANumeric& temperature)
     str[size] = 0;
     temperature.toStr(str);
 
-    return publishOnDataTopic(
+    if (!publishOnDataTopic(
         AHATOFSTR(HACurrentTemperatureTopic),
         str,
         true
-    );
+    )) {
+        return false;
+    }
+
+    if (_currentTemperatureDeadband) {
+        _currentTemperatureDeadband->markPublished(temperature);
+    }
+
+    return true;
 }
 
 bool HAHVAC::publishAction(const Action action)
@@ -41,6 +41,7 @@
 #endif
 
 class HASerializerArray;
+class HADeadband;
 
 /**
  * HAHVAC lets you control your HVAC devices.
@@ -259,6 +260,33 @@ public:
     inline const HANumeric& getCurrentTemperature() const
         { return _currentTemperature; }
 
+    /**
+     * Suppresses publishing of current temperatures that differ only slightly from the last published one
+     * (e.g. a DS18B20 sensor jittering by one LSB).
+     * The thresholds are converted into the precision of the HVAC (see HADeadband).
+     * Temperatures set with the `force` flag are always published.
+     *
+     * @param absolute The absolute deadband (degrees).
+     * @param relative The relative deadband (percent of the last published temperature).
+     * @param hysteresis The additional deadband applied when the direction of the change reverses (degrees).
+     */
+    void setCurrentTemperatureDeadband(
+        const float absolute,
+        const float relative = 0,
+        const float hysteresis = 0
+    );
+
+    /**
+     * Disables the deadband of the current temperature.
+     */
+    void disableCurrentTemperatureDeadband();
+
+    /**
+     * Returns the deadband of the current temperature or nullptr if it's disabled.
+     */
+    inline const HADeadband* getCurrentTemperatureDeadband() const
+        { return _currentTemperatureDeadband; }
+
     /**
      * Sets action of the HVAC without publishing it to Home Assistant.
      * This method may be useful if you want to change the action before connection
@@ -509,6 +537,11 @@ public:
 protected:
     virtual void buildSerializer() override;
     virtual void onMqttConnected() override;
+    virtual bool hasCommandCallbacks() const override;
+    virtual void publishCurrentState() override;
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    virtual bool hasCurrentState() const override { return true; };
+#endif
     virtual void onMqttMessage(
         const char* topic,
         const uint8_t* payload,
@@ -641,6 +674,9 @@ private:
     /// The current temperature of the HVAC. By default it's not set.
     HANumeric _currentTemperature;
 
+    /// The deadband of the current temperature. It's nullptr if the deadband is disabled.
+    HADeadband* _currentTemperatureDeadband;
+
     /// The current action of the HVAC. By default it's `HAHVAC::UnknownAction`.
     Action _action;
 
@@ -72,7 +72,7 @@ bool HALight::setState(const bool state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -86,7 +86,7 @@ bool HALight::setBrightness(const uint8_t brightness, const bool force)
         return true;
     }
 
-    if (publishBrightness(brightness)) {
+    if (holdState(force) || publishBrightness(brightness) || bufferState()) {
         _currentBrightness = brightness;
         return true;
     }
@@ -100,7 +100,7 @@ bool HALight::setColorTemperature(const uint16_t temperature, const bool force)
         return true;
     }
 
-    if (publishColorTemperature(temperature)) {
+    if (holdState(force) || publishColorTemperature(temperature) || bufferState()) {
         _currentColorTemperature = temperature;
         return true;
     }
@@ -114,7 +114,7 @@ bool HALight::setRGBColor(const RGBColor& color, const bool force)
         return true;
     }
 
-    if (publishRGBColor(color)) {
+    if (holdState(force) || publishRGBColor(color) || bufferState()) {
         _currentRGBColor = color;
         return true;
     }
@@ -205,10 +205,7 @@ void HALight::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
-        publishBrightness(_currentBrightness);
-        publishColorTemperature(_currentColorTemperature);
-        publishRGBColor(_currentRGBColor);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
@@ -226,6 +223,45 @@ void HALight::onMqttConnected()
     }
 }
 
+bool HALight::hasCommandCallbacks() const
+{
+    return (
+        _stateCallback != nullptr ||
+        _brightnessCallback != nullptr ||
+        _colorTemperatureCallback != nullptr ||
+        _rgbColorCallback != nullptr
+    );
+}
+
+void HALight::publishCurrentState()
+{
+    publishState(_currentState);
+    publishBrightness(_currentBrightness);
+    publishColorTemperature(_currentColorTemperature);
+    publishRGBColor(_currentRGBColor);
+}
+
+void HALight::onStateRestore(const bool started)
+{
+    if (!uniqueId()) {
+        return;
+    }
+
+    changeSubscription(uniqueId(), AHATOFSTR(HAStateTopic), started);
+
+    if (_features & BrightnessFeature) {
+        changeSubscription(uniqueId(), AHATOFSTR(HABrightnessStateTopic), started);
+    }
+
+    if (_features & ColorTemperatureFeature) {
+        changeSubscription(uniqueId(), AHATOFSTR(HAColorTemperatureStateTopic), started);
+    }
+
+    if (_features & RGBFeature) {
+        changeSubscription(uniqueId(), AHATOFSTR(HARGBStateTopic), started);
+    }
+}
+
 void HALight::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -236,26 +272,26 @@ void HALight::onMqttMessage(
         topic,
         uniqueId(),
         AHATOFSTR(HACommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HAStateTopic))) {
         handleStateCommand(payload, length);
     } else if (HASerializer::compareDataTopics(
         topic,
         uniqueId(),
         AHATOFSTR(HABrightnessCommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HABrightnessStateTopic))) {
         handleBrightnessCommand(payload, length);
     } else if (HASerializer::compareDataTopics(
         topic,
         uniqueId(),
         AHATOFSTR(HAColorTemperatureCommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HAColorTemperatureStateTopic))) {
         handleColorTemperatureCommand(payload, length);
     } else if (
         HASerializer::compareDataTopics(
             topic,
             uniqueId(),
             AHATOFSTR(HARGBCommandTopic)
-        )
+        ) || isRestoreMessage(topic, AHATOFSTR(HARGBStateTopic))
     ) {
         handleRGBCommand(payload, length);
     }
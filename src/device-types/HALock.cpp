@@ -21,7 +21,7 @@ bool HALock::setState(const LockState state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -73,12 +73,22 @@ void HALock::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HALock::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
+void HALock::publishCurrentState()
+{
+    publishState(_currentState);
+}
+
 void HALock::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -3,6 +3,7 @@
 
 #include "../HAMqtt.h"
 #include "../utils/HASerializer.h"
+#include "../utils/HADeadband.h"
 
 HANumber::HANumber(const char* uniqueId, const NumberPrecision precision) :
     HABaseDeviceType(AHATOFSTR(HAComponentNumber), uniqueId),
@@ -19,18 +20,29 @@ HANumber::HANumber(const char* uniqueId, const NumberPrecision precision) :
     _maxValue(),
     _step(),
     _currentState(),
+    _deadband(nullptr),
     _commandCallback(nullptr)
 {
 
 }
 
+HANumber::~HANumber()
+{
+    disableDeadband();
+}
+
 bool HANumber::setState(const HANumeric& state, const bool force)
 {
     if (!force && state == _currentState) {
         return true;
     }
 
-    if (publishState(state)) {
+    if (!force && _deadband && !_deadband->shouldPublish(state)) {
+        _currentState = state;
+        return true;
+    }
+
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -38,6 +50,24 @@ bool HANumber::setState(const HANumeric& state, const bool force)
     return false;
 }
 
+void HANumber::setDeadband(
+    const float absolute,
+    const float relative,
+    const float hysteresis
+)
+{
+    disableDeadband();
+    _deadband = new HADeadband(absolute, relative, hysteresis, _precision);
+}
+
+void HANumber::disableDeadband()
+{
+    if (_deadband) {
+        delete _deadband;
+        _deadband = nullptr;
+    }
+}
+
 void HANumber::buildSerializer()
 {
     if (_serializer || !uniqueId()) {
@@ -127,12 +157,31 @@ void HANumber::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HANumber::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
+void HANumber::publishCurrentState()
+{
+    publishState(_currentState);
+}
+
+void HANumber::onStateRestore(const bool started)
+{
+    if (!uniqueId()) {
+        return;
+    }
+
+    changeSubscription(uniqueId(), AHATOFSTR(HAStateTopic), started);
+}
+
 void HANumber::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -143,7 +192,7 @@ void HANumber::onMqttMessage(
         topic,
         uniqueId(),
         AHATOFSTR(HACommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HAStateTopic))) {
         handleCommand(payload, length);
     }
 }
@@ -167,11 +216,19 @@ bool HANumber::publishState(const HANumeric& state)
     str[size] = 0;
     state.toStr(str);
 
-    return publishOnDataTopic(
+    if (!publishOnDataTopic(
         AHATOFSTR(HAStateTopic),
         str,
         true
-    );
+    )) {
+        return false;
+    }
+
+    if (_deadband) {
+        _deadband->markPublished(state);
+    }
+
+    return true;
 }
 
 void HANumber::handleCommand(const uint8_t* cmd, const uint16_t length)
@@ -22,6 +22,8 @@
     #define HANUMBER_CALLBACK(name) void (*name)(HANumeric number, HANumber* sender)
 #endif
 
+class HADeadband;
+
 /**
  * HANumber adds a slider or a box in the Home Assistant panel
  * that controls the numeric value stored on your device.
@@ -49,10 +51,16 @@ public:
      */
     HANumber(const char* uniqueId, const NumberPrecision precision = PrecisionP0);
 
+    /**
+     * Frees memory allocated for the deadband.
+     */
+    ~HANumber();
+
     /**
      * Changes state of the number and publishes MQTT message.
      * Please note that if a new value is the same as previous one,
      * the MQTT message won't be published.
+     * The same applies to states within the deadband (see HANumber::setDeadband).
      *
      * @param state New state of the number.
      * @param force Forces to update state without comparing it to a previous known state.
@@ -101,6 +109,29 @@ public:
     inline const HANumeric& getCurrentState() const
         { return _currentState; }
 
+    /**
+     * Suppresses reporting of states that differ only slightly from the last published state.
+     * It's useful if the state reflects a measured value (e.g. the position read from a potentiometer).
+     * The thresholds are converted into the precision of the number (see HADeadband).
+     * States set with the `force` flag are always published, so use it to confirm commands received from HA.
+     *
+     * @param absolute The absolute deadband (in units of the state).
+     * @param relative The relative deadband (percent of the last published state).
+     * @param hysteresis The additional deadband applied when the direction of the change reverses.
+     */
+    void setDeadband(const float absolute, const float relative = 0, const float hysteresis = 0);
+
+    /**
+     * Disables the deadband. Each change of the state is published.
+     */
+    void disableDeadband();
+
+    /**
+     * Returns the deadband of the number or nullptr if it's disabled.
+     */
+    inline const HADeadband* getDeadband() const
+        { return _deadband; }
+
     /**
      * Sets class of the device.
      * You can find list of available values here: https://www.home-assistant.io/integrations/number/#device-class
@@ -213,6 +244,12 @@ public:
 protected:
     virtual void buildSerializer() override;
     virtual void onMqttConnected() override;
+    virtual bool hasCommandCallbacks() const override;
+    virtual void publishCurrentState() override;
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    virtual bool hasCurrentState() const override { return true; };
+#endif
+    virtual void onStateRestore(const bool started) override;
     virtual void onMqttMessage(
         const char* topic,
         const uint8_t* payload,
@@ -285,6 +322,9 @@ private:
     /// The current state of the number. By default the value is not set.
     HANumeric _currentState;
 
+    /// The deadband of published states. It's nullptr if the deadband is disabled.
+    HADeadband* _deadband;
+
     /// The callback that will be called when the command is received from the HA.
     HANUMBER_CALLBACK(_commandCallback);
 };
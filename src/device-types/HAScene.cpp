@@ -56,6 +56,11 @@ void HAScene::onMqttConnected()
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HAScene::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
 void HAScene::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
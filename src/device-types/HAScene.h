@@ -56,6 +56,7 @@ public:
 protected:
     virtual void buildSerializer() override;
     virtual void onMqttConnected() override;
+    virtual bool hasCommandCallbacks() const override;
     virtual void onMqttMessage(
         const char* topic,
         const uint8_t* payload,
@@ -79,7 +79,7 @@ bool HASelect::setState(const int8_t state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -151,23 +151,42 @@ void HASelect::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HASelect::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
+void HASelect::publishCurrentState()
+{
+    publishState(_currentState);
+}
+
+void HASelect::onStateRestore(const bool started)
+{
+    if (!uniqueId()) {
+        return;
+    }
+
+    changeSubscription(uniqueId(), AHATOFSTR(HAStateTopic), started);
+}
+
 void HASelect::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
     const uint16_t length
 )
 {
-    if (_commandCallback && HASerializer::compareDataTopics(
+    if (_commandCallback && (HASerializer::compareDataTopics(
         topic,
         uniqueId(),
         AHATOFSTR(HACommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HAStateTopic)))) {
         const uint8_t optionsNb = _options->getItemsNb();
         const HASerializerArray::ItemType* options = _options->getItems();
 
@@ -143,6 +143,12 @@ public:
 protected:
     virtual void buildSerializer() override;
     virtual void onMqttConnected() override;
+    virtual bool hasCommandCallbacks() const override;
+    virtual void publishCurrentState() override;
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    virtual bool hasCurrentState() const override { return true; };
+#endif
+    virtual void onStateRestore(const bool started) override;
     virtual void onMqttMessage(
         const char* topic,
         const uint8_t* payload,
@@ -50,6 +50,8 @@ public:
     /**
      * Sets the number of seconds after the sensor’s state expires, if it’s not updated.
      * By default the sensors state never expires.
+     * Use HABaseDeviceType::setPublishInterval with the maximum interval shorter than the expiration time
+     * to keep a stable value of HASensorNumber from expiring.
      *
      * @param expireAfter The number of seconds.
      */
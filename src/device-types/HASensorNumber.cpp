@@ -2,6 +2,7 @@
 #ifndef EX_ARDUINOHA_SENSOR
 
 #include "../utils/HASerializer.h"
+#include "../utils/HADeadband.h"
 
 HASensorNumber::HASensorNumber(
     const char* uniqueId,
@@ -10,11 +11,17 @@ HASensorNumber::HASensorNumber(
 ) :
     HASensor(uniqueId, features),
     _precision(precision),
-    _currentValue()
+    _currentValue(),
+    _deadband(nullptr)
 {
 
 }
 
+HASensorNumber::~HASensorNumber()
+{
+    disableDeadband();
+}
+
 bool HASensorNumber::setValue(const HANumeric& value, const bool force)
 {
     if (value.getPrecision() != _precision) {
@@ -25,7 +32,12 @@ bool HASensorNumber::setValue(const HANumeric& value, const bool force)
         return true;
     }
 
-    if (publishValue(value)) {
+    if (!force && _deadband && !_deadband->shouldPublish(value)) {
+        _currentValue = value;
+        return true;
+    }
+
+    if (holdState(force) || publishValue(value) || bufferState()) {
         _currentValue = value;
         return true;
     }
@@ -33,6 +45,24 @@ bool HASensorNumber::setValue(const HANumeric& value, const bool force)
     return false;
 }
 
+void HASensorNumber::setDeadband(
+    const float absolute,
+    const float relative,
+    const float hysteresis
+)
+{
+    disableDeadband();
+    _deadband = new HADeadband(absolute, relative, hysteresis, _precision);
+}
+
+void HASensorNumber::disableDeadband()
+{
+    if (_deadband) {
+        delete _deadband;
+        _deadband = nullptr;
+    }
+}
+
 void HASensorNumber::onMqttConnected()
 {
     if (!uniqueId()) {
@@ -40,6 +70,11 @@ void HASensorNumber::onMqttConnected()
     }
 
     HASensor::onMqttConnected();
+    publishStateOnConnect();
+}
+
+void HASensorNumber::publishCurrentState()
+{
     publishValue(_currentValue);
 }
 
@@ -58,11 +93,19 @@ bool HASensorNumber::publishValue(const HANumeric& value)
     str[size] = 0;
     value.toStr(str);
 
-    return publishOnDataTopic(
+    if (!publishOnDataTopic(
         AHATOFSTR(HAStateTopic),
         str,
         true
-    );
+    )) {
+        return false;
+    }
+
+    if (_deadband) {
+        _deadband->markPublished(value);
+    }
+
+    return true;
 }
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #ifndef EX_ARDUINOHA_SENSOR
 
+class HADeadband;
+
 #define _SET_VALUE_OVERLOAD(type) \
     /** @overload */ \
     inline bool setValue(const type value, const bool force = false) \
@@ -34,9 +36,15 @@ public:
         const uint16_t features = DefaultFeatures
     );
 
+    /**
+     * Frees memory allocated for the deadband.
+     */
+    ~HASensorNumber();
+
     /**
      * Changes value of the sensor and publish MQTT message.
      * Please note that if a new value is the same as the previous one the MQTT message won't be published.
+     * The same applies to values within the deadband (see HASensorNumber::setDeadband).
      *
      * @param value New value of the sensor. THe precision of the value needs to match precision of the sensor.
      * @param force Forces to update the value without comparing it to a previous known value.
@@ -84,8 +92,35 @@ public:
     inline const HANumeric& getCurrentValue() const
         { return _currentValue; }
 
+    /**
+     * Suppresses publishing of values that differ only slightly from the last published value,
+     * e.g. the noise of the ADC or a temperature sensor jittering by one LSB.
+     * The thresholds are converted into the precision of the sensor (see HADeadband).
+     * Values set with the `force` flag are always published.
+     *
+     * @param absolute The absolute deadband (in units of the value).
+     * @param relative The relative deadband (percent of the last published value).
+     * @param hysteresis The additional deadband applied when the direction of the change reverses.
+     */
+    void setDeadband(const float absolute, const float relative = 0, const float hysteresis = 0);
+
+    /**
+     * Disables the deadband. Each change of the value is published.
+     */
+    void disableDeadband();
+
+    /**
+     * Returns the deadband of the sensor or nullptr if it's disabled.
+     */
+    inline const HADeadband* getDeadband() const
+        { return _deadband; }
+
 protected:
     virtual void onMqttConnected() override;
+    virtual void publishCurrentState() override;
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+    virtual bool hasCurrentState() const override { return true; };
+#endif
 
 private:
     /**
@@ -101,6 +136,9 @@ private:
 
     /// The current value of the sensor. By default the value is not set.
     HANumeric _currentValue;
+
+    /// The deadband of published values. It's nullptr if the deadband is disabled.
+    HADeadband* _deadband;
 };
 
 #endif
@@ -22,7 +22,7 @@ bool HASwitch::setState(const bool state, const bool force)
         return true;
     }
 
-    if (publishState(state)) {
+    if (holdState(force) || publishState(state) || bufferState()) {
         _currentState = state;
         return true;
     }
@@ -76,12 +76,31 @@ void HASwitch::onMqttConnected()
     publishAvailability();
 
     if (!_retain) {
-        publishState(_currentState);
+        publishStateOnConnect();
     }
 
     subscribeTopic(uniqueId(), AHATOFSTR(HACommandTopic));
 }
 
+bool HASwitch::hasCommandCallbacks() const
+{
+    return _commandCallback != nullptr;
+}
+
+void HASwitch::publishCurrentState()
+{
+    publishState(_currentState);
+}
+
+void HASwitch::onStateRestore(const bool started)
+{
+    if (!uniqueId()) {
+        return;
+    }
+
+    changeSubscription(uniqueId(), AHATOFSTR(HAStateTopic), started);
+}
+
 void HASwitch::onMqttMessage(
     const char* topic,
     const uint8_t* payload,
@@ -90,11 +109,11 @@ void HASwitch::onMqttMessage(
 {
     (void)payload;
 
-    if (_commandCallback && HASerializer::compareDataTopics(
+    if (_commandCallback && (HASerializer::compareDataTopics(
         topic,
         uniqueId(),
         AHATOFSTR(HACommandTopic)
-    )) {
+    ) || isRestoreMessage(topic, AHATOFSTR(HAStateTopic)))) {
         bool state = length == strlen_P(HAStateOn);
         _commandCallback(state, this);
     }
@@ -0,0 +1,154 @@
+#ifdef ARDUINOHA_TEST
+
+#include "ClientMock.h"
+
+ClientMock::ClientMock() :
+    _input(nullptr),
+    _inputLength(0),
+    _inputPosition(0),
+    _output(nullptr),
+    _outputLength(0),
+    _writesNb(0),
+    _connectionsNb(0),
+    _connected(false),
+    _connectable(true),
+    _writeLimit(SIZE_MAX),
+    _host(nullptr),
+    _port(0)
+{
+
+}
+
+ClientMock::~ClientMock()
+{
+    free(_input);
+    free(_output);
+}
+
+int ClientMock::connect(IPAddress ip, uint16_t port)
+{
+    (void)ip;
+
+    _host = nullptr;
+    _port = port;
+    _connected = _connectable;
+    _connectionsNb++;
+
+    return _connected ? 1 : 0;
+}
+
+int ClientMock::connect(const char* host, uint16_t port)
+{
+    _host = host;
+    _port = port;
+    _connected = _connectable;
+    _connectionsNb++;
+
+    return _connected ? 1 : 0;
+}
+
+size_t ClientMock::write(uint8_t value)
+{
+    return write(&value, 1);
+}
+
+size_t ClientMock::write(const uint8_t* buffer, size_t size)
+{
+    if (!_connected) {
+        return 0;
+    }
+
+    // bytes over the limit are not accepted (short write)
+    if (_outputLength >= _writeLimit) {
+        return 0;
+    } else if (size > _writeLimit - _outputLength) {
+        size = _writeLimit - _outputLength;
+    }
+
+    _output = static_cast<uint8_t*>(realloc(_output, _outputLength + size));
+    memcpy(&_output[_outputLength], buffer, size);
+    _outputLength += size;
+    _writesNb++;
+
+    return size;
+}
+
+int ClientMock::available()
+{
+    return _inputLength - _inputPosition;
+}
+
+int ClientMock::read()
+{
+    if (_inputPosition >= _inputLength) {
+        return -1;
+    }
+
+    return _input[_inputPosition++];
+}
+
+int ClientMock::read(uint8_t* buffer, size_t size)
+{
+    const size_t availableLength = _inputLength - _inputPosition;
+    if (size > availableLength) {
+        size = availableLength;
+    }
+
+    memcpy(buffer, &_input[_inputPosition], size);
+    _inputPosition += size;
+
+    return size;
+}
+
+int ClientMock::peek()
+{
+    if (_inputPosition >= _inputLength) {
+        return -1;
+    }
+
+    return _input[_inputPosition];
+}
+
+void ClientMock::flush()
+{
+
+}
+
+void ClientMock::stop()
+{
+    _connected = false;
+}
+
+uint8_t ClientMock::connected()
+{
+    return _connected;
+}
+
+ClientMock::operator bool()
+{
+    return _connected;
+}
+
+void ClientMock::feed(const uint8_t* data, size_t length)
+{
+    // consumed bytes are dropped
+    const size_t remainingLength = _inputLength - _inputPosition;
+    if (remainingLength > 0) {
+        memmove(_input, &_input[_inputPosition], remainingLength);
+    }
+
+    _input = static_cast<uint8_t*>(realloc(_input, remainingLength + length));
+    memcpy(&_input[remainingLength], data, length);
+    _inputLength = remainingLength + length;
+    _inputPosition = 0;
+}
+
+void ClientMock::clearOutput()
+{
+    free(_output);
+    _output = nullptr;
+    _outputLength = 0;
+    _writesNb = 0;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef AHA_CLIENTMOCK_H
+#define AHA_CLIENTMOCK_H
+
+#ifdef ARDUINOHA_TEST
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+
+/**
+ * Loopback stand-in of the network client.
+ * Bytes written by the tested code are collected in the output buffer,
+ * while bytes fed by the test are returned by the read methods.
+ */
+class ClientMock : public Client
+{
+public:
+    ClientMock();
+    ~ClientMock();
+
+    virtual int connect(IPAddress ip, uint16_t port) override;
+    virtual int connect(const char* host, uint16_t port) override;
+    virtual size_t write(uint8_t value) override;
+    virtual size_t write(const uint8_t* buffer, size_t size) override;
+    virtual int available() override;
+    virtual int read() override;
+    virtual int read(uint8_t* buffer, size_t size) override;
+    virtual int peek() override;
+    virtual void flush() override;
+    virtual void stop() override;
+    virtual uint8_t connected() override;
+    virtual operator bool() override;
+
+    void feed(const uint8_t* data, size_t length);
+    void clearOutput();
+
+    inline void closeRemote()
+        { _connected = false; }
+
+    inline void setConnectable(bool connectable)
+        { _connectable = connectable; }
+
+    inline void setWriteLimit(size_t limit)
+        { _writeLimit = limit; }
+
+    inline const uint8_t* getOutput() const
+        { return _output; }
+
+    inline size_t getOutputLength() const
+        { return _outputLength; }
+
+    inline uint32_t getWritesNb() const
+        { return _writesNb; }
+
+    inline uint32_t getConnectionsNb() const
+        { return _connectionsNb; }
+
+    inline const char* getHost() const
+        { return _host; }
+
+    inline uint16_t getPort() const
+        { return _port; }
+
+private:
+    uint8_t* _input;
+    size_t _inputLength;
+    size_t _inputPosition;
+    uint8_t* _output;
+    size_t _outputLength;
+    uint32_t _writesNb;
+    uint32_t _connectionsNb;
+    bool _connected;
+    bool _connectable;
+    size_t _writeLimit;
+    const char* _host;
+    uint16_t _port;
+};
+
+#endif
+#endif
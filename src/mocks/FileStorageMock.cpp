@@ -0,0 +1,74 @@
+#include "FileStorageMock.h"
+#ifdef ARDUINOHA_TEST
+
+#include <stdio.h>
+
+FileStorageMock::FileStorageMock(const char* path) :
+    _path(path),
+    _writesNb(0)
+{
+
+}
+
+bool FileStorageMock::read(const char* key, uint32_t& value)
+{
+    FILE* file = fopen(_path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char storedKey[MaxLineLength];
+    unsigned long storedValue = 0;
+    bool found = false;
+
+    while (fscanf(file, "%95s %lx", storedKey, &storedValue) == 2) {
+        if (strcmp(storedKey, key) == 0) {
+            value = storedValue;
+            found = true;
+            break;
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+bool FileStorageMock::write(const char* key, const uint32_t value)
+{
+    char tmpPath[strlen(_path) + 5];
+    strcpy(tmpPath, _path);
+    strcat(tmpPath, ".tmp");
+
+    FILE* output = fopen(tmpPath, "w");
+    if (!output) {
+        return false;
+    }
+
+    FILE* input = fopen(_path, "r");
+    if (input) {
+        char storedKey[MaxLineLength];
+        unsigned long storedValue = 0;
+
+        while (fscanf(input, "%95s %lx", storedKey, &storedValue) == 2) {
+            if (strcmp(storedKey, key) != 0) {
+                fprintf(output, "%s %lx\n", storedKey, storedValue);
+            }
+        }
+
+        fclose(input);
+    }
+
+    fprintf(output, "%s %lx\n", key, static_cast<unsigned long>(value));
+    fclose(output);
+
+    _writesNb++;
+    return rename(tmpPath, _path) == 0;
+}
+
+void FileStorageMock::clear()
+{
+    remove(_path);
+    _writesNb = 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef AHA_FILESTORAGEMOCK_H
+#define AHA_FILESTORAGEMOCK_H
+
+#ifdef ARDUINOHA_TEST
+
+#include <Arduino.h>
+#include "../utils/HAStorage.h"
+
+/**
+ * File-backed implementation of the HAStorage interface for the host build.
+ * Each entry is stored in a separate line as `[key] [hex value]`.
+ */
+class FileStorageMock : public HAStorage
+{
+public:
+    FileStorageMock(const char* path);
+
+    virtual bool read(const char* key, uint32_t& value) override;
+    virtual bool write(const char* key, const uint32_t value) override;
+
+    /**
+     * Removes the file of the storage.
+     */
+    void clear();
+
+    inline uint16_t getWritesNb() const
+        { return _writesNb; }
+
+private:
+    static const uint8_t MaxLineLength = 96;
+
+    const char* _path;
+    uint16_t _writesNb;
+};
+
+#endif
+#endif
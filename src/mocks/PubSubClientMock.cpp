@@ -9,9 +9,21 @@ PubSubClientMock::PubSubClientMock() :
     _keepAlive(15),
     _bufferSize(256),
     _state(-1),
+    _writesNb(0),
+    _sessionPresent(false),
+    _networkAvailable(true),
+    _connackAvailable(true),
+    _connackPending(false),
+    _connectStartedAt(0),
+    _networkTimeout(0),
+    _socketTimeout(15),
     _flushedMessagesNb(0),
     _subscriptions(nullptr),
     _subscriptionsNb(0),
+    _subscribePacketsNb(0),
+    _inflightWindowSize(0),
+    _packetId(0),
+    _lastPacketId(0),
     callback(nullptr)
 {
 
@@ -35,6 +47,7 @@ bool PubSubClientMock::loop()
 void PubSubClientMock::disconnect()
 {
     _connection.connected = false;
+    _connackPending = false;
 }
 
 bool PubSubClientMock::connected()
@@ -54,9 +67,13 @@ bool PubSubClientMock::connect(
 )
 {
     (void)willQos;
-    (void)cleanSession;
+
+    if (!_networkAvailable) {
+        return false;
+    }
 
     _connection.connected = true;
+    _connection.cleanSession = cleanSession;
     _connection.id = id;
     _connection.user = user;
     _connection.pass = pass;
@@ -68,6 +85,49 @@ bool PubSubClientMock::connect(
     return true;
 }
 
+bool PubSubClientMock::beginConnect(
+    const char *id,
+    const char *user,
+    const char *pass,
+    const char* willTopic,
+    uint8_t willQos,
+    bool willRetain,
+    const char* willMessage,
+    bool cleanSession
+)
+{
+    if (!connect(id, user, pass, willTopic, willQos, willRetain, willMessage, cleanSession)) {
+        return false;
+    }
+
+    // the connection is established by the CONNACK packet
+    _connection.connected = false;
+    _connackPending = true;
+    _connectStartedAt = millis();
+
+    return true;
+}
+
+bool PubSubClientMock::pollConnack()
+{
+    if (!_connackPending) {
+        return connected();
+    }
+
+    if (_connackAvailable) {
+        _connackPending = false;
+        _connection.connected = true;
+        return true;
+    }
+
+    if ((millis() - _connectStartedAt) >= _socketTimeout * 1000UL) {
+        _connackPending = false;
+        _state = -4; // MQTT_CONNECTION_TIMEOUT
+    }
+
+    return false;
+}
+
 bool PubSubClientMock::connectDummy()
 {
     _connection.connected = true;
@@ -82,6 +142,11 @@ bool PubSubClientMock::connectDummy()
     return true;
 }
 
+bool PubSubClientMock::connectNetwork()
+{
+    return _networkAvailable;
+}
+
 PubSubClientMock& PubSubClientMock::setServer(IPAddress ip, uint16_t port)
 {
     _connection.ip = ip;
@@ -110,7 +175,8 @@ PubSubClientMock& PubSubClientMock::setCallback(MQTT_CALLBACK_SIGNATURE)
 bool PubSubClientMock::beginPublish(
     const char* topic,
     unsigned int plength,
-    bool retained
+    bool retained,
+    uint8_t qos
 )
 {
     if (!connected()) {
@@ -123,6 +189,7 @@ bool PubSubClientMock::beginPublish(
 
     _pendingMessage = new MqttMessage();
     _pendingMessage->retained = retained;
+    _pendingMessage->qos = qos;
 
     {
         size_t size = strlen(topic) + 1;
@@ -150,6 +217,7 @@ size_t PubSubClientMock::write(const uint8_t *buffer, size_t size)
         return 0;
     }
 
+    _writesNb++;
     strncat(_pendingMessage->buffer, (const char*)buffer, size);
     return size;
 }
@@ -185,22 +253,65 @@ int PubSubClientMock::endPublish()
 
 bool PubSubClientMock::subscribe(const char* topic)
 {
-    uint8_t index = _subscriptionsNb;
+    _subscribePacketsNb++;
+    addSubscription(topic, strlen(topic));
+    return true;
+}
 
-    _subscriptionsNb++;
-    _subscriptions = static_cast<MqttSubscription**>(
-        realloc(_subscriptions, _subscriptionsNb * sizeof(MqttSubscription*))
-    );
+bool PubSubClientMock::writePacket(const uint8_t* packet, uint16_t length)
+{
+    // only SUBSCRIBE packets are supported
+    if (!_connection.connected || length < 2 || packet[0] != 0x82) {
+        return false;
+    }
 
-    size_t topicSize = strlen(topic) + 1;
-    MqttSubscription* subscription = new MqttSubscription();
-    subscription->topic = new char[topicSize];
-    memcpy(subscription->topic, topic, topicSize);
+    uint16_t offset = 1;
+    while (offset < length && (packet[offset] & 0x80)) {
+        offset++;
+    }
+
+    _lastPacketId = (packet[offset + 1] << 8) | packet[offset + 2];
+    offset += 3; // the last byte of the remaining length and the packet identifier
+    _subscribePacketsNb++;
+
+    while (offset + 2 < length) {
+        const uint16_t topicLength = (packet[offset] << 8) | packet[offset + 1];
+        addSubscription(reinterpret_cast<const char*>(&packet[offset + 2]), topicLength);
+        offset += 2 + topicLength + 1; // with the requested QoS
+    }
 
-    _subscriptions[index] = subscription;
     return true;
 }
 
+uint16_t PubSubClientMock::nextPacketId()
+{
+    if (++_packetId == 0) {
+        _packetId = 1;
+    }
+
+    return _packetId;
+}
+
+bool PubSubClientMock::unsubscribe(const char* topic)
+{
+    for (uint8_t i = 0; i < _subscriptionsNb; i++) {
+        if (strcmp(_subscriptions[i]->topic, topic) != 0) {
+            continue;
+        }
+
+        delete _subscriptions[i];
+        _subscriptionsNb--;
+        memmove(
+            &_subscriptions[i],
+            &_subscriptions[i + 1],
+            (_subscriptionsNb - i) * sizeof(MqttSubscription*)
+        );
+        return true;
+    }
+
+    return false;
+}
+
 void PubSubClientMock::clearFlushedMessages()
 {
     if (_flushedMessages) {
@@ -208,7 +319,8 @@ void PubSubClientMock::clearFlushedMessages()
             delete _flushedMessages[i];
         }
 
-        delete _flushedMessages;
+        free(_flushedMessages);
+        _flushedMessages = nullptr;
     }
 
     _flushedMessagesNb = 0;
@@ -221,10 +333,29 @@ void PubSubClientMock::clearSubscriptions()
             delete _subscriptions[i];
         }
 
-        delete _subscriptions;
+        free(_subscriptions);
+        _subscriptions = nullptr;
     }
 
     _subscriptionsNb = 0;
+    _subscribePacketsNb = 0;
+}
+
+void PubSubClientMock::addSubscription(const char* topic, size_t length)
+{
+    uint8_t index = _subscriptionsNb;
+
+    _subscriptionsNb++;
+    _subscriptions = static_cast<MqttSubscription**>(
+        realloc(_subscriptions, _subscriptionsNb * sizeof(MqttSubscription*))
+    );
+
+    MqttSubscription* subscription = new MqttSubscription();
+    subscription->topic = new char[length + 1];
+    memcpy(subscription->topic, topic, length);
+    subscription->topic[length] = 0;
+
+    _subscriptions[index] = subscription;
 }
 
 void PubSubClientMock::fakeMessage(const char* topic, const char* message)
@@ -20,13 +20,15 @@ struct MqttMessage
     char* buffer;
     size_t bufferSize;
     bool retained;
+    uint8_t qos;
 
     MqttMessage() :
         topic(nullptr),
         topicSize(0),
         buffer(nullptr),
         bufferSize(0),
-        retained(false)
+        retained(false),
+        qos(0)
     {
 
     }
@@ -63,6 +65,7 @@ struct MqttSubscription {
 struct MqttConnection
 {
     bool connected;
+    bool cleanSession;
     const char* domain;
     IPAddress ip;
     uint16_t port;
@@ -72,6 +75,7 @@ struct MqttConnection
 
     MqttConnection() :
         connected(false),
+        cleanSession(true),
         domain(nullptr),
         port(0),
         id(nullptr),
@@ -116,16 +120,39 @@ public:
         const char* willMessage,
         bool cleanSession
     );
+    bool beginConnect(
+        const char *id,
+        const char *user,
+        const char *pass,
+        const char* willTopic,
+        uint8_t willQos,
+        bool willRetain,
+        const char* willMessage,
+        bool cleanSession
+    );
+    bool pollConnack();
     bool connectDummy();
+    bool connectNetwork();
     PubSubClientMock& setServer(IPAddress ip, uint16_t port);
     PubSubClientMock& setServer(const char* domain, uint16_t port);
     PubSubClientMock& setCallback(MQTT_CALLBACK_SIGNATURE);
 
-    bool beginPublish(const char* topic, unsigned int plength, bool retained);
+    bool beginPublish(
+        const char* topic,
+        unsigned int plength,
+        bool retained,
+        uint8_t qos = 0
+    );
     size_t write(const uint8_t *buffer, size_t size);
     size_t print(const __FlashStringHelper* buffer);
     int endPublish();
     bool subscribe(const char* topic);
+    bool unsubscribe(const char* topic);
+    bool writePacket(const uint8_t* packet, uint16_t length);
+    uint16_t nextPacketId();
+
+    inline uint16_t getLastPacketId() const
+        { return _lastPacketId; }
 
     inline void setKeepAlive(uint16_t keepAlive)
         { _keepAlive = keepAlive; }
@@ -145,6 +172,63 @@ public:
     inline int16_t state() const
         { return _state; }
 
+    inline void setNetworkAvailable(bool networkAvailable)
+        { _networkAvailable = networkAvailable; }
+
+    inline void setConnackAvailable(bool connackAvailable)
+        { _connackAvailable = connackAvailable; }
+
+    inline bool isConnecting() const
+        { return _connackPending; }
+
+    inline void setNetworkTimeout(uint32_t timeout)
+        { _networkTimeout = timeout; }
+
+    inline uint32_t getNetworkTimeout() const
+        { return _networkTimeout; }
+
+    inline void setSocketTimeout(uint16_t timeout)
+        { _socketTimeout = timeout; }
+
+    inline uint16_t getSocketTimeout() const
+        { return _socketTimeout; }
+
+    inline void setSessionPresent(bool sessionPresent)
+        { _sessionPresent = sessionPresent; }
+
+    inline bool isSessionPresent() const
+        { return _sessionPresent; }
+
+    inline bool setInflightWindow(
+        uint8_t windowSize,
+        uint16_t maxPacketSize,
+        uint16_t retryInterval,
+        uint8_t maxRetries
+    )
+    {
+        (void)maxPacketSize;
+        (void)retryInterval;
+        (void)maxRetries;
+
+        _inflightWindowSize = windowSize;
+        return true;
+    }
+
+    inline uint8_t getInflightWindowSize() const
+        { return _inflightWindowSize; }
+
+    inline uint8_t getInflightMessagesNb() const
+        { return 0; }
+
+    inline uint32_t getRetriedMessagesNb() const
+        { return 0; }
+
+    inline uint32_t getDroppedMessagesNb() const
+        { return 0; }
+
+    inline uint32_t getWritesNb() const
+        { return _writesNb; }
+
     inline uint8_t getFlushedMessagesNb() const
         { return _flushedMessagesNb; }
 
@@ -157,6 +241,9 @@ public:
     inline MqttSubscription** getSubscriptions() const
         { return _subscriptions; }
 
+    inline uint8_t getSubscribePacketsNb() const
+        { return _subscribePacketsNb; }
+
     inline const MqttConnection& getConnection() const
         { return _connection; }
 
@@ -170,14 +257,28 @@ public:
     void fakeMessage(const __FlashStringHelper* topic, const __FlashStringHelper* message);
 
 private:
+    void addSubscription(const char* topic, size_t length);
+
     MqttMessage* _pendingMessage;
     MqttMessage** _flushedMessages;
     uint16_t _keepAlive;
     uint16_t _bufferSize;
     int16_t _state;
+    uint32_t _writesNb;
+    bool _sessionPresent;
+    bool _networkAvailable;
+    bool _connackAvailable;
+    bool _connackPending;
+    uint32_t _connectStartedAt;
+    uint32_t _networkTimeout;
+    uint16_t _socketTimeout;
     uint8_t _flushedMessagesNb;
     MqttSubscription** _subscriptions;
     uint8_t _subscriptionsNb;
+    uint8_t _subscribePacketsNb;
+    uint8_t _inflightWindowSize;
+    uint16_t _packetId;
+    uint16_t _lastPacketId;
     MqttConnection _connection;
     MqttWill _lastWill;
     MQTT_CALLBACK_SIGNATURE;
@@ -0,0 +1,80 @@
+#include <Arduino.h>
+
+#include "HABase64.h"
+
+// it's defined first, so the compiler can inline it in the loop
+inline void HABase64::encodeGroup(char* output, const uint32_t group)
+{
+    static const uint32_t Ones = 0x01010101;
+
+    // each sextet goes to a separate byte (lane), the first sextet to the lowest one
+    const uint32_t sextets =
+        ((group >> 18) & 0x3F) |
+        ((group >> 4) & 0x3F00) |
+        ((group << 10) & 0x3F0000) |
+        ((group << 24) & 0x3F000000);
+
+    // the highest bit of the lane is set if the sextet is greater or equal to the given value
+    // sextets are lower than 64, so the addition never carries into the next lane
+    const uint32_t from26 = ((sextets + (0x80 - 26) * Ones) >> 7) & Ones;
+    const uint32_t from52 = ((sextets + (0x80 - 52) * Ones) >> 7) & Ones;
+    const uint32_t from62 = ((sextets + (0x80 - 62) * Ones) >> 7) & Ones;
+    const uint32_t from63 = ((sextets + (0x80 - 63) * Ones) >> 7) & Ones;
+
+    // A-Z: +65, a-z: +71, 0-9: -4, '+': -19, '/': -16
+    // the subtracted value never exceeds the lane, so there is no borrow between lanes
+    const uint32_t chars =
+        (sextets + 65 * Ones + 6 * from26 + 3 * from63) -
+        (75 * from52 + 15 * from62);
+
+    output[0] = chars & 0xFF;
+    output[1] = (chars >> 8) & 0xFF;
+    output[2] = (chars >> 16) & 0xFF;
+    output[3] = chars >> 24;
+}
+
+uint32_t HABase64::calculateEncodedLength(const uint32_t length)
+{
+    return ((length + 2) / 3) * 4;
+}
+
+uint32_t HABase64::encode(char* output, const uint8_t* data, const uint32_t length)
+{
+    const uint32_t groupsNb = length / 3;
+    const uint8_t tailLength = length % 3;
+
+    encodeGroups(output, data, groupsNb);
+
+    if (tailLength > 0) {
+        encodeTail(&output[groupsNb * 4], &data[groupsNb * 3], tailLength);
+    }
+
+    return calculateEncodedLength(length);
+}
+
+void HABase64::encodeGroups(char* output, const uint8_t* data, const uint32_t groupsNb)
+{
+    for (uint32_t i = 0; i < groupsNb; i++) {
+        encodeGroup(
+            output,
+            ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2]
+        );
+
+        output += 4;
+        data += 3;
+    }
+}
+
+void HABase64::encodeTail(char* output, const uint8_t* data, const uint8_t length)
+{
+    encodeGroup(
+        output,
+        ((uint32_t)data[0] << 16) | (length > 1 ? ((uint32_t)data[1] << 8) : 0)
+    );
+
+    output[3] = '=';
+
+    if (length == 1) {
+        output[2] = '=';
+    }
+}
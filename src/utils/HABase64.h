@@ -0,0 +1,63 @@
+#ifndef AHA_HABASE64_H
+#define AHA_HABASE64_H
+
+#include <stdint.h>
+
+/**
+ * HABase64 encodes binary data into base64 (RFC 4648) without allocating memory.
+ * Each group of three bytes is encoded as a single 32-bit word (four characters at once),
+ * so the encoder doesn't need a lookup table and it can be used to encode data in fixed-size blocks.
+ */
+class HABase64
+{
+public:
+    /// The size of the output block that's used for encoding streamed data (characters).
+    static const uint8_t BlockSize = 128;
+
+    /**
+     * Calculates the length of the base64 representation of the given number of bytes (including the padding).
+     *
+     * @param length The length of the binary data (bytes).
+     */
+    static uint32_t calculateEncodedLength(const uint32_t length);
+
+    /**
+     * Encodes the given data including the padding.
+     * The output is not null-terminated.
+     *
+     * @param output The output buffer. It needs to fit HABase64::calculateEncodedLength(length) characters.
+     * @param data The data to encode.
+     * @param length The length of the data (bytes).
+     * @returns The number of characters written to the output.
+     */
+    static uint32_t encode(char* output, const uint8_t* data, const uint32_t length);
+
+    /**
+     * Encodes the given number of complete groups (three bytes each) without the padding.
+     *
+     * @param output The output buffer. It needs to fit `groupsNb * 4` characters.
+     * @param data The data to encode. It needs to contain `groupsNb * 3` bytes.
+     * @param groupsNb The number of groups to encode.
+     */
+    static void encodeGroups(char* output, const uint8_t* data, const uint32_t groupsNb);
+
+    /**
+     * Encodes the incomplete group at the end of the data (one or two bytes) including the padding.
+     *
+     * @param output The output buffer. It needs to fit 4 characters.
+     * @param data The data to encode.
+     * @param length The length of the data (1 or 2 bytes).
+     */
+    static void encodeTail(char* output, const uint8_t* data, const uint8_t length);
+
+private:
+    /**
+     * Encodes a single group and writes four characters to the output.
+     *
+     * @param output The output buffer.
+     * @param group The 24-bit group (the first byte is the most significant one).
+     */
+    static void encodeGroup(char* output, const uint32_t group);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+
+#include "HADeadband.h"
+#include "HANumeric.h"
+
+HADeadband::HADeadband(
+    const float absolute,
+    const float relative,
+    const float hysteresis,
+    const uint8_t precision
+) :
+    _absolute(toBaseValue(absolute, precision)),
+    _hysteresis(toBaseValue(hysteresis, precision)),
+    _relative(0),
+    _precision(precision),
+    _direction(0),
+    _hasReference(false),
+    _reference(0),
+    _suppressedNb(0)
+{
+    if (relative > 0) {
+        const float hundredths = relative * 100 + 0.5f;
+        _relative = hundredths > UINT16_MAX ? UINT16_MAX : (uint16_t)hundredths;
+    }
+}
+
+bool HADeadband::shouldPublish(const HANumeric& value)
+{
+    if (!_hasReference || !value.isSet() || value.getPrecision() != _precision) {
+        return true;
+    }
+
+    const int64_t delta = value.getBaseValue() - _reference;
+    const uint64_t magnitude = delta < 0 ? -delta : delta;
+    const uint64_t reference = _reference < 0 ? -_reference : _reference;
+    const int8_t direction = delta < 0 ? -1 : 1;
+
+    uint64_t threshold = _absolute;
+    if (_direction != 0 && direction != _direction) {
+        threshold += _hysteresis;
+    }
+
+    if (
+        magnitude > threshold &&
+        magnitude * 10000 > reference * _relative
+    ) {
+        return true;
+    }
+
+    _suppressedNb++;
+    return false;
+}
+
+void HADeadband::markPublished(const HANumeric& value)
+{
+    if (!value.isSet() || value.getPrecision() != _precision) {
+        _hasReference = false;
+        _direction = 0;
+        return;
+    }
+
+    const int64_t baseValue = value.getBaseValue();
+    if (_hasReference && baseValue != _reference) {
+        _direction = baseValue < _reference ? -1 : 1;
+    }
+
+    _hasReference = true;
+    _reference = baseValue;
+}
+
+uint32_t HADeadband::toBaseValue(const float value, const uint8_t precision)
+{
+    if (value <= 0) {
+        return 0;
+    }
+
+    return HANumeric(value, precision).getBaseValue();
+}
@@ -0,0 +1,105 @@
+#ifndef AHA_HADEADBAND_H
+#define AHA_HADEADBAND_H
+
+#include <stdint.h>
+
+class HANumeric;
+
+/**
+ * HADeadband decides whether a new numeric value differs enough from the last published one to be published.
+ * All thresholds are converted into the base value of HANumeric (fixed point) of the given precision,
+ * so the evaluation doesn't use floating point arithmetic.
+ *
+ * The value is published if the difference from the last published value is greater than the absolute deadband
+ * and greater than the relative deadband (a percentage of the last published value).
+ * If the hysteresis is set, a change in the opposite direction to the last published change needs to be
+ * greater than the deadband plus the hysteresis, so the value oscillating between two levels is published once.
+ */
+class HADeadband
+{
+public:
+    /**
+     * @param absolute The absolute deadband (in units of the value, e.g. `0.5` degrees).
+     * @param relative The relative deadband (percent of the last published value, e.g. `1.5` %).
+     * @param hysteresis The additional deadband applied when the direction of the change reverses.
+     * @param precision The precision of values that will be compared (the number of digits in the decimal part).
+     */
+    HADeadband(
+        const float absolute,
+        const float relative,
+        const float hysteresis,
+        const uint8_t precision
+    );
+
+    /**
+     * Returns `true` if the given value should be published.
+     * Suppressed values are counted (see HADeadband::getSuppressedNb).
+     *
+     * @param value The new value.
+     */
+    bool shouldPublish(const HANumeric& value);
+
+    /**
+     * Sets the given value as the reference for the next comparisons.
+     * It needs to be called each time the value is published.
+     *
+     * @param value The published value.
+     */
+    void markPublished(const HANumeric& value);
+
+    /**
+     * Returns the absolute deadband (base value of HANumeric).
+     */
+    inline uint32_t getAbsolute() const
+        { return _absolute; }
+
+    /**
+     * Returns the relative deadband (hundredths of percent).
+     */
+    inline uint16_t getRelative() const
+        { return _relative; }
+
+    /**
+     * Returns the hysteresis (base value of HANumeric).
+     */
+    inline uint32_t getHysteresis() const
+        { return _hysteresis; }
+
+    /**
+     * Returns the number of values that were suppressed.
+     */
+    inline uint32_t getSuppressedNb() const
+        { return _suppressedNb; }
+
+private:
+    /**
+     * Converts the given threshold into the base value of the given precision.
+     */
+    static uint32_t toBaseValue(const float value, const uint8_t precision);
+
+    /// The absolute deadband (base value).
+    uint32_t _absolute;
+
+    /// The hysteresis (base value).
+    uint32_t _hysteresis;
+
+    /// The relative deadband (hundredths of percent).
+    uint16_t _relative;
+
+    /// The precision of compared values.
+    uint8_t _precision;
+
+    /// The direction of the last published change: -1, 0 (unknown) or 1.
+    int8_t _direction;
+
+    /// Specifies whether the `_reference` is set.
+    bool _hasReference;
+
+    /// The last published value (base value).
+    int64_t _reference;
+
+    /// The number of suppressed values.
+    uint32_t _suppressedNb;
+};
+
+#endif
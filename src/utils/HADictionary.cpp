@@ -19,6 +19,7 @@ const char HAComponentFan[] PROGMEM = {"fan"};
 const char HAComponentLight[] PROGMEM = {"light"};
 const char HAComponentClimate[] PROGMEM = {"climate"};
 const char HAComponentAlarmControlPanel[] PROGMEM = {"alarm_control_panel"};
+const char HAComponentDevice[] PROGMEM = {"device"};
 
 
 // decorators
@@ -31,6 +32,8 @@ const char HASerializerJsonEscapeChar[] PROGMEM = {"\""};
 const char HASerializerJsonPropertiesSeparator[] PROGMEM = {","};
 const char HASerializerJsonArrayPrefix[] PROGMEM = {"["};
 const char HASerializerJsonArraySuffix[] PROGMEM = {"]"};
+const char HASerializerBaseTopicProperty[] PROGMEM = {"~"};
+const char HASerializerBaseTopicPrefix[] PROGMEM = {"~/"};
 const char HASerializerUnderscore[] PROGMEM = {"_"};
 
 // properties
@@ -83,9 +86,14 @@ const char HACodeArmRequiredProperty[] PROGMEM = {"cod_arm_req"};
 const char HACodeDisarmRequiredProperty[] PROGMEM = {"cod_dis_req"};
 const char HACodeTriggerRequiredProperty[] PROGMEM = {"cod_trig_req"};
 const char HACodeProperty[] PROGMEM = {"code"};
+const char HAPlatformProperty[] PROGMEM = {"p"};
+const char HAOriginProperty[] PROGMEM = {"o"};
+const char HAComponentsProperty[] PROGMEM = {"cmps"};
 
 // topics
 const char HAConfigTopic[] PROGMEM = {"config"};
+const char HAStatusTopic[] PROGMEM = {"status"};
+const char HAWildcardTopic[] PROGMEM = {"#"};
 const char HAAvailabilityTopic[] PROGMEM = {"avty_t"};
 const char HATopic[] PROGMEM = {"t"};
 const char HAStateTopic[] PROGMEM = {"stat_t"};
@@ -152,6 +160,7 @@ const char HAStateDisarmed[] PROGMEM = {"disarmed"};
 const char HAStateDisarming[] PROGMEM = {"disarming"};
 const char HAStatePending[] PROGMEM = {"pending"};
 const char HAStateTriggered[] PROGMEM = {"triggered"};
+const char HAOriginName[] PROGMEM = {"ArduinoHA"};
 
 // covers
 const char HAClosedState[] PROGMEM = {"closed"};
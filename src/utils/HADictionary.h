@@ -19,6 +19,7 @@ extern const char HAComponentFan[];
 extern const char HAComponentLight[];
 extern const char HAComponentClimate[];
 extern const char HAComponentAlarmControlPanel[];
+extern const char HAComponentDevice[];
 
 // decorators
 extern const char HASerializerSlash[];
@@ -30,6 +31,8 @@ extern const char HASerializerJsonEscapeChar[];
 extern const char HASerializerJsonPropertiesSeparator[];
 extern const char HASerializerJsonArrayPrefix[];
 extern const char HASerializerJsonArraySuffix[];
+extern const char HASerializerBaseTopicProperty[];
+extern const char HASerializerBaseTopicPrefix[];
 extern const char HASerializerUnderscore[];
 
 // properties
@@ -82,9 +85,14 @@ extern const char HACodeArmRequiredProperty[];
 extern const char HACodeDisarmRequiredProperty[];
 extern const char HACodeTriggerRequiredProperty[];
 extern const char HACodeProperty[];
+extern const char HAPlatformProperty[];
+extern const char HAOriginProperty[];
+extern const char HAComponentsProperty[];
 
 // topics
 extern const char HAConfigTopic[];
+extern const char HAStatusTopic[];
+extern const char HAWildcardTopic[];
 extern const char HAAvailabilityTopic[];
 extern const char HATopic[];
 extern const char HAStateTopic[];
@@ -152,6 +160,7 @@ extern const char HAStateDisarmed[];
 extern const char HAStateDisarming[];
 extern const char HAStatePending[];
 extern const char HAStateTriggered[];
+extern const char HAOriginName[];
 
 // covers
 extern const char HAClosedState[];
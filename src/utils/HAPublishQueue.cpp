@@ -0,0 +1,130 @@
+#include <Arduino.h>
+
+#include "HAPublishQueue.h"
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+
+HAPublishQueue::HAPublishQueue(
+    const uint8_t maxMessagesNb,
+    const uint16_t maxPayloadSize
+) :
+    _messages(new Message[maxMessagesNb]),
+    _payloads(new uint8_t[(uint32_t)maxMessagesNb * maxPayloadSize]),
+    _order(new uint8_t[maxMessagesNb]),
+    _maxMessagesNb(maxMessagesNb),
+    _maxPayloadSize(maxPayloadSize),
+    _messagesNb(0),
+    _coalescedMessagesNb(0)
+{
+    clear();
+}
+
+HAPublishQueue::~HAPublishQueue()
+{
+    delete[] _messages;
+    delete[] _payloads;
+    delete[] _order;
+}
+
+bool HAPublishQueue::push(
+    const char* objectId,
+    const __FlashStringHelper* topic,
+    const uint8_t* payload,
+    const uint16_t length,
+    const bool retained,
+    const bool isProgmemData,
+    const uint8_t qos
+)
+{
+    if (!topic || length > _maxPayloadSize) {
+        return false;
+    }
+
+    // the queue is small, so the linear lookup is faster than hashing
+    Message* message = nullptr;
+    for (uint8_t i = 0; i < _messagesNb; i++) {
+        Message& pending = _messages[_order[i]];
+        if (pending.objectId == objectId && pending.topic == topic) {
+            message = &pending;
+            _coalescedMessagesNb++;
+            break;
+        }
+    }
+
+    if (!message) {
+        if (_messagesNb >= _maxMessagesNb) {
+            return false;
+        }
+
+        uint8_t slot = 0;
+        while (_messages[slot].topic) {
+            slot++;
+        }
+
+        message = &_messages[slot];
+        message->objectId = objectId;
+        message->topic = topic;
+        _order[_messagesNb++] = slot;
+    }
+
+    uint8_t* output = &_payloads[(uint32_t)(message - _messages) * _maxPayloadSize];
+    if (isProgmemData) {
+        memcpy_P(output, payload, length);
+    } else {
+        memcpy(output, payload, length);
+    }
+
+    message->length = length;
+    message->retained = retained;
+    message->qos = qos;
+
+    return true;
+}
+
+const HAPublishQueue::Message* HAPublishQueue::front() const
+{
+    if (_messagesNb == 0) {
+        return nullptr;
+    }
+
+    return &_messages[_order[0]];
+}
+
+void HAPublishQueue::pop()
+{
+    if (_messagesNb == 0) {
+        return;
+    }
+
+    Message& message = _messages[_order[0]];
+    message.objectId = nullptr;
+    message.topic = nullptr;
+
+    _messagesNb--;
+    memmove(_order, _order + 1, _messagesNb);
+}
+
+void HAPublishQueue::clear()
+{
+    for (uint8_t i = 0; i < _maxMessagesNb; i++) {
+        Message& message = _messages[i];
+        message.objectId = nullptr;
+        message.topic = nullptr;
+        message.payload = &_payloads[(uint32_t)i * _maxPayloadSize];
+        message.length = 0;
+        message.retained = false;
+        message.qos = 0;
+    }
+
+    _messagesNb = 0;
+}
+
+uint32_t HAPublishQueue::calculateMemoryUsage() const
+{
+    return
+        sizeof(HAPublishQueue) +
+        _maxMessagesNb * sizeof(Message) +
+        (uint32_t)_maxMessagesNb * _maxPayloadSize +
+        _maxMessagesNb;
+}
+
+#endif
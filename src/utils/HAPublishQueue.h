@@ -0,0 +1,130 @@
+#ifndef AHA_HAPUBLISHQUEUE_H
+#define AHA_HAPUBLISHQUEUE_H
+
+#include <stdint.h>
+#include "../ArduinoHADefines.h"
+
+#ifdef ARDUINOHA_PUBLISH_QUEUE
+
+/**
+ * HAPublishQueue holds outbound messages of the data topics until HAMqtt drains them.
+ * Messages are keyed by the object ID and the topic name, so a newer value for the same topic
+ * replaces the pending one (latest value wins) and keeps its position in the queue.
+ * All memory is allocated in the constructor. The queue is owned by the HAMqtt class and it's disabled by default.
+ */
+class HAPublishQueue
+{
+public:
+    /// Representation of a single pending message.
+    struct Message {
+        /// The unique ID of a device type that owns the topic (pointer is used as a key). It's nullptr if the slot is free.
+        const char* objectId;
+
+        /// The topic name (pointer is used as a key). It's nullptr if the slot is free.
+        const __FlashStringHelper* topic;
+
+        /// The payload of the message (stored in the RAM).
+        const uint8_t* payload;
+
+        /// Length of the payload.
+        uint16_t length;
+
+        /// Specifies whether the message should be retained.
+        bool retained;
+
+        /// QoS of the message.
+        uint8_t qos;
+    };
+
+    /**
+     * Allocates slots of the queue.
+     *
+     * @param maxMessagesNb The maximum number of pending messages.
+     * @param maxPayloadSize The maximum size of a single payload (bytes).
+     */
+    HAPublishQueue(const uint8_t maxMessagesNb, const uint16_t maxPayloadSize);
+
+    /**
+     * Frees the memory allocated by the queue.
+     */
+    ~HAPublishQueue();
+
+    /**
+     * Adds the message to the queue or replaces the payload of the pending message with the same key.
+     *
+     * @param objectId The unique ID of a device type that owns the topic. It can be nullptr.
+     * @param topic The topic name (progmem string).
+     * @param payload The message's payload.
+     * @param length The length of the payload.
+     * @param retained Specifies whether the message should be retained.
+     * @param isProgmemData Specifies whether the payload is stored in the flash memory.
+     * @param qos QoS of the message.
+     * @returns Returns `false` if the payload is too big or the queue is full.
+     */
+    bool push(
+        const char* objectId,
+        const __FlashStringHelper* topic,
+        const uint8_t* payload,
+        const uint16_t length,
+        const bool retained,
+        const bool isProgmemData,
+        const uint8_t qos = 0
+    );
+
+    /**
+     * Returns the oldest pending message or nullptr if the queue is empty.
+     */
+    const Message* front() const;
+
+    /**
+     * Removes the oldest pending message from the queue.
+     */
+    void pop();
+
+    /**
+     * Removes all pending messages from the queue.
+     */
+    void clear();
+
+    /**
+     * Returns the number of pending messages.
+     */
+    inline uint8_t getMessagesNb() const
+        { return _messagesNb; }
+
+    /**
+     * Returns the number of messages that were replaced by a newer value before being published.
+     */
+    inline uint32_t getCoalescedMessagesNb() const
+        { return _coalescedMessagesNb; }
+
+    /**
+     * Returns the total amount of RAM (bytes) allocated by the queue.
+     */
+    uint32_t calculateMemoryUsage() const;
+
+private:
+    /// Slots of the queue.
+    Message* _messages;
+
+    /// The memory where payloads are stored (`maxPayloadSize` bytes per slot).
+    uint8_t* _payloads;
+
+    /// Indexes of the occupied slots in the order of insertion.
+    uint8_t* _order;
+
+    /// The maximum number of pending messages.
+    const uint8_t _maxMessagesNb;
+
+    /// The maximum size of a single payload (bytes).
+    const uint16_t _maxPayloadSize;
+
+    /// The number of pending messages.
+    uint8_t _messagesNb;
+
+    /// The number of messages replaced by a newer value.
+    uint32_t _coalescedMessagesNb;
+};
+
+#endif
+#endif
@@ -13,6 +13,11 @@
 #include "../utils/HANumeric.h"
 #include "../device-types/HABaseDeviceType.h"
 
+uint8_t* HASerializer::_renderBuffer = nullptr;
+uint16_t HASerializer::_renderLength = 0;
+bool HASerializer::_hashing = false;
+uint32_t HASerializer::_hash = 0;
+
 uint16_t HASerializer::calculateConfigTopicLength(
     const __FlashStringHelper* componentName,
     const char* objectId
@@ -73,6 +78,51 @@ bool HASerializer::generateConfigTopic(
     return true;
 }
 
+uint16_t HASerializer::calculateDeviceConfigTopicLength()
+{
+    const HAMqtt* mqtt = HAMqtt::instance();
+    if (
+        !mqtt ||
+        !mqtt->getDiscoveryPrefix() ||
+        !mqtt->getDevice() ||
+        !mqtt->getDevice()->getUniqueId()
+    ) {
+        return 0;
+    }
+
+    return
+        strlen(mqtt->getDiscoveryPrefix()) + 1 + // prefix with slash
+        strlen_P(HAComponentDevice) + 1 + // component name with slash
+        strlen(mqtt->getDevice()->getUniqueId()) + 1 + // device ID with slash
+        strlen_P(HAConfigTopic) + 1; // including null terminator
+}
+
+bool HASerializer::generateDeviceConfigTopic(char* output)
+{
+    const HAMqtt* mqtt = HAMqtt::instance();
+    if (
+        !output ||
+        !mqtt ||
+        !mqtt->getDiscoveryPrefix() ||
+        !mqtt->getDevice() ||
+        !mqtt->getDevice()->getUniqueId()
+    ) {
+        return false;
+    }
+
+    strcpy(output, mqtt->getDiscoveryPrefix());
+    strcat_P(output, HASerializerSlash);
+
+    strcat_P(output, HAComponentDevice);
+    strcat_P(output, HASerializerSlash);
+
+    strcat(output, mqtt->getDevice()->getUniqueId());
+    strcat_P(output, HASerializerSlash);
+
+    strcat_P(output, HAConfigTopic);
+    return true;
+}
+
 uint16_t HASerializer::calculateDataTopicLength(
     const char* objectId,
     const __FlashStringHelper* topic
@@ -140,21 +190,54 @@ bool HASerializer::compareDataTopics(
     const __FlashStringHelper* topic
 )
 {
-    if (!actualTopic) {
+    const HAMqtt* mqtt = HAMqtt::instance();
+    if (
+        !actualTopic ||
+        !topic ||
+        !mqtt ||
+        !mqtt->getDataPrefix() ||
+        !mqtt->getDevice() ||
+        !mqtt->getDevice()->getUniqueId()
+    ) {
         return false;
     }
 
-    const uint16_t topicLength = calculateDataTopicLength(objectId, topic);
-    if (topicLength == 0) {
-        return false;
+    uint16_t cachedTopicLength = 0;
+    const char* cachedTopic = mqtt->getCachedDataTopic(
+        objectId,
+        topic,
+        cachedTopicLength
+    );
+    if (cachedTopic) {
+        return memcmp(actualTopic, cachedTopic, cachedTopicLength + 1) == 0;
     }
 
-    char expectedTopic[topicLength];
-    if (!generateDataTopic(expectedTopic, objectId, topic)) {
-        return false;
+    // the topic is compared part by part, so the expected topic doesn't need to be generated
+    actualTopic = skipTopicPart(actualTopic, mqtt->getDataPrefix());
+    actualTopic = skipTopicPart(actualTopic, mqtt->getDevice()->getUniqueId());
+
+    if (objectId) {
+        actualTopic = skipTopicPart(actualTopic, objectId);
     }
 
-    return memcmp(actualTopic, expectedTopic, topicLength) == 0;
+    return actualTopic && strcmp_P(actualTopic, AHAFROMFSTR(topic)) == 0;
+}
+
+const char* HASerializer::skipTopicPart(const char* actualTopic, const char* part)
+{
+    if (!actualTopic) {
+        return nullptr;
+    }
+
+    const uint16_t length = strlen(part);
+    if (
+        strncmp(actualTopic, part, length) != 0 ||
+        actualTopic[length] != '/'
+    ) {
+        return nullptr;
+    }
+
+    return actualTopic + length + 1; // skip the slash
 }
 
 HASerializer::HASerializer(
@@ -164,7 +247,8 @@ HASerializer::HASerializer(
     _deviceType(deviceType),
     _entriesNb(0),
     _maxEntriesNb(maxEntriesNb),
-    _entries(new SerializerEntry[maxEntriesNb])
+    _entries(new SerializerEntry[maxEntriesNb]),
+    _nested(false)
 {
 
 }
@@ -239,7 +323,24 @@ uint16_t HASerializer::calculateSize() const
         strlen_P(HASerializerJsonDataPrefix) +
         strlen_P(HASerializerJsonDataSuffix);
 
+    if (isNestedComponent()) {
+        size +=
+            calculateComponentSize() +
+            strlen_P(HASerializerJsonPropertiesSeparator);
+    }
+
+    if (hasBaseTopic()) {
+        size +=
+            calculateBaseTopicSize() +
+            strlen_P(HASerializerJsonPropertiesSeparator);
+    }
+
+    uint8_t serializedEntriesNb = 0;
     for (uint8_t i = 0; i < _entriesNb; i++) {
+        if (isEntrySkipped(&_entries[i])) {
+            continue;
+        }
+
         const uint16_t entrySize = calculateEntrySize(&_entries[i]);
         if (entrySize == 0) {
             continue;
@@ -248,7 +349,7 @@ uint16_t HASerializer::calculateSize() const
         size += entrySize;
 
         // items separator
-        if (i > 0) {
+        if (serializedEntriesNb++ > 0) {
             size += strlen_P(HASerializerJsonPropertiesSeparator);
         }
     }
@@ -263,11 +364,26 @@ bool HASerializer::flush() const
         return false;
     }
 
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonDataPrefix));
+    writeOutput(AHATOFSTR(HASerializerJsonDataPrefix));
 
+    if (isNestedComponent()) {
+        flushComponent();
+        writeOutput(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+    }
+
+    if (hasBaseTopic()) {
+        flushBaseTopic();
+        writeOutput(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+    }
+
+    uint8_t serializedEntriesNb = 0;
     for (uint8_t i = 0; i < _entriesNb; i++) {
-        if (i > 0) {
-            mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertiesSeparator));
+        if (isEntrySkipped(&_entries[i])) {
+            continue;
+        }
+
+        if (serializedEntriesNb++ > 0) {
+            writeOutput(AHATOFSTR(HASerializerJsonPropertiesSeparator));
         }
 
         if (!flushEntry(&_entries[i])) {
@@ -275,10 +391,181 @@ bool HASerializer::flush() const
         }
     }
 
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonDataSuffix));
+    writeOutput(AHATOFSTR(HASerializerJsonDataSuffix));
     return true;
 }
 
+uint16_t HASerializer::render(uint8_t* output) const
+{
+    // the render may be nested (e.g. HADevice::getJson fills its cache while the device type is flushed)
+    uint8_t* const outerBuffer = _renderBuffer;
+    const uint16_t outerLength = _renderLength;
+    const bool outerHashing = _hashing;
+
+    _renderBuffer = output;
+    _renderLength = 0;
+    _hashing = false;
+
+    const bool result = flush();
+    const uint16_t length = _renderLength;
+
+    _renderBuffer = outerBuffer;
+    _renderLength = outerLength;
+    _hashing = outerHashing;
+
+    return result ? length : 0;
+}
+
+uint32_t HASerializer::calculateHash() const
+{
+    const bool outerHashing = _hashing;
+    const uint32_t outerHash = _hash;
+
+    _hashing = true;
+    _hash = HAUtils::HashOffsetBasis;
+
+    const bool result = flush();
+    const uint32_t hash = _hash;
+
+    _hashing = outerHashing;
+    _hash = outerHash;
+
+    return result ? hash : 0;
+}
+
+void HASerializer::writeOutput(const char* data, const uint16_t length)
+{
+    if (_hashing) {
+        _hash = HAUtils::hash(data, length, _hash);
+    } else if (_renderBuffer) {
+        memcpy(&_renderBuffer[_renderLength], data, length);
+        _renderLength += length;
+    } else {
+        HAMqtt::instance()->writePayload(data, length);
+    }
+}
+
+void HASerializer::writeOutput(const __FlashStringHelper* data)
+{
+    if (_hashing) {
+        // progmem strings are copied to RAM in small chunks
+        const char* src = AHAFROMFSTR(data);
+        uint16_t length = strlen_P(src);
+        char chunk[16];
+
+        while (length > 0) {
+            const uint16_t chunkLength = length < sizeof(chunk) ? length : sizeof(chunk);
+            memcpy_P(chunk, src, chunkLength);
+            _hash = HAUtils::hash(chunk, chunkLength, _hash);
+
+            src += chunkLength;
+            length -= chunkLength;
+        }
+    } else if (_renderBuffer) {
+        const uint16_t length = strlen_P(AHAFROMFSTR(data));
+        memcpy_P(&_renderBuffer[_renderLength], data, length);
+        _renderLength += length;
+    } else {
+        HAMqtt::instance()->writePayload(data);
+    }
+}
+
+bool HASerializer::isEntrySkipped(const SerializerEntry* entry) const
+{
+    if (!isNestedComponent()) {
+        return false;
+    }
+
+    // the device and the shared availability are published once in the device's payload
+    if (entry->type == FlagEntryType) {
+        return static_cast<FlagType>(entry->subtype) == WithDevice;
+    }
+
+    return
+        entry->type == TopicEntryType &&
+        entry->value != nullptr &&
+        entry->value == HAMqtt::instance()->getDevice()->getAvailabilityTopic();
+}
+
+uint16_t HASerializer::calculateComponentSize() const
+{
+    return
+        // property name
+        strlen_P(HASerializerJsonPropertyPrefix) +
+        strlen_P(HAPlatformProperty) +
+        strlen_P(HASerializerJsonPropertySuffix) +
+        // property value
+        2 * strlen_P(HASerializerJsonEscapeChar) +
+        strlen_P(AHAFROMFSTR(_deviceType->componentName()));
+}
+
+void HASerializer::flushComponent() const
+{
+    // property name
+    writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+    writeOutput(AHATOFSTR(HAPlatformProperty));
+    writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
+
+    // value
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
+    writeOutput(_deviceType->componentName());
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
+}
+
+bool HASerializer::hasBaseTopic() const
+{
+    if (!_deviceType || !HAMqtt::instance()->isTopicAbbreviationEnabled()) {
+        return false;
+    }
+
+    // the base topic is only needed if at least one data topic is going to be abbreviated
+    for (uint8_t i = 0; i < _entriesNb; i++) {
+        if (_entries[i].type == TopicEntryType && !_entries[i].value) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint16_t HASerializer::calculateBaseTopicSize() const
+{
+    const HAMqtt* mqtt = HAMqtt::instance();
+
+    return
+        // property name
+        strlen_P(HASerializerJsonPropertyPrefix) +
+        strlen_P(HASerializerBaseTopicProperty) +
+        strlen_P(HASerializerJsonPropertySuffix) +
+        // property value
+        2 * strlen_P(HASerializerJsonEscapeChar) +
+        strlen(mqtt->getDataPrefix()) + 1 + // prefix with slash
+        strlen(mqtt->getDevice()->getUniqueId()) + 1 + // device ID with slash
+        strlen(_deviceType->uniqueId());
+}
+
+void HASerializer::flushBaseTopic() const
+{
+    const HAMqtt* mqtt = HAMqtt::instance();
+    const char* dataPrefix = mqtt->getDataPrefix();
+    const char* deviceId = mqtt->getDevice()->getUniqueId();
+    const char* objectId = _deviceType->uniqueId();
+
+    // property name
+    writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+    writeOutput(AHATOFSTR(HASerializerBaseTopicProperty));
+    writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
+
+    // value
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
+    writeOutput(dataPrefix, strlen(dataPrefix));
+    writeOutput(AHATOFSTR(HASerializerSlash));
+    writeOutput(deviceId, strlen(deviceId));
+    writeOutput(AHATOFSTR(HASerializerSlash));
+    writeOutput(objectId, strlen(objectId));
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
+}
+
 uint16_t HASerializer::calculateEntrySize(const SerializerEntry* entry) const
 {
     switch (entry->type) {
@@ -327,6 +614,22 @@ uint16_t HASerializer::calculateTopicEntrySize(
             return 0;
         }
 
+        if (HAMqtt::instance()->isTopicAbbreviationEnabled()) {
+            return
+                size +
+                strlen_P(HASerializerBaseTopicPrefix) +
+                strlen_P(AHAFROMFSTR(entry->property));
+        }
+
+        uint16_t cachedTopicLength = 0;
+        if (HAMqtt::instance()->getCachedDataTopic(
+            _deviceType->uniqueId(),
+            entry->property,
+            cachedTopicLength
+        )) {
+            return size + cachedTopicLength;
+        }
+
         size += calculateDataTopicLength(
             _deviceType->uniqueId(),
             entry->property
@@ -342,7 +645,11 @@ uint16_t HASerializer::calculateFlagSize(const FlagType flag) const
     const HADevice* device = mqtt->getDevice();
 
     if (flag == WithDevice && device->getSerializer()) {
-        const uint16_t deviceLength = device->getSerializer()->calculateSize();
+        uint16_t deviceLength = 0;
+        if (!device->getJson(deviceLength)) {
+            deviceLength = device->getSerializer()->calculateSize();
+        }
+
         if (deviceLength == 0) {
             return 0;
         }
@@ -411,13 +718,11 @@ uint16_t HASerializer::calculatePropertyValueSize(
 
 bool HASerializer::flushEntry(const SerializerEntry* entry) const
 {
-    HAMqtt* mqtt = HAMqtt::instance();
-
     switch (entry->type) {
     case PropertyEntryType: {
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
-        mqtt->writePayload(entry->property);
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+        writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+        writeOutput(entry->property);
+        writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
 
         return flushEntryValue(entry);
     }
@@ -435,27 +740,25 @@ bool HASerializer::flushEntry(const SerializerEntry* entry) const
 
 bool HASerializer::flushEntryValue(const SerializerEntry* entry) const
 {
-    HAMqtt* mqtt = HAMqtt::instance();
-
     switch (entry->subtype) {
     case ConstCharPropertyValue:
     case ProgmemPropertyValue: {
         const char* value = static_cast<const char*>(entry->value);
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+        writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
 
         if (entry->subtype == ConstCharPropertyValue) {
-            mqtt->writePayload(value, strlen(value));
+            writeOutput(value, strlen(value));
         } else {
-            mqtt->writePayload(AHATOFSTR(value));
+            writeOutput(AHATOFSTR(value));
         }
 
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+        writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
         return true;
     }
 
     case BoolPropertyType: {
         const bool value = *static_cast<const bool*>(entry->value);
-        mqtt->writePayload(AHATOFSTR(value ? HATrue : HAFalse));
+        writeOutput(AHATOFSTR(value ? HATrue : HAFalse));
         return true;
     }
 
@@ -467,7 +770,7 @@ bool HASerializer::flushEntryValue(const SerializerEntry* entry) const
         char tmp[HANumeric::MaxDigitsNb + 1];
         const uint16_t length = value->toStr(tmp);
 
-        mqtt->writePayload(tmp, length);
+        writeOutput(tmp, length);
         return true;
     }
 
@@ -479,7 +782,7 @@ bool HASerializer::flushEntryValue(const SerializerEntry* entry) const
         char tmp[size + 1]; // including null terminator
         tmp[0] = 0;
         array->serialize(tmp);
-        mqtt->writePayload(tmp, size);
+        writeOutput(tmp, size);
 
         return true;
     }
@@ -494,36 +797,50 @@ bool HASerializer::flushTopic(const SerializerEntry* entry) const
     HAMqtt* mqtt = HAMqtt::instance();
 
     // property name
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
-    mqtt->writePayload(entry->property);
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+    writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+    writeOutput(entry->property);
+    writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
 
     // value (escaped)
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
 
     if (entry->value) {
         const char* topic = static_cast<const char*>(entry->value);
-        mqtt->writePayload(topic, strlen(topic));
+        writeOutput(topic, strlen(topic));
+    } else if (mqtt->isTopicAbbreviationEnabled()) {
+        writeOutput(AHATOFSTR(HASerializerBaseTopicPrefix));
+        writeOutput(entry->property);
     } else {
-        const uint16_t length = calculateDataTopicLength(
+        uint16_t cachedTopicLength = 0;
+        const char* cachedTopic = mqtt->getCachedDataTopic(
             _deviceType->uniqueId(),
-            entry->property
-        );
-        if (length == 0) {
-            return false;
-        }
-
-        char topic[length];
-        generateDataTopic(
-            topic,
-            _deviceType->uniqueId(),
-            entry->property
+            entry->property,
+            cachedTopicLength
         );
 
-        mqtt->writePayload(topic, length - 1);
+        if (cachedTopic) {
+            writeOutput(cachedTopic, cachedTopicLength);
+        } else {
+            const uint16_t length = calculateDataTopicLength(
+                _deviceType->uniqueId(),
+                entry->property
+            );
+            if (length == 0) {
+                return false;
+            }
+
+            char topic[length];
+            generateDataTopic(
+                topic,
+                _deviceType->uniqueId(),
+                entry->property
+            );
+
+            writeOutput(topic, length - 1);
+        }
     }
 
-    mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+    writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
     return true;
 }
 
@@ -535,30 +852,37 @@ bool HASerializer::flushFlag(const SerializerEntry* entry) const
 
     if (flag == WithDevice && device) {
         // property name
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
-        mqtt->writePayload(AHATOFSTR(HADeviceProperty));
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+        writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+        writeOutput(AHATOFSTR(HADeviceProperty));
+        writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
 
         // property value
+        uint16_t jsonLength = 0;
+        const uint8_t* json = device->getJson(jsonLength);
+        if (json) {
+            writeOutput(reinterpret_cast<const char*>(json), jsonLength);
+            return true;
+        }
+
         return device->getSerializer()->flush();
     } else if (flag == WithUniqueId && _deviceType) {
         // property name
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertyPrefix));
-        mqtt->writePayload(AHATOFSTR(HAUniqueIdProperty));
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonPropertySuffix));
+        writeOutput(AHATOFSTR(HASerializerJsonPropertyPrefix));
+        writeOutput(AHATOFSTR(HAUniqueIdProperty));
+        writeOutput(AHATOFSTR(HASerializerJsonPropertySuffix));
 
         // value
         const char* uniqueId = _deviceType->uniqueId();
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+        writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
 
         if (device->isExtendedUniqueIdsEnabled()) {
             const char* deviceUniqueId = device->getUniqueId();
-            mqtt->writePayload(deviceUniqueId, strlen(deviceUniqueId));
-            mqtt->writePayload(AHATOFSTR(HASerializerUnderscore));
+            writeOutput(deviceUniqueId, strlen(deviceUniqueId));
+            writeOutput(AHATOFSTR(HASerializerUnderscore));
         }
 
-        mqtt->writePayload(uniqueId, strlen(uniqueId));
-        mqtt->writePayload(AHATOFSTR(HASerializerJsonEscapeChar));
+        writeOutput(uniqueId, strlen(uniqueId));
+        writeOutput(AHATOFSTR(HASerializerJsonEscapeChar));
 
         return true;
     }
@@ -91,6 +91,20 @@ public:
         const char* objectId
     );
 
+    /**
+     * Calculates the size of the device-based discovery topic.
+     * The topic has structure as follows: `[discovery prefix]/device/[device ID]/config`
+     */
+    static uint16_t calculateDeviceConfigTopicLength();
+
+    /**
+     * Generates the device-based discovery topic.
+     * The topic will be stored in the `output` variable.
+     *
+     * @param output Buffer where the topic will be written.
+     */
+    static bool generateDeviceConfigTopic(char* output);
+
     /**
      * Calculates the size of the given data topic for the given objectId.
      * The data topic has structure as follows: `[data prefix]/[device ID]_[objectId]/[topic]`
@@ -198,7 +212,45 @@ public:
      */
     bool flush() const;
 
+    /**
+     * Renders the JSON object into the given buffer instead of the MQTT stream.
+     * The buffer needs to be at least HASerializer::calculateSize bytes long.
+     * The output is not null terminated.
+     *
+     * @param output The buffer for the JSON object.
+     * @returns The number of written bytes or `0` if the object couldn't be rendered.
+     */
+    uint16_t render(uint8_t* output) const;
+
+    /**
+     * Calculates the FNV-1a hash of the JSON object without producing the output.
+     *
+     * @returns The hash of the serialized bytes or `0` if the object couldn't be serialized.
+     */
+    uint32_t calculateHash() const;
+
+    /**
+     * Enables the nested mode of the serializer.
+     * In this mode the JSON object is serialized as a component of the device-based discovery payload.
+     * The platform (`p`) property is added to the object, while the device and the shared availability
+     * are skipped as they are published once for the whole device.
+     */
+    inline void enableNestedMode()
+        { _nested = true; }
+
 private:
+    /// The buffer that's used as an output of the HASerializer::render method. It's nullptr if the MQTT stream is used.
+    static uint8_t* _renderBuffer;
+
+    /// The number of bytes written to the render buffer.
+    static uint16_t _renderLength;
+
+    /// Specifies whether the output is hashed instead of being written (see HASerializer::calculateHash).
+    static bool _hashing;
+
+    /// The hash of the bytes written so far.
+    static uint32_t _hash;
+
     /// Pointer to the device type that owns the serializer.
     HABaseDeviceType* _deviceType;
 
@@ -211,6 +263,70 @@ private:
     /// Pointer to the serializer entries.
     SerializerEntry* _entries;
 
+    /// Specifies whether the serializer works in the nested mode (see HASerializer::enableNestedMode).
+    bool _nested;
+
+    /**
+     * Checks whether the given topic begins with the given part followed by a slash.
+     *
+     * @param actualTopic The topic to check. It can be nullptr.
+     * @param part The expected part of the topic.
+     * @returns Pointer to the remaining part of the topic or nullptr if the part doesn't match.
+     */
+    static const char* skipTopicPart(const char* actualTopic, const char* part);
+
+    /**
+     * Writes the given string to the current output (the MQTT stream, the render buffer or the hash).
+     *
+     * @param data The string to write.
+     * @param length Length of the string.
+     */
+    static void writeOutput(const char* data, const uint16_t length);
+
+    /**
+     * Writes the given progmem string to the current output (the MQTT stream, the render buffer or the hash).
+     *
+     * @param data The progmem string to write.
+     */
+    static void writeOutput(const __FlashStringHelper* data);
+
+    /**
+     * Returns `true` if the object is serialized as a component of the device-based discovery payload.
+     */
+    inline bool isNestedComponent() const
+        { return _nested && _deviceType; }
+
+    /**
+     * Returns `true` if the given entry shouldn't be serialized in the current mode.
+     */
+    bool isEntrySkipped(const SerializerEntry* entry) const;
+
+    /**
+     * Calculates the size of the platform property (`"p":"[component]"`) of the nested component.
+     */
+    uint16_t calculateComponentSize() const;
+
+    /**
+     * Flushes the platform property of the nested component to the output.
+     */
+    void flushComponent() const;
+
+    /**
+     * Returns `true` if the serializer needs to publish the base topic (`~` property).
+     * It's the case when the abbreviation of topics is enabled and there is at least one data topic in the serializer.
+     */
+    bool hasBaseTopic() const;
+
+    /**
+     * Calculates the size of the base topic property (`"~":"[data prefix]/[device ID]/[object ID]"`).
+     */
+    uint16_t calculateBaseTopicSize() const;
+
+    /**
+     * Flushes the base topic property to the output.
+     */
+    void flushBaseTopic() const;
+
     /**
      * Creates a new entry in the serializer's memory.
      * If the limit of entries is hit, the nullptr is returned.
@@ -0,0 +1,35 @@
+#ifndef AHA_HASTORAGE_H
+#define AHA_HASTORAGE_H
+
+#include <stdint.h>
+
+/**
+ * HAStorage is an interface of the key-value storage that's used by the library
+ * to persist small values between reboots (e.g. hashes of the discovery configurations).
+ * You can implement it on top of EEPROM, Preferences (ESP32), RTC memory or any other storage.
+ */
+class HAStorage
+{
+public:
+    virtual ~HAStorage() { }
+
+    /**
+     * Reads the value stored under the given key.
+     *
+     * @param key The key (null-terminated string).
+     * @param value The stored value (output).
+     * @returns Returns `false` if the key doesn't exist.
+     */
+    virtual bool read(const char* key, uint32_t& value) = 0;
+
+    /**
+     * Stores the value under the given key.
+     *
+     * @param key The key (null-terminated string).
+     * @param value The value to store.
+     * @returns Returns `true` if the value has been stored.
+     */
+    virtual bool write(const char* key, const uint32_t value) = 0;
+};
+
+#endif
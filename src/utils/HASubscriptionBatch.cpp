@@ -0,0 +1,87 @@
+#include <Arduino.h>
+
+#include "HASubscriptionBatch.h"
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+
+HASubscriptionBatch::HASubscriptionBatch(const uint16_t maxPacketSize) :
+    _buffer(new uint8_t[maxPacketSize]),
+    _maxPacketSize(maxPacketSize),
+    _length(0),
+    _topicsNb(0)
+{
+    clear();
+}
+
+HASubscriptionBatch::~HASubscriptionBatch()
+{
+    delete[] _buffer;
+}
+
+bool HASubscriptionBatch::add(const char* topic)
+{
+    if (!topic || _topicsNb == UINT8_MAX) {
+        return false;
+    }
+
+    const uint16_t topicLength = strlen(topic);
+    const uint32_t requiredLength =
+        (uint32_t)MaxHeaderSize + _length +
+        2 + topicLength + 1; // length of the filter, the filter and the requested QoS
+    if (topicLength == 0 || requiredLength > _maxPacketSize) {
+        return false;
+    }
+
+    uint8_t* output = &_buffer[MaxHeaderSize + _length];
+    *output++ = topicLength >> 8;
+    *output++ = topicLength & 0xFF;
+    memcpy(output, topic, topicLength);
+    output[topicLength] = 0; // QoS 0
+
+    _length += 2 + topicLength + 1;
+    _topicsNb++;
+
+    return true;
+}
+
+const uint8_t* HASubscriptionBatch::build(const uint16_t packetId, uint16_t& length)
+{
+    if (_topicsNb == 0 || packetId == 0) {
+        length = 0;
+        return nullptr;
+    }
+
+    _buffer[MaxHeaderSize] = packetId >> 8;
+    _buffer[MaxHeaderSize + 1] = packetId & 0xFF;
+
+    // the remaining length is encoded using the variable length encoding
+    uint8_t remainingLength[MaxHeaderSize - 1];
+    uint8_t remainingLengthSize = 0;
+    uint16_t value = _length;
+
+    do {
+        uint8_t digit = value % 128;
+        value /= 128;
+
+        if (value > 0) {
+            digit |= 0x80;
+        }
+
+        remainingLength[remainingLengthSize++] = digit;
+    } while (value > 0);
+
+    const uint8_t headerOffset = MaxHeaderSize - remainingLengthSize - 1;
+    _buffer[headerOffset] = 0x82; // SUBSCRIBE with the reserved flags
+    memcpy(&_buffer[headerOffset + 1], remainingLength, remainingLengthSize);
+
+    length = MaxHeaderSize - headerOffset + _length;
+    return &_buffer[headerOffset];
+}
+
+void HASubscriptionBatch::clear()
+{
+    // the packet identifier is written in HASubscriptionBatch::build
+    _length = 2;
+    _topicsNb = 0;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef AHA_HASUBSCRIPTIONBATCH_H
+#define AHA_HASUBSCRIPTIONBATCH_H
+
+#include <stdint.h>
+#include "../ArduinoHADefines.h"
+
+#ifdef ARDUINOHA_SUBSCRIPTION_BATCH
+
+/**
+ * HASubscriptionBatch collects topic filters and packs them into a single MQTT SUBSCRIBE packet.
+ * PubSubClient sends one topic filter per packet, while the MQTT protocol allows many filters in one packet.
+ * All filters are subscribed with QoS 0. The memory is allocated in the constructor.
+ * The batch is owned by the HAMqtt class and it's disabled by default.
+ */
+class HASubscriptionBatch
+{
+public:
+    /**
+     * Allocates the buffer of the packet.
+     *
+     * @param maxPacketSize The maximum size of the SUBSCRIBE packet (bytes), including the fixed header.
+     */
+    HASubscriptionBatch(const uint16_t maxPacketSize);
+
+    /**
+     * Frees the memory allocated by the batch.
+     */
+    ~HASubscriptionBatch();
+
+    /**
+     * Adds the topic filter to the packet.
+     *
+     * @param topic The topic filter.
+     * @returns Returns `false` if there is no space left in the packet for the given filter.
+     */
+    bool add(const char* topic);
+
+    /**
+     * Finalizes the packet. The packet remains valid until HASubscriptionBatch::clear is called.
+     *
+     * @param packetId The identifier of the packet. It can't be `0`.
+     * @param length Length of the finalized packet (bytes).
+     * @returns Pointer to the packet or nullptr if there are no filters in the batch.
+     */
+    const uint8_t* build(const uint16_t packetId, uint16_t& length);
+
+    /**
+     * Removes all filters from the batch.
+     */
+    void clear();
+
+    /**
+     * Returns the number of filters in the batch.
+     */
+    inline uint8_t getTopicsNb() const
+        { return _topicsNb; }
+
+    /**
+     * Returns the maximum size of the SUBSCRIBE packet (bytes).
+     */
+    inline uint16_t getMaxPacketSize() const
+        { return _maxPacketSize; }
+
+private:
+    /// The space reserved for the fixed header: the packet type and up to 4 bytes of the remaining length.
+    static const uint8_t MaxHeaderSize = 5;
+
+    /// The buffer of the packet. The fixed header is written right before the variable header.
+    uint8_t* _buffer;
+
+    /// The maximum size of the packet (bytes).
+    const uint16_t _maxPacketSize;
+
+    /// Length of the variable header (packet identifier) and the payload (filters).
+    uint16_t _length;
+
+    /// The number of filters in the batch.
+    uint8_t _topicsNb;
+};
+
+#endif
+#endif
@@ -0,0 +1,113 @@
+#include <Arduino.h>
+
+#include "HATimerWheel.h"
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+
+HATimerWheel::HATimerWheel(
+    const uint16_t resolution,
+    const uint8_t slotsNb,
+    const uint32_t now
+) :
+    _resolution(resolution > 0 ? resolution : 1),
+    _slotsNb(slotsNb > 0 ? slotsNb : 1),
+    _slots(new Timer*[_slotsNb]()),
+    _cursor(0),
+    _tickStartedAt(now),
+    _timersNb(0)
+{
+
+}
+
+HATimerWheel::~HATimerWheel()
+{
+    delete[] _slots;
+}
+
+void HATimerWheel::schedule(Timer* timer, const uint32_t deadline)
+{
+    if (!timer) {
+        return;
+    }
+
+    cancel(timer);
+
+    // offsets are relative to the current tick, so the wheel is not affected by the overflow of millis()
+    const int32_t delta = static_cast<int32_t>(deadline - _tickStartedAt);
+    const uint32_t offset = (delta > 0 ? static_cast<uint32_t>(delta) / _resolution : 0);
+    const uint8_t slot = (_cursor + (offset % _slotsNb)) % _slotsNb;
+
+    timer->deadline = deadline;
+    timer->slot = slot;
+    timer->scheduled = true;
+    timer->prev = nullptr;
+    timer->next = _slots[slot];
+
+    if (_slots[slot]) {
+        _slots[slot]->prev = timer;
+    }
+
+    _slots[slot] = timer;
+    _timersNb++;
+}
+
+void HATimerWheel::cancel(Timer* timer)
+{
+    if (!timer || !timer->scheduled) {
+        return;
+    }
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        _slots[timer->slot] = timer->next;
+    }
+
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->prev = nullptr;
+    timer->next = nullptr;
+    timer->scheduled = false;
+    _timersNb--;
+}
+
+HATimerWheel::Timer* HATimerWheel::poll(const uint32_t now)
+{
+    while (true) {
+        // timers of later revolutions share the slot, so the deadline needs to be verified
+        for (Timer* timer = _slots[_cursor]; timer; timer = timer->next) {
+            if (static_cast<int32_t>(now - timer->deadline) >= 0) {
+                cancel(timer);
+                return timer;
+            }
+        }
+
+        if (static_cast<int32_t>(now - _tickStartedAt) < 0) {
+            return nullptr;
+        }
+
+        const uint32_t elapsedTicks = (now - _tickStartedAt) / _resolution;
+        if (elapsedTicks == 0) {
+            return nullptr;
+        }
+
+        if (_timersNb == 0) {
+            _tickStartedAt += elapsedTicks * _resolution;
+            _cursor = (_cursor + (elapsedTicks % _slotsNb)) % _slotsNb;
+            return nullptr;
+        }
+
+        // after a long pause it's enough to visit each slot once
+        if (elapsedTicks > _slotsNb) {
+            const uint32_t skippedTicks = elapsedTicks - _slotsNb;
+            _tickStartedAt += skippedTicks * _resolution;
+            _cursor = (_cursor + (skippedTicks % _slotsNb)) % _slotsNb;
+        }
+
+        _tickStartedAt += _resolution;
+        _cursor = (_cursor + 1) % _slotsNb;
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef AHA_HATIMERWHEEL_H
+#define AHA_HATIMERWHEEL_H
+
+#include <stdint.h>
+#include "../ArduinoHADefines.h"
+
+#ifdef ARDUINOHA_PUBLISH_SCHEDULER
+
+/**
+ * HATimerWheel keeps timers in a fixed number of slots, each covering one tick (resolution) of time.
+ * A timer is linked into the slot of its deadline, so scheduling and cancelling take constant time
+ * and each tick only visits timers of a single slot, regardless of the total number of timers.
+ * Timers whose deadlines are more than one revolution away stay in their slot until the wheel gets back to it.
+ * Timers are intrusive (the memory is owned by the caller), so the wheel only allocates its slots.
+ */
+class HATimerWheel
+{
+public:
+    /// Representation of a single timer. Objects that need to be scheduled should inherit it.
+    struct Timer {
+        Timer() :
+            deadline(0),
+            prev(nullptr),
+            next(nullptr),
+            slot(0),
+            scheduled(false)
+        {
+
+        }
+
+        /// Time when the timer expires (milliseconds since boot).
+        uint32_t deadline;
+
+        /// The previous timer in the same slot.
+        Timer* prev;
+
+        /// The next timer in the same slot.
+        Timer* next;
+
+        /// Index of the slot that holds the timer.
+        uint8_t slot;
+
+        /// Specifies whether the timer is linked into the wheel.
+        bool scheduled;
+    };
+
+    /**
+     * Allocates slots of the wheel.
+     *
+     * @param resolution Time covered by a single slot (milliseconds).
+     * @param slotsNb The number of slots.
+     * @param now The current time (milliseconds since boot).
+     */
+    HATimerWheel(const uint16_t resolution, const uint8_t slotsNb, const uint32_t now);
+
+    /**
+     * Frees the memory allocated by the wheel. Scheduled timers are not modified.
+     */
+    ~HATimerWheel();
+
+    /**
+     * Schedules the given timer. If the timer is already scheduled, it's moved to the new deadline.
+     * Deadlines in the past expire on the next call of HATimerWheel::poll.
+     *
+     * @param timer The timer to schedule.
+     * @param deadline Time when the timer expires (milliseconds since boot).
+     */
+    void schedule(Timer* timer, const uint32_t deadline);
+
+    /**
+     * Removes the given timer from the wheel. Nothing happens if the timer is not scheduled.
+     *
+     * @param timer The timer to remove.
+     */
+    void cancel(Timer* timer);
+
+    /**
+     * Advances the wheel up to the given time and returns the first expired timer.
+     * The returned timer is removed from the wheel, so it can be scheduled again right away.
+     * The method should be called until it returns nullptr.
+     *
+     * @param now The current time (milliseconds since boot).
+     */
+    Timer* poll(const uint32_t now);
+
+    /**
+     * Returns the number of scheduled timers.
+     */
+    inline uint16_t getTimersNb() const
+        { return _timersNb; }
+
+    /**
+     * Returns time covered by a single slot (milliseconds).
+     */
+    inline uint16_t getResolution() const
+        { return _resolution; }
+
+    /**
+     * Returns the number of slots.
+     */
+    inline uint8_t getSlotsNb() const
+        { return _slotsNb; }
+
+private:
+    /// Time covered by a single slot (milliseconds).
+    uint16_t _resolution;
+
+    /// The number of slots.
+    uint8_t _slotsNb;
+
+    /// Heads of the timers' lists (one per slot).
+    Timer** _slots;
+
+    /// Index of the slot that covers the current tick.
+    uint8_t _cursor;
+
+    /// Time when the current tick started (milliseconds since boot).
+    uint32_t _tickStartedAt;
+
+    /// The number of scheduled timers.
+    uint16_t _timersNb;
+};
+
+#endif
+#endif
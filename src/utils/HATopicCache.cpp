@@ -0,0 +1,124 @@
+#include <Arduino.h>
+
+#include "HATopicCache.h"
+#ifdef ARDUINOHA_TOPIC_CACHE
+
+#include "HASerializer.h"
+#include "HAUtils.h"
+
+HATopicCache::HATopicCache(const uint16_t arenaSize, const uint8_t maxTopicsNb) :
+    _arena(new char[arenaSize]),
+    _arenaSize(arenaSize),
+    _arenaUsage(0),
+    _topics(new CachedTopic[maxTopicsNb]),
+    _maxTopicsNb(maxTopicsNb),
+    _topicsNb(0),
+    _slotsNb(2),
+    _slots(nullptr)
+{
+    // the lookup table is kept at most half full
+    while (_slotsNb < maxTopicsNb * 2) {
+        _slotsNb <<= 1;
+    }
+
+    _slots = new uint8_t[_slotsNb]();
+}
+
+HATopicCache::~HATopicCache()
+{
+    delete[] _arena;
+    delete[] _topics;
+    delete[] _slots;
+}
+
+const char* HATopicCache::get(
+    const char* objectId,
+    const __FlashStringHelper* topic,
+    uint16_t& length
+)
+{
+    if (!topic) {
+        return nullptr;
+    }
+
+    const uint16_t mask = _slotsNb - 1;
+    uint16_t slot = calculateSlot(objectId, topic);
+
+    while (_slots[slot] != 0) {
+        const CachedTopic& cachedTopic = _topics[_slots[slot] - 1];
+        if (cachedTopic.objectId == objectId && cachedTopic.topic == topic) {
+            length = cachedTopic.length;
+            return &_arena[cachedTopic.offset];
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    const int16_t index = store(objectId, topic);
+    if (index < 0) {
+        return nullptr;
+    }
+
+    _slots[slot] = index + 1;
+    length = _topics[index].length;
+
+    return &_arena[_topics[index].offset];
+}
+
+void HATopicCache::clear()
+{
+    _arenaUsage = 0;
+    _topicsNb = 0;
+    memset(_slots, 0, _slotsNb);
+}
+
+uint16_t HATopicCache::calculateMemoryUsage() const
+{
+    return
+        sizeof(HATopicCache) +
+        _arenaSize +
+        _maxTopicsNb * sizeof(CachedTopic) +
+        _slotsNb;
+}
+
+uint16_t HATopicCache::calculateSlot(
+    const char* objectId,
+    const __FlashStringHelper* topic
+) const
+{
+    uint32_t hash = HAUtils::hash(&objectId, sizeof(objectId));
+    hash = HAUtils::hash(&topic, sizeof(topic), hash);
+
+    return hash & (_slotsNb - 1);
+}
+
+int16_t HATopicCache::store(
+    const char* objectId,
+    const __FlashStringHelper* topic
+)
+{
+    if (_topicsNb >= _maxTopicsNb) {
+        return -1;
+    }
+
+    const uint16_t size = HASerializer::calculateDataTopicLength(objectId, topic);
+    if (size == 0 || _arenaUsage + size > _arenaSize) {
+        return -1;
+    }
+
+    char* output = &_arena[_arenaUsage];
+    if (!HASerializer::generateDataTopic(output, objectId, topic)) {
+        return -1;
+    }
+
+    CachedTopic& cachedTopic = _topics[_topicsNb];
+    cachedTopic.objectId = objectId;
+    cachedTopic.topic = topic;
+    cachedTopic.offset = _arenaUsage;
+    cachedTopic.length = size - 1; // exclude null terminator
+
+    _arenaUsage += size;
+    return _topicsNb++;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef AHA_HATOPICCACHE_H
+#define AHA_HATOPICCACHE_H
+
+#include <stdint.h>
+#include "../ArduinoHADefines.h"
+
+#ifdef ARDUINOHA_TOPIC_CACHE
+
+/**
+ * HATopicCache stores fully resolved data topics (`[data prefix]/[device ID]/[object ID]/[topic]`)
+ * in a single memory arena, so they don't need to be generated on each publish or comparison.
+ * Topics are resolved on the first use and stay in the arena until the cache is cleared.
+ * The cache is owned by the HAMqtt class and it's disabled by default.
+ */
+class HATopicCache
+{
+public:
+    /**
+     * Allocates the arena and the lookup table of the cache.
+     *
+     * @param arenaSize Size of the arena (bytes) where topics are stored (including null terminators).
+     * @param maxTopicsNb The maximum number of topics that can be stored in the cache.
+     */
+    HATopicCache(const uint16_t arenaSize, const uint8_t maxTopicsNb);
+
+    /**
+     * Frees the memory allocated by the cache.
+     */
+    ~HATopicCache();
+
+    /**
+     * Returns the data topic for the given object ID and topic name.
+     * If the topic is not present in the cache yet, it's generated and stored in the arena.
+     *
+     * @param objectId The unique ID of a device type that owns the topic. It can be nullptr.
+     * @param topic The topic name (progmem string).
+     * @param length Length of the returned topic (excluding the null terminator).
+     * @returns Pointer to the cached topic or nullptr if the topic cannot be stored in the cache.
+     */
+    const char* get(
+        const char* objectId,
+        const __FlashStringHelper* topic,
+        uint16_t& length
+    );
+
+    /**
+     * Removes all topics from the cache.
+     * It needs to be called each time the data prefix changes.
+     */
+    void clear();
+
+    /**
+     * Returns the number of topics stored in the cache.
+     */
+    inline uint8_t getTopicsNb() const
+        { return _topicsNb; }
+
+    /**
+     * Returns the number of bytes of the arena that are used by the stored topics.
+     */
+    inline uint16_t getArenaUsage() const
+        { return _arenaUsage; }
+
+    /**
+     * Returns the total amount of RAM (bytes) allocated by the cache.
+     * It includes the arena, the topics table and the lookup table.
+     */
+    uint16_t calculateMemoryUsage() const;
+
+private:
+    /// Representation of a single cached topic.
+    struct CachedTopic {
+        /// The object ID that was used to generate the topic (pointer is used as a key).
+        const char* objectId;
+
+        /// The topic name that was used to generate the topic (pointer is used as a key).
+        const __FlashStringHelper* topic;
+
+        /// Offset of the topic in the arena.
+        uint16_t offset;
+
+        /// Length of the topic (excluding the null terminator).
+        uint16_t length;
+    };
+
+    /**
+     * Returns slot of the lookup table for the given key.
+     */
+    uint16_t calculateSlot(
+        const char* objectId,
+        const __FlashStringHelper* topic
+    ) const;
+
+    /**
+     * Generates the topic and stores it in the arena.
+     *
+     * @returns Index of the stored topic or -1 if there is not enough space in the cache.
+     */
+    int16_t store(const char* objectId, const __FlashStringHelper* topic);
+
+    /// The memory where topics are stored.
+    char* _arena;
+
+    /// Size of the arena (bytes).
+    const uint16_t _arenaSize;
+
+    /// The number of bytes used in the arena.
+    uint16_t _arenaUsage;
+
+    /// Cached topics.
+    CachedTopic* _topics;
+
+    /// The maximum number of topics that can be stored.
+    const uint8_t _maxTopicsNb;
+
+    /// The number of stored topics.
+    uint8_t _topicsNb;
+
+    /// The number of slots in the lookup table (power of two).
+    uint16_t _slotsNb;
+
+    /// Open addressing lookup table. Each slot holds the index of the topic + 1 (0 means an empty slot).
+    uint8_t* _slots;
+};
+
+#endif
+#endif
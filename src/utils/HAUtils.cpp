@@ -46,3 +46,18 @@ char* HAUtils::byteArrayToStr(
 
     return dst;
 }
+
+uint32_t HAUtils::hash(
+    const void* data,
+    const uint16_t length,
+    uint32_t hash
+)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (uint16_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619UL; // FNV prime
+    }
+
+    return hash;
+}
@@ -47,6 +47,24 @@ public:
         const byte* src,
         const uint16_t length
     );
+
+    /**
+     * Calculates the FNV-1a hash of the given data.
+     * The hash can be calculated incrementally by passing the result of the previous call as the `hash` argument.
+     *
+     * @param data Data to hash.
+     * @param length Length of the data (bytes).
+     * @param hash The initial value of the hash.
+     * @returns The FNV-1a hash of the data.
+     */
+    static uint32_t hash(
+        const void* data,
+        const uint16_t length,
+        uint32_t hash = HashOffsetBasis
+    );
+
+    /// The initial value of the FNV-1a hash.
+    static const uint32_t HashOffsetBasis = 2166136261UL;
 };
 
 #endif
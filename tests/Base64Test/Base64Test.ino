@@ -0,0 +1,110 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define assertEncoded(input, expected) \
+{ \
+    char output[16] = {0}; \
+    const uint32_t length = HABase64::encode( \
+        output, \
+        reinterpret_cast<const uint8_t*>(input), \
+        strlen(input) \
+    ); \
+    assertEqual((uint32_t)strlen(expected), length); \
+    assertEqual(expected, output); \
+}
+
+using aunit::TestRunner;
+
+static const char* Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+AHA_TEST(Base64Test, encoded_length) {
+    assertEqual((uint32_t)0, HABase64::calculateEncodedLength(0));
+    assertEqual((uint32_t)4, HABase64::calculateEncodedLength(1));
+    assertEqual((uint32_t)4, HABase64::calculateEncodedLength(2));
+    assertEqual((uint32_t)4, HABase64::calculateEncodedLength(3));
+    assertEqual((uint32_t)8, HABase64::calculateEncodedLength(4));
+    assertEqual((uint32_t)133336, HABase64::calculateEncodedLength(100000));
+}
+
+AHA_TEST(Base64Test, rfc4648_vectors) {
+    assertEncoded("", "")
+    assertEncoded("f", "Zg==")
+    assertEncoded("fo", "Zm8=")
+    assertEncoded("foo", "Zm9v")
+    assertEncoded("foob", "Zm9vYg==")
+    assertEncoded("fooba", "Zm9vYmE=")
+    assertEncoded("foobar", "Zm9vYmFy")
+}
+
+AHA_TEST(Base64Test, all_sextets) {
+    // each group encodes four consecutive sextets: 4n, 4n+1, 4n+2, 4n+3
+    for (uint8_t i = 0; i < 64; i += 4) {
+        const uint32_t group = ((uint32_t)i << 18) | ((uint32_t)(i + 1) << 12) | ((i + 2) << 6) | (i + 3);
+        const uint8_t data[] = {
+            (uint8_t)(group >> 16),
+            (uint8_t)(group >> 8),
+            (uint8_t)group
+        };
+        char output[4];
+
+        HABase64::encodeGroups(output, data, 1);
+        assertEqual(0, memcmp(&Alphabet[i], output, 4));
+    }
+}
+
+AHA_TEST(Base64Test, all_byte_values) {
+    uint8_t data[256];
+    char output[344];
+    char expected[344];
+
+    for (uint16_t i = 0; i < 256; i++) {
+        data[i] = i;
+    }
+
+    // reference per-byte encoder
+    uint16_t position = 0;
+    for (uint16_t i = 0; i < 256; i += 3) {
+        const uint16_t remaining = 256 - i;
+        const uint32_t group =
+            ((uint32_t)data[i] << 16) |
+            (remaining > 1 ? ((uint32_t)data[i + 1] << 8) : 0) |
+            (remaining > 2 ? data[i + 2] : 0);
+
+        expected[position++] = Alphabet[(group >> 18) & 0x3F];
+        expected[position++] = Alphabet[(group >> 12) & 0x3F];
+        expected[position++] = remaining > 1 ? Alphabet[(group >> 6) & 0x3F] : '=';
+        expected[position++] = remaining > 2 ? Alphabet[group & 0x3F] : '=';
+    }
+
+    assertEqual((uint32_t)344, HABase64::encode(output, data, sizeof(data)));
+    assertEqual(0, memcmp(expected, output, sizeof(output)));
+}
+
+AHA_TEST(Base64Test, tail_with_single_byte) {
+    const uint8_t data[] = {0xFF};
+    char output[4];
+
+    HABase64::encodeTail(output, data, 1);
+    assertEqual(0, memcmp("/w==", output, 4));
+}
+
+AHA_TEST(Base64Test, tail_with_two_bytes) {
+    const uint8_t data[] = {0xFF, 0xFE};
+    char output[4];
+
+    HABase64::encodeTail(output, data, 2);
+    assertEqual(0, memcmp("//4=", output, 4));
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
@@ -176,6 +176,297 @@ AHA_TEST(CameraTest, publish_image) {
     assertTrue(result);
 }
 
+AHA_TEST(CameraTest, publish_image_bigger_than_64kb) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    const uint32_t length = 70000;
+    uint8_t* data = new uint8_t[length];
+    memset(data, 'x', length);
+
+    bool result = camera.publishImage(data, length);
+    delete[] data;
+
+    assertTrue(result);
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual(AHATOFSTR(DataTopic), mock->getFlushedMessages()[0]->topic);
+    assertEqual((size_t)length, strlen(mock->getFlushedMessages()[0]->buffer));
+    assertEqual((uint32_t)1, mock->getWritesNb()); // the image isn't copied or split
+}
+
+AHA_TEST(CameraTest, streamed_image) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    assertTrue(camera.beginImage(10));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"IMAGE", 5));
+    assertTrue(camera.writeImageChunk((const uint8_t*)" DATA", 5));
+    assertTrue(camera.endImage());
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "IMAGE DATA", true)
+}
+
+AHA_TEST(CameraTest, streamed_image_chunk_exceeds_length) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    assertTrue(camera.beginImage(4));
+    assertFalse(camera.writeImageChunk((const uint8_t*)"IMAGE", 5));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"IMAG", 4));
+    assertTrue(camera.endImage());
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "IMAG", true)
+}
+
+AHA_TEST(CameraTest, streamed_image_incomplete) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    assertTrue(camera.beginImage(40));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"IMG", 3));
+    assertFalse(camera.endImage());
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual((size_t)41, mock->getFlushedMessages()[0]->bufferSize);
+    assertEqual((uint32_t)3, mock->getWritesNb()); // the data + two chunks of padding
+}
+
+AHA_TEST(CameraTest, streamed_image_not_started) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    assertFalse(camera.writeImageChunk((const uint8_t*)"IMG", 3));
+    assertFalse(camera.endImage());
+    assertEqual(0, mock->getFlushedMessagesNb());
+}
+
+AHA_TEST(CameraTest, publish_base64_image) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.setEncoding(HACamera::EncodingBase64);
+
+    const char* data = "foobar!";
+    bool result = camera.publishImage((const uint8_t*)data, strlen(data));
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "Zm9vYmFyIQ==", true)
+    assertTrue(result);
+}
+
+AHA_TEST(CameraTest, streamed_base64_image_split_groups) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.setEncoding(HACamera::EncodingBase64);
+
+    assertTrue(camera.beginImage(7));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"f", 1));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"oob", 3));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"ar!", 3));
+    assertTrue(camera.endImage());
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "Zm9vYmFyIQ==", true)
+    assertEqual((size_t)13, mock->getFlushedMessages()[0]->bufferSize);
+}
+
+AHA_TEST(CameraTest, streamed_base64_image_in_blocks) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.setEncoding(HACamera::EncodingBase64);
+
+    uint8_t data[300];
+    memset(data, 0, sizeof(data));
+
+    assertTrue(camera.beginImage(sizeof(data)));
+    assertTrue(camera.writeImageChunk(data, sizeof(data)));
+    assertTrue(camera.endImage());
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual((size_t)400, strlen(mock->getFlushedMessages()[0]->buffer));
+    assertEqual((uint32_t)4, mock->getWritesNb()); // 128 + 128 + 128 + 16 characters
+}
+
+AHA_TEST(CameraTest, streamed_base64_image_incomplete) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.setEncoding(HACamera::EncodingBase64);
+
+    assertTrue(camera.beginImage(6));
+    assertTrue(camera.writeImageChunk((const uint8_t*)"foo", 3));
+    assertFalse(camera.endImage());
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "Zm9vAAAA", true)
+}
+
+AHA_TEST(CameraTest, change_detection_disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+
+    const char* data = "IMAGE CONTENT";
+    assertFalse(camera.isChangeDetectionEnabled());
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)2, camera.getSentFramesNb());
+    assertEqual((uint32_t)0, camera.getSuppressedFramesNb());
+}
+
+AHA_TEST(CameraTest, unchanged_frame_suppressed) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection();
+
+    const char* data = "IMAGE CONTENT";
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "IMAGE CONTENT", true)
+    assertEqual((uint32_t)1, camera.getSentFramesNb());
+    assertEqual((uint32_t)1, camera.getSuppressedFramesNb());
+}
+
+AHA_TEST(CameraTest, changed_frame_published) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection();
+
+    assertTrue(camera.publishImage((const uint8_t*)"IMAGE A", 7));
+    assertTrue(camera.publishImage((const uint8_t*)"IMAGE B", 7));
+    assertTrue(camera.publishImage((const uint8_t*)"IMAGE BB", 8));
+
+    assertEqual(3, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)3, camera.getSentFramesNb());
+    assertEqual((uint32_t)0, camera.getSuppressedFramesNb());
+}
+
+AHA_TEST(CameraTest, changed_sampled_block_published) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection(4, 60000, 0, 1);
+
+    char data[201];
+    memset(data, 'a', sizeof(data) - 1);
+    data[200] = 0;
+
+    assertTrue(camera.publishImage((const uint8_t*)data, 200));
+
+    data[100] = 'b'; // outside of the sampled blocks
+    assertTrue(camera.publishImage((const uint8_t*)data, 200));
+    assertEqual((uint32_t)1, camera.getSuppressedFramesNb());
+
+    data[199] = 'b'; // the last block
+    assertTrue(camera.publishImage((const uint8_t*)data, 200));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)2, camera.getSentFramesNb());
+}
+
+AHA_TEST(CameraTest, frame_with_slightly_different_length_suppressed) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection(8); // 2% length tolerance
+
+    static uint8_t data[1100];
+    for (uint16_t i = 0; i < sizeof(data); i++) {
+        data[i] = i % 251;
+    }
+
+    assertTrue(camera.publishImage(data, 1000));
+    assertTrue(camera.publishImage(data, 1010));
+    assertTrue(camera.publishImage(data, 990));
+    assertEqual((uint32_t)2, camera.getSuppressedFramesNb());
+
+    assertTrue(camera.publishImage(data, 1100)); // 10% longer
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)2, camera.getSentFramesNb());
+}
+
+AHA_TEST(CameraTest, frame_published_after_changed_blocks_threshold) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection(8, 60000, 2, 2);
+
+    static uint8_t data[1000];
+    memset(data, 'a', sizeof(data));
+
+    assertTrue(camera.publishImage(data, sizeof(data)));
+
+    data[0] = 'b'; // the first block
+    assertTrue(camera.publishImage(data, sizeof(data)));
+    assertEqual((uint32_t)1, camera.getSuppressedFramesNb());
+
+    data[999] = 'b'; // the last block
+    assertTrue(camera.publishImage(data, sizeof(data)));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)2, camera.getSentFramesNb());
+}
+
+AHA_TEST(CameraTest, unchanged_frame_published_after_keyframe_interval) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection(64, 1000);
+
+    const char* data = "IMAGE CONTENT";
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+    delay(500);
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+    delay(500);
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint32_t)2, camera.getSentFramesNb());
+    assertEqual((uint32_t)1, camera.getSuppressedFramesNb());
+}
+
+AHA_TEST(CameraTest, failed_frame_not_fingerprinted) {
+    initMqttTest(testDeviceId)
+
+    HACamera camera(testUniqueId);
+    camera.enableChangeDetection();
+
+    const char* data = "IMAGE CONTENT";
+    assertFalse(camera.publishImage((const uint8_t*)data, strlen(data)));
+
+    mock->connectDummy();
+    assertTrue(camera.publishImage((const uint8_t*)data, strlen(data)));
+
+    assertSingleMqttMessage(AHATOFSTR(DataTopic), "IMAGE CONTENT", true)
+    assertEqual((uint32_t)1, camera.getSentFramesNb());
+}
+
 void setup()
 {
     delay(1000);
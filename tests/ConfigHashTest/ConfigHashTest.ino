@@ -0,0 +1,156 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define prepareTest \
+    FileStorageMock storage(testStoragePath); \
+    storage.clear(); \
+    StorageTeardown storageTeardown(storage);
+
+#define bootDevice \
+    initMqttTest(testDeviceId) \
+    mqtt.setConfigStorage(&storage); \
+    HASwitch testSwitch(testUniqueId);
+
+using aunit::TestRunner;
+
+static const char* testDeviceId = "testDevice";
+static const char* testUniqueId = "uniqueSwitch";
+static const char* testStoragePath = "/tmp/ConfigHashTest.storage";
+
+// removes the file of the storage when the test ends (including failed assertions)
+class StorageTeardown
+{
+public:
+    explicit StorageTeardown(FileStorageMock& storage) :
+        _storage(storage)
+    {
+
+    }
+
+    ~StorageTeardown()
+    {
+        _storage.clear();
+    }
+
+private:
+    FileStorageMock& _storage;
+};
+
+const char ConfigTopic[] PROGMEM = {"homeassistant/switch/testDevice/uniqueSwitch/config"};
+const char StateTopic[] PROGMEM = {"testData/testDevice/uniqueSwitch/stat_t"};
+
+AHA_TEST(ConfigHashTest, storage_not_set_by_default) {
+    initMqttTest(testDeviceId)
+
+    assertTrue(mqtt.getConfigStorage() == nullptr);
+}
+
+AHA_TEST(ConfigHashTest, file_storage) {
+    prepareTest
+
+    uint32_t value = 0;
+    assertFalse(storage.read("key", value));
+    assertTrue(storage.write("key", 0xdeadbeef));
+    assertTrue(storage.write("other", 1));
+    assertTrue(storage.write("key", 0xcafe));
+
+    FileStorageMock reopenedStorage(testStoragePath);
+    assertTrue(reopenedStorage.read("key", value));
+    assertEqual((uint32_t)0xcafe, value);
+    assertTrue(reopenedStorage.read("other", value));
+    assertEqual((uint32_t)1, value);
+}
+
+AHA_TEST(ConfigHashTest, serializer_hash) {
+    initMqttTest(testDeviceId)
+
+    HASwitch testSwitch(testUniqueId);
+    testSwitch.buildSerializerTest();
+    HASerializer* serializer = testSwitch.getSerializer();
+
+    uint8_t output[serializer->calculateSize()];
+    const uint16_t length = serializer->render(output);
+
+    assertEqual(HAUtils::hash(output, length), serializer->calculateHash());
+}
+
+AHA_TEST(ConfigHashTest, config_published_and_stored) {
+    prepareTest
+    bootDevice
+
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state
+    assertEqual(AHATOFSTR(ConfigTopic), mock->getFlushedMessages()[0]->topic);
+    assertEqual((uint16_t)1, storage.getWritesNb());
+    assertEqual((uint16_t)0, mqtt.getSkippedConfigsNb());
+
+    uint32_t hash = 0;
+    assertTrue(storage.read(testUniqueId, hash));
+}
+
+AHA_TEST(ConfigHashTest, unchanged_config_skipped_after_reboot) {
+    prepareTest
+
+    {
+        bootDevice
+        mqtt.loop();
+    }
+
+    bootDevice
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "OFF", true)
+    assertEqual((uint16_t)1, mqtt.getSkippedConfigsNb());
+    assertEqual((uint16_t)1, storage.getWritesNb());
+}
+
+AHA_TEST(ConfigHashTest, changed_config_published_after_reboot) {
+    prepareTest
+
+    {
+        bootDevice
+        mqtt.loop();
+    }
+
+    bootDevice
+    testSwitch.setName("New name");
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual(AHATOFSTR(ConfigTopic), mock->getFlushedMessages()[0]->topic);
+    assertEqual((uint16_t)0, mqtt.getSkippedConfigsNb());
+    assertEqual((uint16_t)2, storage.getWritesNb());
+}
+
+AHA_TEST(ConfigHashTest, config_published_on_birth_message) {
+    prepareTest
+
+    {
+        bootDevice
+        mqtt.loop();
+    }
+
+    bootDevice
+    mqtt.enableDiscoveryOnBirthMessage();
+    mqtt.loop();
+    mock->clearFlushedMessages();
+    mock->fakeMessage(F("homeassistant/status"), F("online"));
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual(AHATOFSTR(ConfigTopic), mock->getFlushedMessages()[0]->topic);
+    assertTrue(mqtt.getConfigStorage() == &storage);
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
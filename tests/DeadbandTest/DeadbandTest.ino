@@ -0,0 +1,115 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define assertPublished(deadband, value) \
+    assertTrue(deadband.shouldPublish(value)); \
+    deadband.markPublished(value);
+
+#define assertSuppressed(deadband, value) \
+    assertFalse(deadband.shouldPublish(value));
+
+using aunit::TestRunner;
+
+AHA_TEST(DeadbandTest, thresholds_conversion) {
+    HADeadband deadband(0.5f, 1.5f, 0.25f, 2);
+
+    assertEqual((uint32_t)50, deadband.getAbsolute());
+    assertEqual((uint16_t)150, deadband.getRelative());
+    assertEqual((uint32_t)25, deadband.getHysteresis());
+}
+
+AHA_TEST(DeadbandTest, negative_thresholds) {
+    HADeadband deadband(-1.0f, -1.0f, -1.0f, 0);
+
+    assertEqual((uint32_t)0, deadband.getAbsolute());
+    assertEqual((uint16_t)0, deadband.getRelative());
+    assertEqual((uint32_t)0, deadband.getHysteresis());
+}
+
+AHA_TEST(DeadbandTest, first_value_published) {
+    HADeadband deadband(10.0f, 0, 0, 0);
+
+    assertPublished(deadband, HANumeric((uint8_t)1, 0))
+    assertEqual((uint32_t)0, deadband.getSuppressedNb());
+}
+
+AHA_TEST(DeadbandTest, absolute_deadband) {
+    HADeadband deadband(0.5f, 0, 0, 1);
+
+    assertPublished(deadband, HANumeric(20.0f, 1))
+    assertSuppressed(deadband, HANumeric(20.5f, 1))
+    assertSuppressed(deadband, HANumeric(19.5f, 1))
+    assertPublished(deadband, HANumeric(20.6f, 1))
+    assertPublished(deadband, HANumeric(20.0f, 1))
+    assertEqual((uint32_t)2, deadband.getSuppressedNb());
+}
+
+AHA_TEST(DeadbandTest, relative_deadband) {
+    HADeadband deadband(0, 10.0f, 0, 0);
+
+    assertPublished(deadband, HANumeric((int16_t)-100, 0))
+    assertSuppressed(deadband, HANumeric((int16_t)-109, 0))
+    assertSuppressed(deadband, HANumeric((int16_t)-90, 0))
+    assertPublished(deadband, HANumeric((int16_t)-111, 0))
+}
+
+AHA_TEST(DeadbandTest, absolute_and_relative_deadband) {
+    HADeadband deadband(5.0f, 1.0f, 0, 0);
+
+    assertPublished(deadband, HANumeric((uint16_t)1000, 0))
+    assertSuppressed(deadband, HANumeric((uint16_t)1006, 0)) // relative: 10
+    assertPublished(deadband, HANumeric((uint16_t)1011, 0))
+
+    assertPublished(deadband, HANumeric((uint16_t)10, 0))
+    assertSuppressed(deadband, HANumeric((uint16_t)15, 0)) // absolute: 5
+    assertPublished(deadband, HANumeric((uint16_t)16, 0))
+}
+
+AHA_TEST(DeadbandTest, equal_value_suppressed) {
+    HADeadband deadband(0, 0, 0, 0);
+
+    assertPublished(deadband, HANumeric((uint8_t)5, 0))
+    assertSuppressed(deadband, HANumeric((uint8_t)5, 0))
+    assertPublished(deadband, HANumeric((uint8_t)6, 0))
+}
+
+AHA_TEST(DeadbandTest, hysteresis) {
+    HADeadband deadband(0, 0, 1.0f, 0);
+
+    assertPublished(deadband, HANumeric((uint8_t)10, 0))
+    assertPublished(deadband, HANumeric((uint8_t)11, 0)) // up
+    assertSuppressed(deadband, HANumeric((uint8_t)10, 0)) // reversal within the hysteresis
+    assertPublished(deadband, HANumeric((uint8_t)12, 0)) // up
+    assertSuppressed(deadband, HANumeric((uint8_t)11, 0))
+    assertPublished(deadband, HANumeric((uint8_t)10, 0)) // down
+    assertPublished(deadband, HANumeric((uint8_t)9, 0)) // down
+    assertSuppressed(deadband, HANumeric((uint8_t)10, 0))
+}
+
+AHA_TEST(DeadbandTest, different_precision_published) {
+    HADeadband deadband(10.0f, 0, 0, 0);
+
+    assertPublished(deadband, HANumeric((uint8_t)10, 0))
+    assertTrue(deadband.shouldPublish(HANumeric(10.5f, 1)));
+}
+
+AHA_TEST(DeadbandTest, unset_value_resets_reference) {
+    HADeadband deadband(10.0f, 0, 0, 0);
+
+    assertPublished(deadband, HANumeric((uint8_t)10, 0))
+    deadband.markPublished(HANumeric());
+    assertPublished(deadband, HANumeric((uint8_t)11, 0))
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
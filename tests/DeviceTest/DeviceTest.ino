@@ -294,6 +294,45 @@ AHA_TEST(DeviceTest, lwt_enabled) {
     assertTrue(mock->getLastWill().retain);
 }
 
+AHA_TEST(DeviceTest, json_cache_disabled_by_default) {
+    initMqttTest(testDeviceId);
+
+    uint16_t length = 0;
+    assertTrue(device.getJson(length) == nullptr);
+}
+
+AHA_TEST(DeviceTest, json_cache_render) {
+    initMqttTest(testDeviceId);
+
+    device.enableJsonCache();
+    device.setName("myName");
+
+    uint16_t length = 0;
+    const uint8_t* json = device.getJson(length);
+    const char* expectedJson = "{\"ids\":\"testDevice\",\"name\":\"myName\"}";
+
+    assertTrue(json != nullptr);
+    assertEqual((uint16_t)strlen(expectedJson), length);
+    assertEqual(0, memcmp(expectedJson, json, length));
+    assertTrue(device.getJson(length) == json); // not rendered again
+}
+
+AHA_TEST(DeviceTest, json_cache_invalidated_by_setter) {
+    initMqttTest(testDeviceId);
+
+    device.enableJsonCache();
+
+    uint16_t length = 0;
+    device.getJson(length);
+    device.setSoftwareVersion("1.0.0");
+
+    const uint8_t* json = device.getJson(length);
+    const char* expectedJson = "{\"ids\":\"testDevice\",\"sw\":\"1.0.0\"}";
+
+    assertEqual((uint16_t)strlen(expectedJson), length);
+    assertEqual(0, memcmp(expectedJson, json, length));
+}
+
 AHA_TEST(DeviceTest, full_serialization) {
     initMqttTest("myDeviceId");
 
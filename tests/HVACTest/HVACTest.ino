@@ -1991,6 +1991,23 @@ AHA_TEST(HVACTest, target_temperature_command_callback_std_function) {
 }
 #endif
 
+AHA_TEST(HVACTest, publish_current_temperature_deadband) {
+    prepareTest
+
+    mock->connectDummy();
+    HAHVAC hvac(testUniqueId, HAHVAC::DefaultFeatures, HAHVAC::PrecisionP2);
+    hvac.setCurrentTemperatureDeadband(0.1f);
+
+    assertTrue(hvac.setCurrentTemperature(21.5f));
+    assertTrue(hvac.setCurrentTemperature(21.56f));
+    assertTrue(hvac.setCurrentTemperature(21.44f));
+    assertTrue(hvac.setCurrentTemperature(21.61f));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(0, AHATOFSTR(CurrentTemperatureTopic), "21.50", true)
+    assertMqttMessage(1, AHATOFSTR(CurrentTemperatureTopic), "21.61", true)
+}
+
 void setup()
 {
     delay(1000);
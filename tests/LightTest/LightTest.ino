@@ -1106,6 +1106,22 @@ AHA_TEST(LightTest, rgb_color_command_different_light) {
     assertRGBColorCallbackNotCalled()
 }
 
+AHA_TEST(LightTest, restore_brightness) {
+    prepareTest
+
+    mqtt.enableStateRestore(100);
+    HALight light(testUniqueId, HALight::BrightnessFeature);
+    light.onBrightnessCommand(onBrightnessCommandReceived);
+    mqtt.loop();
+
+    assertEqual(4, mock->getSubscriptionsNb()); // state topics + command topics
+    assertEqual(AHATOFSTR(BrightnessStateTopic), mock->getSubscriptions()[1]->topic);
+
+    mock->fakeMessage(AHATOFSTR(BrightnessStateTopic), F("50"));
+
+    assertBrightnessCallbackCalled(50, &light)
+}
+
 #ifdef ARDUINOHA_USE_STD_FUNCTION
 AHA_TEST(LightTest, rgb_color_command_callback_std_function) {
     prepareTest
@@ -0,0 +1,584 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define prepareTest \
+    ClientMock netClient; \
+    HAMqttClient client(netClient); \
+    client.setServer("testHost", 1883); \
+    client.setCallback(onMessage); \
+    receivedMessagesNb = 0;
+
+#define connectClient() \
+    netClient.feed(ConnAck, sizeof(ConnAck)); \
+    assertTrue(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true)); \
+    netClient.clearOutput();
+
+#define assertOutput(expected) \
+    assertEqual((size_t)sizeof(expected), netClient.getOutputLength()); \
+    assertEqual(0, memcmp(expected, netClient.getOutput(), sizeof(expected)));
+
+using aunit::TestRunner;
+
+static const uint8_t ConnAck[] = {0x20, 0x02, 0x00, 0x00};
+
+static HAMqttClient* publishingClient = nullptr;
+static uint8_t receivedMessagesNb = 0;
+static char receivedTopic[32];
+static char receivedPayload[32];
+
+void onMessage(char* topic, uint8_t* payload, unsigned int length)
+{
+    receivedMessagesNb++;
+    strncpy(receivedTopic, topic, sizeof(receivedTopic) - 1);
+    memcpy(receivedPayload, payload, length);
+    receivedPayload[length] = 0;
+
+    // the outgoing data doesn't share the buffer with the incoming packet
+    if (publishingClient) {
+        publishingClient->beginPublish("echo", length, false);
+        publishingClient->write(payload, length);
+        publishingClient->endPublish();
+    }
+}
+
+AHA_TEST(MqttClientTest, connect_packet) {
+    prepareTest
+
+    const uint8_t expected[] = {
+        0x10, 0x0E,
+        0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x0F,
+        0x00, 0x02, 'i', 'd'
+    };
+
+    netClient.feed(ConnAck, sizeof(ConnAck));
+
+    assertTrue(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    assertTrue(client.connected());
+    assertEqual(HAMqttClient::StateConnected, client.state());
+    assertEqual("testHost", netClient.getHost());
+    assertEqual((uint16_t)1883, netClient.getPort());
+    assertEqual((uint32_t)1, netClient.getWritesNb());
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, connect_packet_with_credentials_and_will) {
+    prepareTest
+
+    const uint8_t expected[] = {
+        0x10, 0x1C,
+        0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xE4, 0x00, 0x0F,
+        0x00, 0x02, 'i', 'd',
+        0x00, 0x01, 'w',
+        0x00, 0x03, 'o', 'f', 'f',
+        0x00, 0x01, 'u',
+        0x00, 0x01, 'p'
+    };
+
+    netClient.feed(ConnAck, sizeof(ConnAck));
+
+    assertTrue(client.connect("id", "u", "p", "w", 0, true, "off", false));
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, connect_network_failed) {
+    prepareTest
+
+    netClient.setConnectable(false);
+
+    assertFalse(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    assertEqual(HAMqttClient::StateConnectFailed, client.state());
+    assertEqual((size_t)0, netClient.getOutputLength());
+}
+
+AHA_TEST(MqttClientTest, connect_refused) {
+    prepareTest
+
+    const uint8_t connAck[] = {0x20, 0x02, 0x00, 0x05};
+    netClient.feed(connAck, sizeof(connAck));
+
+    assertFalse(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    assertFalse(client.connected());
+    assertEqual(5, client.state());
+    assertFalse(netClient.connected());
+}
+
+AHA_TEST(MqttClientTest, connect_timeout) {
+    prepareTest
+
+    client.setSocketTimeout(1);
+
+    assertFalse(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    assertEqual(HAMqttClient::StateConnectionTimeout, client.state());
+    assertFalse(netClient.connected());
+}
+
+AHA_TEST(MqttClientTest, non_blocking_connect) {
+    prepareTest
+
+    assertTrue(client.beginConnect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    assertTrue(client.isConnecting());
+    assertFalse(client.connected());
+    assertEqual((uint32_t)1, netClient.getWritesNb()); // CONNECT
+
+    assertFalse(client.pollConnack());
+    assertTrue(client.isConnecting());
+
+    netClient.feed(ConnAck, sizeof(ConnAck));
+
+    assertTrue(client.pollConnack());
+    assertFalse(client.isConnecting());
+    assertTrue(client.connected());
+    assertEqual(HAMqttClient::StateConnected, client.state());
+}
+
+AHA_TEST(MqttClientTest, non_blocking_connect_timeout) {
+    prepareTest
+
+    client.setSocketTimeout(1);
+
+    assertTrue(client.beginConnect("id", nullptr, nullptr, nullptr, 0, false, nullptr, true));
+    delay(500);
+    assertFalse(client.pollConnack());
+    assertTrue(client.isConnecting());
+
+    delay(500);
+    assertFalse(client.pollConnack());
+    assertFalse(client.isConnecting());
+    assertEqual(HAMqttClient::StateConnectionTimeout, client.state());
+    assertFalse(netClient.connected());
+}
+
+AHA_TEST(MqttClientTest, session_present) {
+    prepareTest
+
+    const uint8_t connAck[] = {0x20, 0x02, 0x01, 0x00};
+    netClient.feed(connAck, sizeof(connAck));
+
+    assertTrue(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, false));
+    assertTrue(client.isSessionPresent());
+}
+
+AHA_TEST(MqttClientTest, connection_lost) {
+    prepareTest
+    connectClient()
+
+    netClient.closeRemote();
+
+    assertFalse(client.loop());
+    assertEqual(HAMqttClient::StateConnectionLost, client.state());
+}
+
+AHA_TEST(MqttClientTest, disconnect_packet) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0xE0, 0x00};
+    client.disconnect();
+
+    assertOutput(expected)
+    assertFalse(netClient.connected());
+    assertEqual(HAMqttClient::StateDisconnected, client.state());
+}
+
+AHA_TEST(MqttClientTest, streamed_publish) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0x31, 0x08, 0x00, 0x01, 't', 'h', 'e', 'l', 'l', 'o'};
+
+    assertTrue(client.beginPublish("t", 5, true));
+    assertEqual((size_t)3, client.write(reinterpret_cast<const uint8_t*>("hel"), 3));
+    assertEqual((size_t)2, client.print(F("lo")));
+    assertEqual(1, client.endPublish());
+
+    assertEqual((uint32_t)1, netClient.getWritesNb()); // fragments are combined
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, publish_bigger_than_64kb) {
+    prepareTest
+    connectClient()
+
+    const uint32_t payloadLength = 100000;
+    uint8_t chunk[1000];
+    memset(chunk, 'x', sizeof(chunk));
+
+    assertTrue(client.beginPublish("t", payloadLength, false));
+    for (uint32_t i = 0; i < payloadLength / sizeof(chunk); i++) {
+        assertEqual(sizeof(chunk), client.write(chunk, sizeof(chunk)));
+    }
+    assertEqual(1, client.endPublish());
+
+    // remaining length: 100003 = 0x186A3
+    const uint8_t header[] = {0x30, 0xA3, 0x8D, 0x06, 0x00, 0x01, 't'};
+    assertEqual((size_t)(sizeof(header) + payloadLength), netClient.getOutputLength());
+    assertEqual(0, memcmp(header, netClient.getOutput(), sizeof(header)));
+    assertEqual((uint32_t)101, netClient.getWritesNb()); // the header + chunks sent without copying
+}
+
+AHA_TEST(MqttClientTest, publish_partial_write) {
+    prepareTest
+    connectClient()
+
+    uint8_t chunk[20];
+    memset(chunk, 'x', sizeof(chunk));
+    netClient.setWriteLimit(10);
+
+    // the scratch buffer is flushed in the middle of the message
+    assertTrue(client.beginPublish("t", 100, false));
+    for (uint8_t i = 0; i < 5; i++) {
+        client.write(chunk, sizeof(chunk));
+    }
+
+    assertEqual(0, client.endPublish());
+    assertFalse(client.connected());
+    assertEqual(HAMqttClient::StateConnectionLost, client.state());
+    assertEqual((size_t)10, netClient.getOutputLength());
+}
+
+AHA_TEST(MqttClientTest, publish_when_disconnected) {
+    prepareTest
+
+    assertFalse(client.beginPublish("t", 5, true));
+}
+
+AHA_TEST(MqttClientTest, subscribe_packet) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0x82, 0x06, 0x00, 0x01, 0x00, 0x01, 't', 0x00};
+
+    assertTrue(client.subscribe("t"));
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, unsubscribe_packet) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0xA2, 0x05, 0x00, 0x01, 0x00, 0x01, 't'};
+
+    assertTrue(client.unsubscribe("t"));
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, incremental_publish_parsing) {
+    prepareTest
+    connectClient()
+
+    const uint8_t packet[] = {0x30, 0x0A, 0x00, 0x05, 't', 'o', 'p', 'i', 'c', 'a', 'b', 'c'};
+
+    netClient.feed(packet, 1);
+    assertTrue(client.loop());
+
+    netClient.feed(&packet[1], 5);
+    assertTrue(client.loop());
+    assertEqual(0, receivedMessagesNb);
+
+    netClient.feed(&packet[6], sizeof(packet) - 6);
+    assertTrue(client.loop());
+
+    assertEqual(1, receivedMessagesNb);
+    assertEqual("topic", receivedTopic);
+    assertEqual("abc", receivedPayload);
+}
+
+AHA_TEST(MqttClientTest, multiple_packets_in_single_loop) {
+    prepareTest
+    connectClient()
+
+    const uint8_t packets[] = {
+        0x30, 0x04, 0x00, 0x01, 'a', '1',
+        0x30, 0x04, 0x00, 0x01, 'b', '2'
+    };
+
+    netClient.feed(packets, sizeof(packets));
+    client.loop();
+
+    assertEqual(2, receivedMessagesNb);
+    assertEqual("b", receivedTopic);
+    assertEqual("2", receivedPayload);
+}
+
+AHA_TEST(MqttClientTest, qos1_publish_acknowledged) {
+    prepareTest
+    connectClient()
+
+    const uint8_t packet[] = {0x32, 0x07, 0x00, 0x01, 't', 0x12, 0x34, 'o', 'n'};
+    const uint8_t expected[] = {0x40, 0x02, 0x12, 0x34};
+
+    netClient.feed(packet, sizeof(packet));
+    client.loop();
+
+    assertEqual(1, receivedMessagesNb);
+    assertEqual("on", receivedPayload);
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, oversized_packet_dropped) {
+    prepareTest
+
+    client.setBufferSize(8);
+    connectClient()
+
+    const uint8_t packets[] = {
+        0x30, 0x0A, 0x00, 0x05, 't', 'o', 'p', 'i', 'c', 'a', 'b', 'c',
+        0x30, 0x04, 0x00, 0x01, 'a', '1'
+    };
+
+    netClient.feed(packets, sizeof(packets));
+    client.loop();
+
+    assertEqual(1, receivedMessagesNb);
+    assertEqual("a", receivedTopic);
+}
+
+AHA_TEST(MqttClientTest, publish_from_callback) {
+    prepareTest
+    connectClient()
+
+    const uint8_t packet[] = {0x30, 0x08, 0x00, 0x05, 't', 'o', 'p', 'i', 'c', '1'};
+    const uint8_t expected[] = {0x30, 0x07, 0x00, 0x04, 'e', 'c', 'h', 'o', '1'};
+
+    publishingClient = &client;
+    netClient.feed(packet, sizeof(packet));
+    client.loop();
+    publishingClient = nullptr;
+
+    assertEqual("topic", receivedTopic);
+    assertOutput(expected)
+}
+
+AHA_TEST(MqttClientTest, keep_alive_ping) {
+    prepareTest
+
+    client.setKeepAlive(1);
+    connectClient()
+
+    const uint8_t pingReq[] = {0xC0, 0x00};
+    const uint8_t pingResp[] = {0xD0, 0x00};
+
+    delay(1000);
+    assertTrue(client.loop());
+    assertOutput(pingReq)
+
+    netClient.feed(pingResp, sizeof(pingResp));
+    client.loop();
+    delay(1000);
+    netClient.clearOutput();
+
+    assertTrue(client.loop());
+    assertOutput(pingReq)
+}
+
+AHA_TEST(MqttClientTest, keep_alive_timeout) {
+    prepareTest
+
+    client.setKeepAlive(1);
+    connectClient()
+
+    delay(1000);
+    assertTrue(client.loop());
+    delay(1000);
+
+    assertFalse(client.loop());
+    assertEqual(HAMqttClient::StateConnectionTimeout, client.state());
+}
+
+AHA_TEST(MqttClientTest, ping_request_from_broker) {
+    prepareTest
+    connectClient()
+
+    const uint8_t pingReq[] = {0xC0, 0x00};
+    const uint8_t pingResp[] = {0xD0, 0x00};
+
+    netClient.feed(pingReq, sizeof(pingReq));
+    client.loop();
+
+    assertOutput(pingResp)
+}
+
+AHA_TEST(MqttClientTest, subscribe_batch_packet) {
+    prepareTest
+    connectClient()
+
+    HASubscriptionBatch batch(32);
+    uint16_t length = 0;
+    batch.add("a");
+    batch.add("b");
+    const uint8_t* packet = batch.build(1, length);
+
+    assertTrue(client.writePacket(packet, length));
+    assertEqual((size_t)length, netClient.getOutputLength());
+    assertEqual(0, memcmp(packet, netClient.getOutput(), length));
+}
+
+AHA_TEST(MqttClientTest, qos1_publish_packet) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0x32, 0x07, 0x00, 0x01, 't', 0x00, 0x01, 'o', 'n'};
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    assertEqual((size_t)2, client.write(reinterpret_cast<const uint8_t*>("on"), 2));
+    assertEqual(1, client.endPublish());
+
+    assertOutput(expected)
+    assertEqual(1, client.getInflightMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_packet_id_not_reused) {
+    prepareTest
+    connectClient()
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+
+    // the identifier of the in-flight message (1) is skipped after the wrap-around
+    for (uint32_t i = 0; i < 70000; i++) {
+        assertNotEqual((uint16_t)1, client.nextPacketId());
+    }
+}
+
+AHA_TEST(MqttClientTest, qos1_puback_releases_slot) {
+    prepareTest
+    connectClient()
+
+    const uint8_t pubAck[] = {0x40, 0x02, 0x00, 0x01};
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+
+    netClient.feed(pubAck, sizeof(pubAck));
+    client.loop();
+
+    assertEqual(0, client.getInflightMessagesNb());
+    assertEqual((uint32_t)0, client.getDroppedMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_retransmission_with_dup_flag) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0x3A, 0x07, 0x00, 0x01, 't', 0x00, 0x01, 'o', 'n'};
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+    netClient.clearOutput();
+
+    client.loop();
+    assertEqual((size_t)0, netClient.getOutputLength()); // the retry interval hasn't elapsed
+
+    delay(1000);
+    client.loop();
+
+    assertOutput(expected)
+    assertEqual(1, client.getInflightMessagesNb());
+    assertEqual((uint32_t)1, client.getRetriedMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_dropped_after_max_retries) {
+    prepareTest
+    connectClient()
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 1));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+
+    delay(1000);
+    client.loop();
+    delay(1000);
+    client.loop();
+
+    assertEqual(0, client.getInflightMessagesNb());
+    assertEqual((uint32_t)1, client.getRetriedMessagesNb());
+    assertEqual((uint32_t)1, client.getDroppedMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_window_full) {
+    prepareTest
+    connectClient()
+
+    assertTrue(client.setInflightWindow(1, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+    netClient.clearOutput();
+
+    assertFalse(client.beginPublish("t", 3, false, 1));
+    assertEqual((size_t)0, netClient.getOutputLength());
+    assertEqual((uint32_t)1, client.getDroppedMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_oversized_message_published_with_qos0) {
+    prepareTest
+    connectClient()
+
+    const uint8_t expected[] = {0x30, 0x0D, 0x00, 0x01, 't', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+    assertTrue(client.setInflightWindow(1, 8, 1000, 2));
+    assertTrue(client.beginPublish("t", 10, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("0123456789"), 10);
+    client.endPublish();
+
+    assertOutput(expected)
+    assertEqual(0, client.getInflightMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_messages_discarded_without_session) {
+    prepareTest
+    connectClient()
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+    client.disconnect();
+
+    connectClient()
+
+    assertEqual(0, client.getInflightMessagesNb());
+}
+
+AHA_TEST(MqttClientTest, qos1_messages_retransmitted_after_session_resumed) {
+    prepareTest
+    connectClient()
+
+    const uint8_t sessionConnAck[] = {0x20, 0x02, 0x01, 0x00};
+    const uint8_t expected[] = {0x3A, 0x07, 0x00, 0x01, 't', 0x00, 0x01, 'o', 'n'};
+
+    assertTrue(client.setInflightWindow(2, 32, 1000, 2));
+    assertTrue(client.beginPublish("t", 2, false, 1));
+    client.write(reinterpret_cast<const uint8_t*>("on"), 2);
+    client.endPublish();
+    client.disconnect();
+
+    netClient.feed(sessionConnAck, sizeof(sessionConnAck));
+    assertTrue(client.connect("id", nullptr, nullptr, nullptr, 0, false, nullptr, false));
+    netClient.clearOutput();
+    client.loop();
+
+    assertOutput(expected)
+    assertEqual((uint32_t)1, client.getRetriedMessagesNb());
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
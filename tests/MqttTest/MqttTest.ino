@@ -12,12 +12,26 @@ class DummyDeviceType : public HABaseDeviceType
 {
 public:
     DummyDeviceType(const __FlashStringHelper* componentName, const char* uniqueId) :
-        HABaseDeviceType(componentName, uniqueId) { }
+        HABaseDeviceType(componentName, uniqueId), receivedMessagesNb(0) { }
+
+    uint8_t receivedMessagesNb;
 
 protected:
     virtual void onMqttConnected() override {
         publishAvailability();
     }
+
+    virtual void onMqttMessage(
+        const char* topic,
+        const uint8_t* payload,
+        const uint16_t length
+    ) override {
+        (void)topic;
+        (void)payload;
+        (void)length;
+
+        receivedMessagesNb++;
+    }
 };
 
 AHA_TEST(MqttTest, maximum_number_of_device_types) {
@@ -29,6 +43,1076 @@ AHA_TEST(MqttTest, maximum_number_of_device_types) {
     assertEqual(&deviceType, mqtt.getDevicesTypes()[0]);
 }
 
+AHA_TEST(MqttTest, dispatch_message_to_owner) {
+    initMqttTest(testDeviceId)
+
+    DummyDeviceType first(AHATOFSTR(ComponentNameStr), "first");
+    DummyDeviceType second(AHATOFSTR(ComponentNameStr), "second");
+    DummyDeviceType third(AHATOFSTR(ComponentNameStr), "third");
+
+    mock->fakeMessage("testData/testDevice/second/cmd_t", "ON");
+
+    assertEqual((uint8_t)0, first.receivedMessagesNb);
+    assertEqual((uint8_t)1, second.receivedMessagesNb);
+    assertEqual((uint8_t)0, third.receivedMessagesNb);
+}
+
+AHA_TEST(MqttTest, dispatch_message_to_owners_with_same_id) {
+    initMqttTest(testDeviceId)
+
+    DummyDeviceType first(AHATOFSTR(ComponentNameStr), "same");
+    DummyDeviceType second(AHATOFSTR(ComponentNameStr), "other");
+    DummyDeviceType third(AHATOFSTR(ComponentNameStr), "same");
+
+    mock->fakeMessage("testData/testDevice/same/cmd_t", "ON");
+
+    assertEqual((uint8_t)1, first.receivedMessagesNb);
+    assertEqual((uint8_t)0, second.receivedMessagesNb);
+    assertEqual((uint8_t)1, third.receivedMessagesNb);
+}
+
+AHA_TEST(MqttTest, dispatch_message_with_prefix_of_object_id) {
+    initMqttTest(testDeviceId)
+
+    DummyDeviceType first(AHATOFSTR(ComponentNameStr), "switch");
+    DummyDeviceType second(AHATOFSTR(ComponentNameStr), "switch1");
+
+    mock->fakeMessage("testData/testDevice/switch1/cmd_t", "ON");
+
+    assertEqual((uint8_t)0, first.receivedMessagesNb);
+    assertEqual((uint8_t)1, second.receivedMessagesNb);
+}
+
+AHA_TEST(MqttTest, broadcast_foreign_message) {
+    initMqttTest(testDeviceId)
+
+    DummyDeviceType first(AHATOFSTR(ComponentNameStr), "first");
+    DummyDeviceType second(AHATOFSTR(ComponentNameStr), "second");
+
+    mock->fakeMessage("otherPrefix/otherDevice/cmd_t", "ON");
+
+    assertEqual((uint8_t)1, first.receivedMessagesNb);
+    assertEqual((uint8_t)1, second.receivedMessagesNb);
+}
+
+AHA_TEST(MqttTest, broadcast_message_without_owner) {
+    initMqttTest(testDeviceId)
+
+    DummyDeviceType first(AHATOFSTR(ComponentNameStr), "first");
+    DummyDeviceType second(AHATOFSTR(ComponentNameStr), "second");
+
+    mock->fakeMessage("testData/testDevice/unknown/cmd_t", "ON");
+
+    assertEqual((uint8_t)1, first.receivedMessagesNb);
+    assertEqual((uint8_t)1, second.receivedMessagesNb);
+}
+
+AHA_TEST(MqttTest, payload_buffer_disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    assertEqual((uint16_t)0, mqtt.getPayloadBufferSize());
+    assertFalse(mqtt.enablePayloadBuffer(0));
+    assertEqual((uint16_t)0, mqtt.getPayloadBufferSize());
+}
+
+AHA_TEST(MqttTest, payload_buffer_combines_writes) {
+    initMqttTest(testDeviceId)
+
+    assertTrue(mqtt.enablePayloadBuffer(512));
+    assertEqual((uint16_t)512, mqtt.getPayloadBufferSize());
+
+    HASwitch testSwitch("uniqueSwitch");
+    mqtt.loop();
+
+    assertMqttMessage(
+        0,
+        "homeassistant/switch/testDevice/uniqueSwitch/config",
+        (
+            "{"
+            "\"uniq_id\":\"uniqueSwitch\","
+            "\"dev\":{\"ids\":\"testDevice\"},"
+            "\"stat_t\":\"testData/testDevice/uniqueSwitch/stat_t\","
+            "\"cmd_t\":\"testData/testDevice/uniqueSwitch/cmd_t\""
+            "}"
+        ),
+        true
+    )
+    assertEqual((uint32_t)mock->getFlushedMessagesNb(), mock->getWritesNb()); // single write per message
+    assertTrue(mqtt.getSavedPayloadWritesNb() > 0);
+}
+
+AHA_TEST(MqttTest, payload_buffer_flushes_full_chunks) {
+    initMqttTest(testDeviceId)
+    mock->connectDummy();
+
+    mqtt.enablePayloadBuffer(8);
+    mqtt.beginPublish("testTopic", 22, false);
+    mqtt.writePayload(F("{\"a\":"));
+    mqtt.writePayload("\"value\"", 7);
+    mqtt.writePayload(F(",\"b\":true}"));
+
+    assertEqual((uint32_t)2, mock->getWritesNb());
+
+    mqtt.endPublish();
+
+    assertSingleMqttMessage("testTopic", "{\"a\":\"value\",\"b\":true}", false)
+    assertEqual((uint32_t)3, mock->getWritesNb());
+    assertEqual((uint32_t)0, mqtt.getSavedPayloadWritesNb());
+}
+
+AHA_TEST(MqttTest, payload_buffer_passes_big_chunks) {
+    initMqttTest(testDeviceId)
+    mock->connectDummy();
+
+    mqtt.enablePayloadBuffer(4);
+    mqtt.beginPublish("testTopic", 12, false);
+    mqtt.writePayload("ab", 2);
+    mqtt.writePayload("0123456789", 10);
+    mqtt.endPublish();
+
+    assertSingleMqttMessage("testTopic", "ab0123456789", false)
+    assertEqual((uint32_t)2, mock->getWritesNb());
+}
+
+AHA_TEST(MqttTest, payload_buffer_disable) {
+    initMqttTest(testDeviceId)
+    mock->connectDummy();
+
+    mqtt.enablePayloadBuffer(64);
+    mqtt.disablePayloadBuffer();
+    mqtt.beginPublish("testTopic", 4, false);
+    mqtt.writePayload("ab", 2);
+    mqtt.writePayload(F("cd"));
+    mqtt.endPublish();
+
+    assertSingleMqttMessage("testTopic", "abcd", false)
+    assertEqual((uint16_t)0, mqtt.getPayloadBufferSize());
+    assertEqual((uint32_t)2, mock->getWritesNb());
+}
+
+AHA_TEST(MqttTest, device_discovery) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDeviceDiscovery();
+    device.setName("testName");
+
+    HASwitch firstSwitch("firstSwitch");
+    HASwitch secondSwitch("secondSwitch");
+    secondSwitch.setIcon("mdi:home");
+    mqtt.loop();
+
+    assertMqttMessage(
+        0,
+        "homeassistant/device/testDevice/config",
+        (
+            "{"
+            "\"dev\":{\"ids\":\"testDevice\",\"name\":\"testName\"},"
+            "\"o\":{\"name\":\"ArduinoHA\"},"
+            "\"cmps\":{"
+            "\"firstSwitch\":{"
+            "\"p\":\"switch\","
+            "\"uniq_id\":\"firstSwitch\","
+            "\"stat_t\":\"testData/testDevice/firstSwitch/stat_t\","
+            "\"cmd_t\":\"testData/testDevice/firstSwitch/cmd_t\""
+            "},"
+            "\"secondSwitch\":{"
+            "\"p\":\"switch\","
+            "\"uniq_id\":\"secondSwitch\","
+            "\"ic\":\"mdi:home\","
+            "\"stat_t\":\"testData/testDevice/secondSwitch/stat_t\","
+            "\"cmd_t\":\"testData/testDevice/secondSwitch/cmd_t\""
+            "}"
+            "}"
+            "}"
+        ),
+        true
+    )
+    assertEqual(AHATOFSTR(HAStateOff), mock->getFlushedMessages()[1]->buffer); // state of the first switch
+}
+
+AHA_TEST(MqttTest, device_discovery_too_big) {
+    initMqttTest(testDeviceId)
+
+    // the payload exceeds the limit of 16-bit lengths
+    const uint16_t nameLength = 40000;
+    char* name = new char[nameLength + 1];
+    memset(name, 'a', nameLength);
+    name[nameLength] = 0;
+
+    mqtt.enableDeviceDiscovery();
+    device.setName(name);
+
+    HASwitch testSwitch("testSwitch");
+    testSwitch.setName(name);
+    mqtt.loop();
+
+    for (uint8_t i = 0; i < mock->getFlushedMessagesNb(); i++) {
+        assertNotEqual(
+            "homeassistant/device/testDevice/config",
+            mock->getFlushedMessages()[i]->topic
+        );
+    }
+
+    assertEqual(AHATOFSTR(HAStateOff), mock->getFlushedMessages()[0]->buffer); // state of the switch
+
+    delete[] name;
+}
+
+AHA_TEST(MqttTest, device_discovery_with_shared_availability) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDeviceDiscovery();
+    mqtt.enableTopicAbbreviation();
+    device.enableSharedAvailability();
+    device.enableJsonCache();
+
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertMqttMessage(
+        1,
+        "homeassistant/device/testDevice/config",
+        (
+            "{"
+            "\"dev\":{\"ids\":\"testDevice\"},"
+            "\"o\":{\"name\":\"ArduinoHA\"},"
+            "\"avty_t\":\"testData/testDevice/avty_t\","
+            "\"cmps\":{"
+            "\"testSwitch\":{"
+            "\"p\":\"switch\","
+            "\"~\":\"testData/testDevice/testSwitch\","
+            "\"uniq_id\":\"testSwitch\","
+            "\"stat_t\":\"~/stat_t\","
+            "\"cmd_t\":\"~/cmd_t\""
+            "}"
+            "}"
+            "}"
+        ),
+        true
+    )
+}
+
+AHA_TEST(MqttTest, birth_message_subscription) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual("homeassistant/status", mock->getSubscriptions()[0]->topic);
+}
+
+AHA_TEST(MqttTest, birth_message_config_on_first_connection) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state
+    assertEqual(
+        "homeassistant/switch/testDevice/testSwitch/config",
+        mock->getFlushedMessages()[0]->topic
+    );
+}
+
+AHA_TEST(MqttTest, birth_message_no_config_on_reconnect) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop(); // first connection
+    mqtt.loop(); // the mock reports disconnected state
+    mock->clearFlushedMessages();
+
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop(); // reconnection
+
+    assertSingleMqttMessage("testData/testDevice/testSwitch/stat_t", "OFF", true)
+}
+
+AHA_TEST(MqttTest, birth_message_online) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    mock->fakeMessage("homeassistant/status", "online");
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual(
+        "homeassistant/switch/testDevice/testSwitch/config",
+        mock->getFlushedMessages()[0]->topic
+    );
+}
+
+AHA_TEST(MqttTest, birth_message_offline) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    mock->fakeMessage("homeassistant/status", "offline");
+    mock->fakeMessage("homeassistant/other", "online");
+
+    assertNoMqttMessage()
+}
+
+AHA_TEST(MqttTest, birth_message_device_discovery) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableDiscoveryOnBirthMessage();
+    mqtt.enableDeviceDiscovery();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    mock->fakeMessage("homeassistant/status", "online");
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+    assertEqual(
+        "homeassistant/device/testDevice/config",
+        mock->getFlushedMessages()[0]->topic
+    );
+}
+
+AHA_TEST(MqttTest, clean_session_by_default) {
+    initMqttTest(testDeviceId)
+
+    mqtt.loop();
+
+    assertFalse(mqtt.isPersistentSessionEnabled());
+    assertTrue(mock->getConnection().cleanSession);
+}
+
+AHA_TEST(MqttTest, persistent_session) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePersistentSession();
+    mqtt.loop();
+
+    assertTrue(mqtt.isPersistentSessionEnabled());
+    assertFalse(mock->getConnection().cleanSession);
+}
+
+AHA_TEST(MqttTest, persistent_session_not_present) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePersistentSession();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual(
+        "testData/testDevice/testSwitch/cmd_t",
+        mock->getSubscriptions()[0]->topic
+    );
+}
+
+AHA_TEST(MqttTest, persistent_session_present) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePersistentSession();
+    mqtt.enableDiscoveryOnBirthMessage();
+    mock->setSessionPresent(true);
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertEqual(0, mock->getSubscriptionsNb());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state
+}
+
+AHA_TEST(MqttTest, session_present_without_persistent_session) {
+    initMqttTest(testDeviceId)
+
+    mock->setSessionPresent(true);
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscriptionsNb());
+}
+
+AHA_TEST(MqttTest, connection_in_single_loop_by_default) {
+    initMqttTest(testDeviceId)
+
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+}
+
+AHA_TEST(MqttTest, phased_connection) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePhasedConnection();
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop(); // network phase
+
+    assertEqual(HAMqtt::StateConnecting, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseConnect, mqtt.getConnectionPhase());
+    assertFalse(mqtt.isConnected());
+    assertNoMqttMessage()
+
+    mqtt.loop(); // CONNECT phase
+
+    assertEqual(HAMqtt::StateConnecting, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseConnack, mqtt.getConnectionPhase());
+    assertFalse(mqtt.isConnected());
+    assertNoMqttMessage()
+
+    mqtt.loop(); // CONNACK phase
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+    assertTrue(mqtt.isConnected());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state
+}
+
+AHA_TEST(MqttTest, phased_connection_awaits_connack) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePhasedConnection();
+    mqtt.setConnectionTimeouts(0, 1000);
+    mock->setConnackAvailable(false);
+    mqtt.loop(); // network phase
+    mqtt.loop(); // CONNECT phase
+    mqtt.loop();
+    delay(500);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnecting, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseConnack, mqtt.getConnectionPhase());
+
+    mock->setConnackAvailable(true);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+}
+
+AHA_TEST(MqttTest, phased_connection_connack_timeout) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePhasedConnection();
+    mqtt.setConnectionTimeouts(0, 1000);
+    mock->setConnackAvailable(false);
+    mqtt.loop(); // network phase
+    mqtt.loop(); // CONNECT phase
+    delay(1000);
+    mqtt.loop(); // CONNACK phase
+
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+    assertFalse(mqtt.isConnected());
+
+    mqtt.loop(); // reconnect interval is not elapsed yet
+
+    assertEqual(HAMqtt::StateConnectionTimeout, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+}
+
+static uint8_t stateChangesNb = 0;
+
+void onStateChangedCount(HAMqtt::ConnectionState state)
+{
+    (void)state;
+    stateChangesNb++;
+}
+
+AHA_TEST(MqttTest, phased_connection_network_failure) {
+    initMqttTest(testDeviceId)
+
+    stateChangesNb = 0;
+    mqtt.onStateChanged(onStateChangedCount);
+    mqtt.enablePhasedConnection();
+    mock->setNetworkAvailable(false);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnectionFailed, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+    assertEqual((uint8_t)2, stateChangesNb); // connecting + failed
+
+    mock->setNetworkAvailable(true);
+    mqtt.loop(); // reconnect interval is not elapsed yet
+
+    assertEqual(HAMqtt::StateConnectionFailed, mqtt.getState());
+    assertEqual(HAMqtt::ConnectionPhaseIdle, mqtt.getConnectionPhase());
+    assertEqual((uint8_t)2, stateChangesNb);
+    assertFalse(mqtt.isConnected());
+}
+
+AHA_TEST(MqttTest, connection_timeouts) {
+    initMqttTest(testDeviceId)
+
+    mqtt.setConnectionTimeouts(2500, 4500);
+
+    assertEqual((uint32_t)2500, mock->getNetworkTimeout());
+    assertEqual((uint16_t)5, mock->getSocketTimeout());
+}
+
+AHA_TEST(MqttTest, connection_default_timeouts) {
+    initMqttTest(testDeviceId)
+
+    mqtt.setConnectionTimeouts(0, 0);
+
+    assertEqual((uint32_t)0, mock->getNetworkTimeout());
+    assertEqual((uint16_t)15, mock->getSocketTimeout());
+}
+
+static uint16_t connectingAttemptsNb[4];
+static uint8_t connectingCallbacksNb = 0;
+static HAMqtt* stateChangedMqtt = nullptr;
+
+void onStateChangedAttempt(HAMqtt::ConnectionState state)
+{
+    if (state == HAMqtt::StateConnecting && connectingCallbacksNb < 4) {
+        connectingAttemptsNb[connectingCallbacksNb++] = stateChangedMqtt->getConnectionAttemptsNb();
+    }
+}
+
+AHA_TEST(MqttTest, reconnect_default_policy) {
+    initMqttTest(testDeviceId)
+
+    mock->setNetworkAvailable(false);
+    mqtt.loop();
+
+    assertEqual((uint16_t)1, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)10000, mqtt.getReconnectDelay());
+
+    delay(100);
+    mqtt.loop(); // the delay is not elapsed yet
+
+    assertEqual((uint16_t)1, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)10000, mqtt.getReconnectDelay());
+}
+
+AHA_TEST(MqttTest, reconnect_exponential_backoff) {
+    initMqttTest(testDeviceId)
+
+    mqtt.setReconnectPolicy(10, 40, 2, 0);
+    mock->setNetworkAvailable(false);
+    mqtt.loop();
+
+    assertEqual((uint16_t)1, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)10, mqtt.getReconnectDelay());
+
+    delay(10);
+    mqtt.loop();
+
+    assertEqual((uint16_t)2, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)20, mqtt.getReconnectDelay());
+
+    delay(20);
+    mqtt.loop();
+
+    assertEqual((uint16_t)3, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)40, mqtt.getReconnectDelay());
+
+    delay(40);
+    mqtt.loop();
+
+    assertEqual((uint16_t)4, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)40, mqtt.getReconnectDelay());
+}
+
+AHA_TEST(MqttTest, reconnect_jitter) {
+    initMqttTest(testDeviceId)
+
+    PubSubClientMock* otherMock = new PubSubClientMock();
+    HADevice otherDevice("otherDevice");
+    HAMqtt otherMqtt(otherMock, otherDevice);
+    otherMqtt.begin("testHost");
+
+    mqtt.setReconnectPolicy(1000, 1000, 2, 50);
+    otherMqtt.setReconnectPolicy(1000, 1000, 2, 50);
+    mock->setNetworkAvailable(false);
+    otherMock->setNetworkAvailable(false);
+    mqtt.loop();
+    otherMqtt.loop();
+
+    assertMoreOrEqual(mqtt.getReconnectDelay(), (uint32_t)500);
+    assertLessOrEqual(mqtt.getReconnectDelay(), (uint32_t)1000);
+    assertMoreOrEqual(otherMqtt.getReconnectDelay(), (uint32_t)500);
+    assertLessOrEqual(otherMqtt.getReconnectDelay(), (uint32_t)1000);
+    assertNotEqual(mqtt.getReconnectDelay(), otherMqtt.getReconnectDelay());
+}
+
+AHA_TEST(MqttTest, reconnect_policy_reset_after_connection) {
+    initMqttTest(testDeviceId)
+
+    mqtt.setReconnectPolicy(10, 40, 2, 0);
+    mock->setNetworkAvailable(false);
+    mqtt.loop();
+
+    delay(10);
+    mqtt.loop();
+
+    assertEqual((uint32_t)20, mqtt.getReconnectDelay());
+
+    mock->setNetworkAvailable(true);
+    delay(20);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual((uint16_t)0, mqtt.getConnectionAttemptsNb());
+    assertEqual((uint32_t)0, mqtt.getReconnectDelay());
+}
+
+AHA_TEST(MqttTest, reconnect_jitter_after_connection_lost) {
+    initMqttTest(testDeviceId)
+
+    mqtt.setReconnectPolicy(1000, 8000, 2, 50);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+
+    mqtt.loop(); // the mock reports the lost connection
+
+    assertEqual(HAMqtt::StateDisconnected, mqtt.getState());
+    assertLessOrEqual(mqtt.getReconnectDelay(), (uint32_t)500);
+}
+
+AHA_TEST(MqttTest, connection_attempts_in_state_callback) {
+    initMqttTest(testDeviceId)
+
+    connectingCallbacksNb = 0;
+    stateChangedMqtt = &mqtt;
+    mqtt.onStateChanged(onStateChangedAttempt);
+    mqtt.setReconnectPolicy(10, 10, 1, 0);
+    mock->setNetworkAvailable(false);
+    mqtt.loop();
+
+    delay(10);
+    mqtt.loop();
+
+    mock->setNetworkAvailable(true);
+    delay(10);
+    mqtt.loop();
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual((uint8_t)3, connectingCallbacksNb);
+    assertEqual((uint16_t)1, connectingAttemptsNb[0]);
+    assertEqual((uint16_t)2, connectingAttemptsNb[1]);
+    assertEqual((uint16_t)3, connectingAttemptsNb[2]);
+}
+
+AHA_TEST(MqttTest, discovery_in_single_loop_by_default) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.loop();
+
+    assertTrue(mqtt.isDiscoveryCompleted());
+    assertEqual((uint8_t)2, mqtt.getDiscoveryProgress());
+    assertEqual(4, mock->getFlushedMessagesNb()); // config + state of each switch
+}
+
+AHA_TEST(MqttTest, discovery_not_completed_before_connection) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+
+    assertFalse(mqtt.isDiscoveryCompleted());
+}
+
+AHA_TEST(MqttTest, paced_discovery_entities_limit) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    HASwitch switchC("switchC");
+    mqtt.enablePacedDiscovery(2);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertFalse(mqtt.isDiscoveryCompleted());
+    assertEqual((uint8_t)0, mqtt.getDiscoveryProgress());
+    assertNoMqttMessage()
+
+    mqtt.loop();
+
+    assertFalse(mqtt.isDiscoveryCompleted());
+    assertEqual((uint8_t)2, mqtt.getDiscoveryProgress());
+    assertEqual(4, mock->getFlushedMessagesNb());
+
+    mqtt.loop();
+
+    assertTrue(mqtt.isDiscoveryCompleted());
+    assertEqual((uint8_t)3, mqtt.getDiscoveryProgress());
+    assertEqual(6, mock->getFlushedMessagesNb());
+
+    mqtt.loop();
+
+    assertEqual(6, mock->getFlushedMessagesNb());
+}
+
+AHA_TEST(MqttTest, paced_discovery_bytes_limit) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.enablePacedDiscovery(0, 1);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop();
+
+    assertEqual((uint8_t)1, mqtt.getDiscoveryProgress());
+    assertEqual(2, mock->getFlushedMessagesNb());
+
+    mqtt.loop();
+
+    assertTrue(mqtt.isDiscoveryCompleted());
+    assertEqual(4, mock->getFlushedMessagesNb());
+}
+
+AHA_TEST(MqttTest, paced_discovery_unreached_limits) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.enablePacedDiscovery(10, 10000, 1000000);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop();
+
+    assertTrue(mqtt.isDiscoveryCompleted());
+    assertEqual(4, mock->getFlushedMessagesNb());
+}
+
+AHA_TEST(MqttTest, paced_discovery_restarts_after_reconnect) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.setReconnectPolicy(0, 0);
+    mqtt.enablePacedDiscovery(1);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop();
+
+    assertEqual((uint8_t)1, mqtt.getDiscoveryProgress());
+
+    mock->setState(HAMqtt::StateConnectionLost);
+    mqtt.loop();
+
+    assertFalse(mqtt.isDiscoveryCompleted());
+
+    mock->clearFlushedMessages();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop(); // connection is restored
+
+    assertEqual((uint8_t)1, mqtt.getDiscoveryProgress());
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(
+        0,
+        F("homeassistant/switch/testDevice/switchA/config"),
+        "{\"uniq_id\":\"switchA\",\"dev\":{\"ids\":\"testDevice\"},\"stat_t\":\"testData/testDevice/switchA/stat_t\",\"cmd_t\":\"testData/testDevice/switchA/cmd_t\"}",
+        true
+    )
+}
+
+AHA_TEST(MqttTest, offline_buffering_disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    HASwitch testSwitch("testSwitch");
+
+    assertFalse(mqtt.isOfflineBufferingEnabled());
+    assertFalse(testSwitch.setState(true));
+    assertFalse(testSwitch.getCurrentState());
+}
+
+AHA_TEST(MqttTest, offline_buffering_keeps_state) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableOfflineBuffering();
+    HASwitch testSwitch("testSwitch");
+
+    assertTrue(testSwitch.setState(true));
+    assertTrue(testSwitch.getCurrentState());
+    assertEqual((uint8_t)1, mqtt.getDirtyDevicesTypesNb());
+    assertNoMqttMessage()
+}
+
+AHA_TEST(MqttTest, offline_buffering_first_connection) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableOfflineBuffering();
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    switchA.setState(true);
+    mqtt.loop();
+
+    assertEqual((uint8_t)0, mqtt.getDirtyDevicesTypesNb());
+    assertEqual(4, mock->getFlushedMessagesNb()); // config + state of each switch
+    assertMqttMessage(1, F("testData/testDevice/switchA/stat_t"), "ON", true)
+    assertMqttMessage(3, F("testData/testDevice/switchB/stat_t"), "OFF", true)
+}
+
+AHA_TEST(MqttTest, offline_buffering_replays_dirty_states) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableOfflineBuffering();
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.loop();
+
+    mock->disconnect();
+    assertTrue(switchB.setState(true));
+    assertEqual((uint8_t)1, mqtt.getDirtyDevicesTypesNb());
+
+    mock->clearFlushedMessages();
+    mqtt.loop(); // reconnect
+
+    assertEqual(HAMqtt::StateConnected, mqtt.getState());
+    assertEqual((uint8_t)0, mqtt.getDirtyDevicesTypesNb());
+    assertEqual(3, mock->getFlushedMessagesNb()); // config of each switch + state of switchB
+    assertMqttMessage(2, F("testData/testDevice/switchB/stat_t"), "ON", true)
+}
+
+void onRestoredSwitchCommand(bool state, HASwitch* sender)
+{
+    sender->setState(state);
+}
+
+AHA_TEST(MqttTest, state_restore_window) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableStateRestore(100);
+    HASwitch testSwitch("testSwitch");
+    testSwitch.onCommand(onRestoredSwitchCommand);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+
+    assertTrue(mqtt.isStateRestoreActive());
+    assertEqual(2, mock->getSubscriptionsNb()); // state + command
+    assertSingleMqttMessage(
+        F("homeassistant/switch/testDevice/testSwitch/config"),
+        "{\"uniq_id\":\"testSwitch\",\"dev\":{\"ids\":\"testDevice\"},\"stat_t\":\"testData/testDevice/testSwitch/stat_t\",\"cmd_t\":\"testData/testDevice/testSwitch/cmd_t\"}",
+        true
+    )
+
+    mock->fakeMessage(F("testData/testDevice/testSwitch/stat_t"), F("ON"));
+
+    assertTrue(testSwitch.getCurrentState());
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, F("testData/testDevice/testSwitch/stat_t"), "ON", true)
+
+    mock->clearFlushedMessages();
+    delay(100);
+    mqtt.loop();
+
+    assertFalse(mqtt.isStateRestoreActive());
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual("testData/testDevice/testSwitch/cmd_t", mock->getSubscriptions()[0]->topic);
+    assertSingleMqttMessage(F("testData/testDevice/testSwitch/stat_t"), "ON", true)
+}
+
+AHA_TEST(MqttTest, state_restore_only_after_boot) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableStateRestore(100);
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+    delay(100);
+    mqtt.loop();
+
+    assertFalse(mqtt.isStateRestoreActive());
+
+    mock->setState(HAMqtt::StateConnectionLost);
+    mqtt.loop();
+    mock->clearSubscriptions();
+    mock->clearFlushedMessages();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop(); // connection is restored
+
+    assertFalse(mqtt.isStateRestoreActive());
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state
+}
+
+AHA_TEST(MqttTest, state_restore_with_paced_discovery) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    HASwitch switchC("switchC");
+    switchB.setRetain(true);
+    mqtt.enableStateRestore(100);
+    mqtt.enablePacedDiscovery(1);
+    mqtt.loop();
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop();
+
+    assertSingleMqttMessage(
+        F("homeassistant/switch/testDevice/switchA/config"),
+        "{\"uniq_id\":\"switchA\",\"dev\":{\"ids\":\"testDevice\"},\"stat_t\":\"testData/testDevice/switchA/stat_t\",\"cmd_t\":\"testData/testDevice/switchA/cmd_t\"}",
+        true
+    )
+
+    mock->clearFlushedMessages();
+    delay(100);
+    mqtt.loop(); // the window ends after announcing the second switch
+
+    assertFalse(mqtt.isStateRestoreActive());
+    assertEqual((uint8_t)2, mqtt.getDiscoveryProgress());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config of the second switch + state of the first switch
+    assertMqttMessage(1, F("testData/testDevice/switchA/stat_t"), "OFF", true)
+
+    mock->clearFlushedMessages();
+    mqtt.loop();
+
+    assertTrue(mqtt.isDiscoveryCompleted());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + state of the third switch
+    assertMqttMessage(1, F("testData/testDevice/switchC/stat_t"), "OFF", true)
+}
+
+AHA_TEST(MqttTest, publish_and_disconnect_sequence) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor("testSensor");
+    sensor.setCurrentValue(21);
+    HAMqtt::SingleShotReport report;
+
+    assertTrue(mqtt.publishAndDisconnect(1000, true, &report));
+    assertFalse(mqtt.isConnected());
+    assertEqual(HAMqtt::StateDisconnected, mqtt.getState());
+    assertEqual(2, mock->getFlushedMessagesNb()); // config + value
+    assertMqttMessage(1, F("testData/testDevice/testSensor/stat_t"), "21", true)
+    assertEqual((uint32_t)0, report.connectTime);
+}
+
+AHA_TEST(MqttTest, publish_and_disconnect_without_discovery) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor("testSensor");
+    sensor.setCurrentValue(21);
+
+    assertTrue(mqtt.publishAndDisconnect(1000, false));
+    assertSingleMqttMessage(F("testData/testDevice/testSensor/stat_t"), "21", true)
+}
+
+AHA_TEST(MqttTest, publish_and_disconnect_skips_subscriptions) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    switchB.onCommand(onRestoredSwitchCommand);
+    mqtt.enableStateRestore(100);
+    mqtt.publishAndDisconnect(1000, false);
+
+    assertFalse(mqtt.isStateRestoreActive());
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual("testData/testDevice/switchB/cmd_t", mock->getSubscriptions()[0]->topic);
+}
+
+AHA_TEST(MqttTest, publish_and_disconnect_timeout) {
+    initMqttTest(testDeviceId)
+
+    HAMqtt::SingleShotReport report;
+    mock->setNetworkAvailable(false);
+
+    assertFalse(mqtt.publishAndDisconnect(50, true, &report));
+    assertNoMqttMessage()
+    assertEqual((uint32_t)50, report.connectTime);
+    assertEqual((uint32_t)0, report.discoveryTime);
+}
+
+AHA_TEST(MqttTest, wildcard_subscription) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableWildcardSubscription();
+    HASwitch testSwitch("testSwitch");
+    testSwitch.onCommand(onRestoredSwitchCommand);
+    HALight testLight("testLight", HALight::BrightnessFeature | HALight::RGBFeature);
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscriptionsNb());
+    assertEqual("testData/testDevice/#", mock->getSubscriptions()[0]->topic);
+
+    mock->clearFlushedMessages();
+    mock->fakeMessage(F("testData/testDevice/testSwitch/stat_t"), F("ON"));
+
+    assertFalse(testSwitch.getCurrentState());
+    assertNoMqttMessage()
+
+    mock->fakeMessage(F("testData/testDevice/testSwitch/cmd_t"), F("ON"));
+
+    assertTrue(testSwitch.getCurrentState());
+    assertSingleMqttMessage(F("testData/testDevice/testSwitch/stat_t"), "ON", true)
+}
+
+AHA_TEST(MqttTest, wildcard_subscription_skipped_without_callbacks_in_single_shot) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableWildcardSubscription();
+    HASwitch testSwitch("testSwitch");
+    mqtt.publishAndDisconnect(1000, false);
+
+    assertEqual(0, mock->getSubscriptionsNb());
+}
+
+AHA_TEST(MqttTest, qos1_publishing) {
+    initMqttTest(testDeviceId)
+
+    assertTrue(mqtt.enableQos1Publishing(4, 64));
+    assertEqual(4, mock->getInflightWindowSize());
+
+    HASwitch testSwitch("testSwitch");
+    testSwitch.setQos(1);
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    assertTrue(testSwitch.setState(true));
+    assertSingleMqttMessage(F("testData/testDevice/testSwitch/stat_t"), "ON", true)
+    assertEqual(1, mock->getFlushedMessages()[0]->qos);
+
+    assertTrue(mqtt.publish("customTopic", "customPayload", false, 1));
+    assertEqual(1, mock->getFlushedMessages()[1]->qos);
+}
+
+AHA_TEST(MqttTest, qos0_publishing_by_default) {
+    initMqttTest(testDeviceId)
+
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    assertEqual(0, testSwitch.getQos());
+    assertTrue(testSwitch.setState(true));
+    assertSingleMqttMessage(F("testData/testDevice/testSwitch/stat_t"), "ON", true)
+    assertEqual(0, mock->getFlushedMessages()[0]->qos);
+}
+
+AHA_TEST(MqttTest, publish_scheduler_settings) {
+    initMqttTest(testDeviceId)
+
+    assertTrue(mqtt.getPublishScheduler() == nullptr);
+    assertTrue(mqtt.enablePublishScheduler(50, 16));
+    assertFalse(mqtt.enablePublishScheduler());
+
+    assertEqual((uint16_t)50, mqtt.getPublishScheduler()->getResolution());
+    assertEqual((uint8_t)16, mqtt.getPublishScheduler()->getSlotsNb());
+}
+
+AHA_TEST(MqttTest, publish_scheduler_enabled_by_policy) {
+    initMqttTest(testDeviceId)
+
+    HASwitch testSwitch("uniqueSwitch");
+    testSwitch.setPublishInterval(0, 60000);
+    assertTrue(mqtt.getPublishScheduler() == nullptr);
+
+    mqtt.loop();
+
+    assertTrue(mqtt.getPublishScheduler() != nullptr);
+    assertEqual((uint16_t)1, mqtt.getPublishScheduler()->getTimersNb());
+}
+
 void setup()
 {
     delay(1000);
@@ -880,6 +880,23 @@ AHA_TEST(NumberTest, command_callback_std_function) {
 }
 #endif
 
+AHA_TEST(NumberTest, set_state_deadband) {
+    prepareTest
+
+    mock->connectDummy();
+    HANumber number(testUniqueId);
+    number.setDeadband(0, 0, 1);
+
+    assertTrue(number.setState((uint8_t)50));
+    assertTrue(number.setState((uint8_t)51));
+    assertTrue(number.setState((uint8_t)50)); // reversal within the hysteresis
+    assertTrue(number.setState((uint8_t)51));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(0, AHATOFSTR(StateTopic), "50", true)
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "51", true)
+}
+
 void setup()
 {
     delay(1000);
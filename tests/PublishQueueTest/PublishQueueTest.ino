@@ -0,0 +1,202 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define prepareTest \
+    initMqttTest(testDeviceId) \
+    mqtt.enablePublishQueue(4, 16); \
+    mock->connectDummy();
+
+using aunit::TestRunner;
+
+static const char* testDeviceId = "testDevice";
+static const char* testUniqueId = "uniqueSwitch";
+
+const char StateTopic[] PROGMEM = {"testData/testDevice/uniqueSwitch/stat_t"};
+const char SecondStateTopic[] PROGMEM = {"testData/testDevice/secondSwitch/stat_t"};
+
+AHA_TEST(PublishQueueTest, disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(mqtt.getPublishQueue() == nullptr);
+    assertTrue(testSwitch.setState(true));
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+}
+
+AHA_TEST(PublishQueueTest, invalid_params) {
+    initMqttTest(testDeviceId)
+
+    assertFalse(mqtt.enablePublishQueue(0, 16));
+    assertFalse(mqtt.enablePublishQueue(4, 0));
+    assertTrue(mqtt.getPublishQueue() == nullptr);
+}
+
+AHA_TEST(PublishQueueTest, publish_in_loop) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(testSwitch.setState(true));
+    assertNoMqttMessage()
+    assertEqual((uint8_t)1, mqtt.getPublishQueue()->getMessagesNb());
+
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+    assertEqual((uint8_t)0, mqtt.getPublishQueue()->getMessagesNb());
+}
+
+AHA_TEST(PublishQueueTest, latest_value_wins) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(testSwitch.setState(true));
+    assertTrue(testSwitch.setState(false));
+    assertTrue(testSwitch.setState(true));
+    assertEqual((uint8_t)1, mqtt.getPublishQueue()->getMessagesNb());
+    assertEqual((uint32_t)2, mqtt.getPublishQueue()->getCoalescedMessagesNb());
+
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+}
+
+AHA_TEST(PublishQueueTest, order_of_topics) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+    HASwitch secondSwitch("secondSwitch");
+
+    testSwitch.setState(true);
+    secondSwitch.setState(true);
+    testSwitch.setState(false);
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(0, AHATOFSTR(StateTopic), "OFF", true)
+    assertMqttMessage(1, AHATOFSTR(SecondStateTopic), "ON", true)
+}
+
+AHA_TEST(PublishQueueTest, publish_right_away_if_queue_full) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePublishQueue(1, 16);
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+    HASwitch secondSwitch("secondSwitch");
+
+    assertTrue(testSwitch.setState(true));
+    assertTrue(secondSwitch.setState(true));
+    assertSingleMqttMessage(AHATOFSTR(SecondStateTopic), "ON", true)
+    assertEqual((uint8_t)1, mqtt.getPublishQueue()->getMessagesNb());
+}
+
+AHA_TEST(PublishQueueTest, publish_right_away_if_payload_too_big) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePublishQueue(4, 2);
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(testSwitch.setState(false, true));
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "OFF", true)
+    assertEqual((uint8_t)0, mqtt.getPublishQueue()->getMessagesNb());
+}
+
+AHA_TEST(PublishQueueTest, drain_limit) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePublishQueue(4, 16, 0, 1);
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+    HASwitch secondSwitch("secondSwitch");
+
+    testSwitch.setState(true);
+    secondSwitch.setState(true);
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, AHATOFSTR(SecondStateTopic), "ON", true)
+}
+
+AHA_TEST(PublishQueueTest, drain_interval) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePublishQueue(4, 16, 100);
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+
+    testSwitch.setState(true);
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+
+    testSwitch.setState(false);
+    testSwitch.setState(true);
+    testSwitch.setState(false);
+    mqtt.loop();
+
+    assertEqual(1, mock->getFlushedMessagesNb());
+
+    delay(100);
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "OFF", true)
+}
+
+AHA_TEST(PublishQueueTest, queue_while_disconnected) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enablePublishQueue(4, 16);
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(testSwitch.setState(true));
+    assertEqual((uint8_t)1, mqtt.getPublishQueue()->getMessagesNb());
+
+    mqtt.loop(); // connection + config of the switch
+    mqtt.loop();
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "ON", true)
+}
+
+AHA_TEST(PublishQueueTest, memory_usage) {
+    prepareTest
+
+    const uint32_t usage = mqtt.getPublishQueue()->calculateMemoryUsage();
+    assertTrue(usage >= 4 * 16);
+}
+
+AHA_TEST(PublishQueueTest, qos_kept_in_queue) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+    testSwitch.setQos(1);
+
+    assertTrue(testSwitch.setState(true));
+    mqtt.loop();
+
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "ON", true)
+    assertEqual(1, mock->getFlushedMessages()[0]->qos);
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
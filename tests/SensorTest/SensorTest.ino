@@ -618,6 +618,197 @@ test(SensorNumberTest, publish_precision_mismatch) {
     assertEqual(mock->getFlushedMessagesNb(), 0);
 }
 
+test(SensorNumberTest, publish_deadband) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HASensorNumber sensor(testUniqueId, HASensorNumber::PrecisionP1);
+    sensor.setDeadband(0.2f);
+
+    assertTrue(sensor.setValue(21.0f));
+    assertTrue(sensor.setValue(21.1f));
+    assertTrue(sensor.setValue(21.2f));
+    assertEqual(21.2f, sensor.getCurrentValue().toFloat());
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "21.0", true)
+
+    assertTrue(sensor.setValue(21.3f));
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "21.3", true)
+    assertEqual((uint32_t)2, sensor.getDeadband()->getSuppressedNb());
+}
+
+test(SensorNumberTest, publish_deadband_force) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HASensorNumber sensor(testUniqueId);
+    sensor.setDeadband(5);
+
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertTrue(sensor.setValue((uint8_t)11, true));
+
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "11", true)
+}
+
+test(SensorNumberTest, publish_deadband_disabled) {
+    initMqttTest(testDeviceId)
+
+    mock->connectDummy();
+    HASensorNumber sensor(testUniqueId);
+    sensor.setDeadband(5);
+    sensor.disableDeadband();
+
+    assertTrue(sensor.getDeadband() == nullptr);
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertTrue(sensor.setValue((uint8_t)11));
+    assertEqual(2, mock->getFlushedMessagesNb());
+}
+
+test(SensorTest, publish_interval_not_supported) {
+    initMqttTest(testDeviceId)
+
+    HASensor sensor(testUniqueId);
+
+    assertFalse(sensor.setPublishInterval(1000, 5000));
+    assertTrue(sensor.setPublishInterval(0, 0));
+    assertTrue(mqtt.getPublishScheduler() == nullptr);
+}
+
+test(SensorNumberTest, publish_interval_holds_changes) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    assertTrue(sensor.setPublishInterval(1000));
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    // the state was published after connecting
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertTrue(sensor.setValue((uint8_t)11));
+    assertTrue(sensor.isStateHeld());
+    assertEqual(11, sensor.getCurrentValue().toInt8());
+    assertNoMqttMessage()
+
+    delay(500);
+    mqtt.loop();
+    assertNoMqttMessage()
+
+    delay(500);
+    mqtt.loop();
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "11", true)
+    assertFalse(sensor.isStateHeld());
+}
+
+test(SensorNumberTest, publish_interval_elapsed) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(1000);
+    mqtt.loop();
+    mock->clearFlushedMessages();
+    delay(1000);
+
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "10", true)
+
+    assertTrue(sensor.setValue((uint8_t)11));
+    assertTrue(sensor.isStateHeld());
+    assertEqual(1, mock->getFlushedMessagesNb());
+}
+
+test(SensorNumberTest, publish_interval_force) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(1000);
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    assertTrue(sensor.setValue((uint8_t)10, true));
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "10", true)
+    assertFalse(sensor.isStateHeld());
+}
+
+test(SensorNumberTest, publish_interval_heartbeat) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(0, 5000);
+    mqtt.loop();
+    sensor.setValue((uint8_t)10);
+    mock->clearFlushedMessages();
+
+    delay(4000);
+    mqtt.loop();
+    assertNoMqttMessage()
+
+    delay(1000);
+    mqtt.loop();
+    assertSingleMqttMessage(AHATOFSTR(StateTopic), "10", true)
+
+    delay(3000);
+    assertTrue(sensor.setValue((uint8_t)11));
+    assertEqual(2, mock->getFlushedMessagesNb());
+
+    // the heartbeat is counted from the last publish
+    delay(4000);
+    mqtt.loop();
+    assertEqual(2, mock->getFlushedMessagesNb());
+
+    delay(1000);
+    mqtt.loop();
+    assertEqual(3, mock->getFlushedMessagesNb());
+    assertMqttMessage(2, AHATOFSTR(StateTopic), "11", true)
+}
+
+test(SensorNumberTest, publish_interval_disabled) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(1000, 5000);
+    mqtt.loop();
+    mock->clearFlushedMessages();
+    sensor.setPublishInterval(0, 0);
+
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertTrue(sensor.setValue((uint8_t)11));
+    assertEqual(2, mock->getFlushedMessagesNb());
+    assertEqual((uint16_t)0, mqtt.getPublishScheduler()->getTimersNb());
+}
+
+test(SensorNumberTest, publish_interval_disconnected) {
+    initMqttTest(testDeviceId)
+
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(1000);
+
+    assertFalse(sensor.setValue((uint8_t)10));
+    assertFalse(sensor.isStateHeld());
+    assertTrue(mqtt.getPublishScheduler() == nullptr);
+}
+
+test(SensorNumberTest, publish_interval_offline_buffering) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableOfflineBuffering();
+    HASensorNumber sensor(testUniqueId);
+    sensor.setPublishInterval(1000);
+    mqtt.loop();
+    mock->clearFlushedMessages();
+
+    assertTrue(sensor.setValue((uint8_t)10));
+    assertTrue(sensor.isStateHeld());
+
+    mock->disconnect();
+    delay(1000);
+    mqtt.loop(); // the held change is buffered and replayed after reconnecting
+
+    assertFalse(sensor.isStateHeld());
+    assertEqual((uint8_t)0, mqtt.getDirtyDevicesTypesNb());
+    assertMqttMessage(mock->getFlushedMessagesNb() - 1, AHATOFSTR(StateTopic), "10", true)
+}
+
 void setup()
 {
     delay(1000);
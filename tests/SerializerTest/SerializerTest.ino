@@ -236,6 +236,58 @@ AHA_TEST(SerializerTest, topics_field) {
     )
 }
 
+AHA_TEST(SerializerTest, abbreviated_topics_field) {
+    prepareTest(3)
+
+    mqtt.enableTopicAbbreviation();
+    serializer.set(AHATOFSTR(HANameProperty), "testName");
+    serializer.topic(AHATOFSTR(HAStateTopic));
+    serializer.topic(AHATOFSTR(HACommandTopic));
+
+    flushSerializer(mock, serializer)
+    assertSerializerMqttMessage(
+        (
+            "{"
+            "\"~\":\"testData/testDevice/testId\","
+            "\"name\":\"testName\","
+            "\"stat_t\":\"~/stat_t\","
+            "\"cmd_t\":\"~/cmd_t\""
+            "}"
+        )
+    )
+}
+
+AHA_TEST(SerializerTest, abbreviated_topics_without_data_topics) {
+    prepareTest(1)
+
+    mqtt.enableTopicAbbreviation();
+    device.enableSharedAvailability();
+    serializer.set(HASerializer::WithAvailability);
+
+    flushSerializer(mock, serializer)
+    assertSerializerMqttMessage("{\"avty_t\":\"testData/testDevice/avty_t\"}")
+}
+
+AHA_TEST(SerializerTest, abbreviated_topics_with_shared_availability) {
+    prepareTest(2)
+
+    mqtt.enableTopicAbbreviation();
+    device.enableSharedAvailability();
+    serializer.set(HASerializer::WithAvailability);
+    serializer.topic(AHATOFSTR(HAStateTopic));
+
+    flushSerializer(mock, serializer)
+    assertSerializerMqttMessage(
+        (
+            "{"
+            "\"~\":\"testData/testDevice/testId\","
+            "\"avty_t\":\"testData/testDevice/avty_t\","
+            "\"stat_t\":\"~/stat_t\""
+            "}"
+        )
+    )
+}
+
 AHA_TEST(SerializerTest, device_serialization) {
     prepareTest(1)
 
@@ -257,6 +309,72 @@ AHA_TEST(SerializerTest, device_mixed_serialization) {
     )
 }
 
+AHA_TEST(SerializerTest, device_serialization_cached_json) {
+    prepareTest(2)
+
+    device.enableJsonCache();
+    device.setName("testName");
+    serializer.set(HASerializer::WithDevice);
+    serializer.set(AHATOFSTR(HADeviceClassProperty), "Class1");
+
+    flushSerializer(mock, serializer)
+    assertSerializerMqttMessage(
+        "{\"dev\":{\"ids\":\"testDevice\",\"name\":\"testName\"},\"dev_cla\":\"Class1\"}"
+    )
+}
+
+AHA_TEST(SerializerTest, render_json) {
+    prepareTest(2)
+
+    serializer.set(AHATOFSTR(HANameProperty), "testName");
+    serializer.set(AHATOFSTR(HADeviceClassProperty), "Class1");
+
+    const uint16_t size = serializer.calculateSize();
+    char output[size + 1];
+    memset(output, 0, sizeof(output));
+
+    assertEqual(size, serializer.render(reinterpret_cast<uint8_t*>(output)));
+    assertEqual("{\"name\":\"testName\",\"dev_cla\":\"Class1\"}", output);
+    assertNoMqttMessage()
+}
+
+AHA_TEST(SerializerTest, render_json_with_dirty_device_cache) {
+    prepareTest(2)
+
+    device.enableJsonCache();
+    device.setName("testName");
+    serializer.set(HASerializer::WithDevice);
+    serializer.set(AHATOFSTR(HADeviceClassProperty), "Class1");
+
+    // the cache of the device is rendered in the middle of the outer render
+    const char* expectedJson = "{\"dev\":{\"ids\":\"testDevice\",\"name\":\"testName\"},\"dev_cla\":\"Class1\"}";
+    char output[128];
+    memset(output, 0, sizeof(output));
+
+    assertEqual((uint16_t)strlen(expectedJson), serializer.render(reinterpret_cast<uint8_t*>(output)));
+    assertEqual(expectedJson, output);
+    assertNoMqttMessage()
+
+    uint16_t length = 0;
+    assertTrue(device.getJson(length) != nullptr);
+}
+
+AHA_TEST(SerializerTest, hash_with_dirty_device_cache) {
+    prepareTest(2)
+
+    device.enableJsonCache();
+    device.setName("testName");
+    serializer.set(HASerializer::WithDevice);
+
+    const char* expectedJson = "{\"dev\":{\"ids\":\"testDevice\",\"name\":\"testName\"}}";
+
+    assertEqual(HAUtils::hash(expectedJson, strlen(expectedJson)), serializer.calculateHash());
+    assertNoMqttMessage()
+
+    uint16_t length = 0;
+    assertTrue(device.getJson(length) != nullptr);
+}
+
 AHA_TEST(SerializerTest, device_type_availability) {
     prepareTest(1)
 
@@ -342,6 +342,50 @@ AHA_TEST(SerializerTopicsTest, compare_not_matching_topics) {
     ));
 }
 
+AHA_TEST(SerializerTopicsTest, compare_longer_object_id) {
+    const char* topic = "dataPrefix/testDevice/objectIdX/dummyProgmem";
+    const char* objectId = "objectId";
+
+    HADevice device(deviceId);
+    HAMqtt mqtt(nullptr, device);
+    mqtt.setDataPrefix(dataPrefix);
+
+    assertFalse(HASerializer::compareDataTopics(
+        topic,
+        objectId,
+        AHATOFSTR(DummyProgmemStr)
+    ));
+}
+
+AHA_TEST(SerializerTopicsTest, compare_longer_topic) {
+    const char* topic = "dataPrefix/testDevice/objectId/dummyProgmemX";
+    const char* objectId = "objectId";
+
+    HADevice device(deviceId);
+    HAMqtt mqtt(nullptr, device);
+    mqtt.setDataPrefix(dataPrefix);
+
+    assertFalse(HASerializer::compareDataTopics(
+        topic,
+        objectId,
+        AHATOFSTR(DummyProgmemStr)
+    ));
+}
+
+AHA_TEST(SerializerTopicsTest, compare_matching_topics_without_object_id) {
+    const char* topic = "dataPrefix/testDevice/dummyProgmem";
+
+    HADevice device(deviceId);
+    HAMqtt mqtt(nullptr, device);
+    mqtt.setDataPrefix(dataPrefix);
+
+    assertTrue(HASerializer::compareDataTopics(
+        topic,
+        nullptr,
+        AHATOFSTR(DummyProgmemStr)
+    ));
+}
+
 void setup()
 {
     delay(1000);
@@ -0,0 +1,210 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+using aunit::TestRunner;
+
+static const char* testDeviceId = "testDevice";
+
+void onSwitchCommand(bool state, HASwitch* sender)
+{
+    sender->setState(state);
+}
+
+AHA_TEST(SubscriptionBatchTest, empty_batch) {
+    HASubscriptionBatch batch(32);
+    uint16_t length = 0;
+
+    assertEqual(0, batch.getTopicsNb());
+    assertTrue(batch.build(1, length) == nullptr);
+    assertEqual((uint16_t)0, length);
+}
+
+AHA_TEST(SubscriptionBatchTest, single_topic_packet) {
+    HASubscriptionBatch batch(32);
+    uint16_t length = 0;
+    const uint8_t expected[] = {0x82, 0x08, 0x00, 0x01, 0x00, 0x03, 'a', '/', 'b', 0x00};
+
+    assertTrue(batch.add("a/b"));
+    const uint8_t* packet = batch.build(1, length);
+
+    assertTrue(packet != nullptr);
+    assertEqual((uint16_t)sizeof(expected), length);
+    assertEqual(0, memcmp(expected, packet, length));
+}
+
+AHA_TEST(SubscriptionBatchTest, multiple_topics_packet) {
+    HASubscriptionBatch batch(32);
+    uint16_t length = 0;
+    const uint8_t expected[] = {
+        0x82, 0x0B, 0x01, 0x02,
+        0x00, 0x01, 'a', 0x00,
+        0x00, 0x02, 'b', 'c', 0x00
+    };
+
+    assertTrue(batch.add("a"));
+    assertTrue(batch.add("bc"));
+    const uint8_t* packet = batch.build(0x0102, length);
+
+    assertEqual(2, batch.getTopicsNb());
+    assertEqual((uint16_t)sizeof(expected), length);
+    assertEqual(0, memcmp(expected, packet, length));
+}
+
+AHA_TEST(SubscriptionBatchTest, long_remaining_length) {
+    HASubscriptionBatch batch(256);
+    char topic[121];
+    memset(topic, 'x', sizeof(topic) - 1);
+    topic[sizeof(topic) - 1] = 0;
+    uint16_t length = 0;
+
+    assertTrue(batch.add(topic));
+    const uint8_t* packet = batch.build(1, length);
+
+    // remaining length: 2 + 2 + 120 + 1 = 125, it still fits in a single byte
+    assertEqual(0x82, packet[0]);
+    assertEqual(125, packet[1]);
+
+    assertTrue(batch.add("ab"));
+    packet = batch.build(1, length);
+
+    // remaining length: 125 + 2 + 2 + 1 = 130
+    assertEqual((uint16_t)133, length);
+    assertEqual(0x82, packet[0]);
+    assertEqual(0x82, packet[1]);
+    assertEqual(0x01, packet[2]);
+}
+
+AHA_TEST(SubscriptionBatchTest, packet_full) {
+    HASubscriptionBatch batch(16);
+
+    assertTrue(batch.add("abc")); // 5 + 2 + 6 bytes
+    assertFalse(batch.add("def"));
+    assertEqual(1, batch.getTopicsNb());
+
+    batch.clear();
+
+    assertEqual(0, batch.getTopicsNb());
+    assertTrue(batch.add("def"));
+    assertFalse(batch.add(""));
+    assertFalse(batch.add(nullptr));
+}
+
+AHA_TEST(SubscriptionBatchTest, disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    mqtt.loop();
+
+    assertFalse(mqtt.isSubscriptionBatchingEnabled());
+    assertEqual(2, mock->getSubscribePacketsNb());
+    assertEqual(2, mock->getSubscriptionsNb());
+}
+
+AHA_TEST(SubscriptionBatchTest, invalid_params) {
+    initMqttTest(testDeviceId)
+
+    assertFalse(mqtt.enableSubscriptionBatching(0));
+    assertFalse(mqtt.isSubscriptionBatchingEnabled());
+}
+
+AHA_TEST(SubscriptionBatchTest, single_packet_on_connect) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(256);
+    HASwitch testSwitch("testSwitch");
+    HALight testLight(
+        "testLight",
+        HALight::BrightnessFeature | HALight::ColorTemperatureFeature | HALight::RGBFeature
+    );
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscribePacketsNb());
+    assertEqual(5, mock->getSubscriptionsNb());
+    assertEqual("testData/testDevice/testSwitch/cmd_t", mock->getSubscriptions()[0]->topic);
+    assertEqual("testData/testDevice/testLight/rgb_cmd_t", mock->getSubscriptions()[4]->topic);
+}
+
+AHA_TEST(SubscriptionBatchTest, multiple_packets_on_connect) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(90); // two topics per packet
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    HASwitch switchC("switchC");
+    mqtt.loop();
+
+    assertEqual(2, mock->getSubscribePacketsNb());
+    assertEqual(3, mock->getSubscriptionsNb());
+    assertEqual("testData/testDevice/switchC/cmd_t", mock->getSubscriptions()[2]->topic);
+}
+
+AHA_TEST(SubscriptionBatchTest, topic_bigger_than_packet) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(16);
+    HASwitch testSwitch("testSwitch");
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscribePacketsNb());
+    assertEqual(1, mock->getSubscriptionsNb());
+}
+
+AHA_TEST(SubscriptionBatchTest, paced_discovery) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(256);
+    mqtt.enablePacedDiscovery(2);
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    HASwitch switchC("switchC");
+    mqtt.loop(); // connect
+    mock->setState(HAMqtt::StateConnected);
+    mqtt.loop();
+
+    assertEqual(1, mock->getSubscribePacketsNb());
+    assertEqual(2, mock->getSubscriptionsNb());
+
+    mqtt.loop();
+
+    assertEqual(2, mock->getSubscribePacketsNb());
+    assertEqual(3, mock->getSubscriptionsNb());
+}
+
+AHA_TEST(SubscriptionBatchTest, packet_id_assigned_by_client) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(90); // two topics per packet
+    HASwitch switchA("switchA");
+    HASwitch switchB("switchB");
+    HASwitch switchC("switchC");
+    mock->nextPacketId(); // e.g. the identifier of a QoS 1 message
+    mqtt.loop();
+
+    assertEqual(2, mock->getSubscribePacketsNb());
+    assertEqual((uint16_t)3, mock->getLastPacketId());
+}
+
+AHA_TEST(SubscriptionBatchTest, subscriptions_after_discovery) {
+    initMqttTest(testDeviceId)
+
+    mqtt.enableSubscriptionBatching(256);
+    mqtt.loop();
+    mqtt.subscribe("customTopic");
+
+    assertEqual(1, mock->getSubscribePacketsNb());
+    assertEqual("customTopic", mock->getSubscriptions()[0]->topic);
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
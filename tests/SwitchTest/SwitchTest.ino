@@ -100,6 +100,27 @@ AHA_TEST(SwitchTest, extended_unique_id) {
     assertEqual(2, mock->getFlushedMessagesNb());
 }
 
+AHA_TEST(SwitchTest, abbreviated_topics) {
+    prepareTest
+
+    mqtt.enableTopicAbbreviation();
+    HASwitch testSwitch(testUniqueId);
+    assertEntityConfig(
+        mock,
+        testSwitch,
+        (
+            "{"
+            "\"~\":\"testData/testDevice/uniqueSwitch\","
+            "\"uniq_id\":\"uniqueSwitch\","
+            "\"dev\":{\"ids\":\"testDevice\"},"
+            "\"stat_t\":\"~/stat_t\","
+            "\"cmd_t\":\"~/cmd_t\""
+            "}"
+        )
+    )
+    assertEqual(2, mock->getFlushedMessagesNb());
+}
+
 AHA_TEST(SwitchTest, command_subscription) {
     prepareTest
 
@@ -338,6 +359,32 @@ AHA_TEST(SwitchTest, different_switch_command) {
     assertCommandCallbackNotCalled()
 }
 
+AHA_TEST(SwitchTest, state_message_ignored_without_restore) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+    testSwitch.onCommand(onCommandReceived);
+    mock->fakeMessage(AHATOFSTR(StateTopic), F("ON"));
+
+    assertCommandCallbackNotCalled()
+}
+
+AHA_TEST(SwitchTest, restore_state) {
+    prepareTest
+
+    mqtt.enableStateRestore(100);
+    HASwitch testSwitch(testUniqueId);
+    testSwitch.onCommand(onCommandReceived);
+    mqtt.loop();
+
+    assertEqual(2, mock->getSubscriptionsNb());
+    assertEqual(AHATOFSTR(StateTopic), mock->getSubscriptions()[0]->topic);
+
+    mock->fakeMessage(AHATOFSTR(StateTopic), F("ON"));
+
+    assertCommandCallbackCalled(true, &testSwitch)
+}
+
 #ifdef ARDUINOHA_USE_STD_FUNCTION
 AHA_TEST(SwitchTest, command_callback_std_function) {
     prepareTest
@@ -0,0 +1,142 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+using aunit::TestRunner;
+
+AHA_TEST(TimerWheelTest, invalid_settings) {
+    HATimerWheel wheel(0, 0, 0);
+
+    assertEqual((uint16_t)1, wheel.getResolution());
+    assertEqual((uint8_t)1, wheel.getSlotsNb());
+}
+
+AHA_TEST(TimerWheelTest, timer_expires) {
+    HATimerWheel wheel(10, 8, 0);
+    HATimerWheel::Timer timer;
+
+    wheel.schedule(&timer, 25);
+    assertEqual((uint16_t)1, wheel.getTimersNb());
+    assertTrue(timer.scheduled);
+
+    assertTrue(wheel.poll(20) == nullptr);
+    assertTrue(wheel.poll(24) == nullptr);
+    assertTrue(wheel.poll(25) == &timer);
+    assertTrue(wheel.poll(25) == nullptr);
+    assertEqual((uint16_t)0, wheel.getTimersNb());
+    assertFalse(timer.scheduled);
+}
+
+AHA_TEST(TimerWheelTest, past_deadline) {
+    HATimerWheel wheel(10, 8, 0);
+    HATimerWheel::Timer timer;
+
+    assertTrue(wheel.poll(100) == nullptr);
+    wheel.schedule(&timer, 50);
+
+    assertTrue(wheel.poll(100) == &timer);
+}
+
+AHA_TEST(TimerWheelTest, multiple_revolutions) {
+    HATimerWheel wheel(10, 4, 0);
+    HATimerWheel::Timer timer;
+
+    wheel.schedule(&timer, 100);
+
+    for (uint32_t now = 0; now < 100; now += 5) {
+        assertTrue(wheel.poll(now) == nullptr);
+    }
+
+    assertTrue(wheel.poll(100) == &timer);
+}
+
+AHA_TEST(TimerWheelTest, multiple_timers_in_slot) {
+    HATimerWheel wheel(10, 4, 0);
+    HATimerWheel::Timer timerA;
+    HATimerWheel::Timer timerB;
+    HATimerWheel::Timer timerC;
+
+    wheel.schedule(&timerA, 15);
+    wheel.schedule(&timerB, 15);
+    wheel.schedule(&timerC, 55); // the same slot, next revolution
+
+    HATimerWheel::Timer* first = wheel.poll(20);
+    HATimerWheel::Timer* second = wheel.poll(20);
+    assertTrue(first != nullptr && second != nullptr && first != second);
+    assertTrue(first == &timerA || first == &timerB);
+    assertTrue(second == &timerA || second == &timerB);
+    assertTrue(wheel.poll(20) == nullptr);
+    assertEqual((uint16_t)1, wheel.getTimersNb());
+
+    assertTrue(wheel.poll(55) == &timerC);
+}
+
+AHA_TEST(TimerWheelTest, cancel) {
+    HATimerWheel wheel(10, 8, 0);
+    HATimerWheel::Timer timerA;
+    HATimerWheel::Timer timerB;
+
+    wheel.schedule(&timerA, 30);
+    wheel.schedule(&timerB, 30);
+    wheel.cancel(&timerB);
+    wheel.cancel(&timerB);
+
+    assertEqual((uint16_t)1, wheel.getTimersNb());
+    assertTrue(wheel.poll(30) == &timerA);
+    assertTrue(wheel.poll(1000) == nullptr);
+}
+
+AHA_TEST(TimerWheelTest, reschedule) {
+    HATimerWheel wheel(10, 8, 0);
+    HATimerWheel::Timer timer;
+
+    wheel.schedule(&timer, 30);
+    wheel.schedule(&timer, 70);
+
+    assertEqual((uint16_t)1, wheel.getTimersNb());
+    assertTrue(wheel.poll(50) == nullptr);
+    assertTrue(wheel.poll(70) == &timer);
+}
+
+AHA_TEST(TimerWheelTest, long_pause) {
+    HATimerWheel wheel(10, 4, 0);
+    HATimerWheel::Timer timerA;
+    HATimerWheel::Timer timerB;
+    HATimerWheel::Timer timerC;
+
+    wheel.schedule(&timerA, 15);
+    wheel.schedule(&timerB, 1000);
+    wheel.schedule(&timerC, 200000);
+
+    HATimerWheel::Timer* first = wheel.poll(100000);
+    HATimerWheel::Timer* second = wheel.poll(100000);
+    assertTrue(first == &timerA || first == &timerB);
+    assertTrue(second == &timerA || second == &timerB);
+    assertTrue(wheel.poll(100000) == nullptr);
+
+    assertTrue(wheel.poll(199999) == nullptr);
+    assertTrue(wheel.poll(200000) == &timerC);
+}
+
+AHA_TEST(TimerWheelTest, time_overflow) {
+    HATimerWheel wheel(10, 8, 0xFFFFFFF0);
+    HATimerWheel::Timer timer;
+
+    wheel.schedule(&timer, 0xFFFFFFF0 + 30); // 14 after the overflow
+
+    assertTrue(wheel.poll(0xFFFFFFFF) == nullptr);
+    assertTrue(wheel.poll(5) == nullptr);
+    assertTrue(wheel.poll(14) == &timer);
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}
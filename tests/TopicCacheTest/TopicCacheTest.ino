@@ -0,0 +1,183 @@
+#include <AUnit.h>
+#include <ArduinoHA.h>
+
+#define prepareTest \
+    initMqttTest(testDeviceId) \
+    mqtt.enableTopicCache(128, 4);
+
+using aunit::TestRunner;
+
+static const char* testDeviceId = "testDevice";
+static const char* testUniqueId = "uniqueSwitch";
+
+const char StateTopic[] PROGMEM = {"testData/testDevice/uniqueSwitch/stat_t"};
+const char CommandTopic[] PROGMEM = {"testData/testDevice/uniqueSwitch/cmd_t"};
+
+static bool commandReceived = false;
+
+void onCommandReceived(bool state, HASwitch* caller)
+{
+    (void)state;
+    (void)caller;
+
+    commandReceived = true;
+}
+
+AHA_TEST(TopicCacheTest, disabled_by_default) {
+    initMqttTest(testDeviceId)
+
+    uint16_t length = 0;
+    assertTrue(mqtt.getTopicCache() == nullptr);
+    assertTrue(mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HAStateTopic),
+        length
+    ) == nullptr);
+}
+
+AHA_TEST(TopicCacheTest, invalid_params) {
+    initMqttTest(testDeviceId)
+
+    assertFalse(mqtt.enableTopicCache(0, 4));
+    assertFalse(mqtt.enableTopicCache(128, 0));
+    assertTrue(mqtt.getTopicCache() == nullptr);
+}
+
+AHA_TEST(TopicCacheTest, resolve_topic_once) {
+    prepareTest
+
+    uint16_t length = 0;
+    const char* topic = mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HAStateTopic),
+        length
+    );
+
+    assertEqual(AHATOFSTR(StateTopic), topic);
+    assertEqual((uint16_t)strlen_P(StateTopic), length);
+    assertEqual((uint8_t)1, mqtt.getTopicCache()->getTopicsNb());
+    assertEqual((uint16_t)(length + 1), mqtt.getTopicCache()->getArenaUsage());
+
+    const char* secondTopic = mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HAStateTopic),
+        length
+    );
+
+    assertTrue(topic == secondTopic);
+    assertEqual((uint8_t)1, mqtt.getTopicCache()->getTopicsNb());
+}
+
+AHA_TEST(TopicCacheTest, arena_full) {
+    initMqttTest(testDeviceId)
+    mqtt.enableTopicCache(16, 4);
+
+    uint16_t length = 0;
+    assertTrue(mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HAStateTopic),
+        length
+    ) == nullptr);
+    assertEqual((uint8_t)0, mqtt.getTopicCache()->getTopicsNb());
+}
+
+AHA_TEST(TopicCacheTest, topics_limit) {
+    initMqttTest(testDeviceId)
+    mqtt.enableTopicCache(256, 1);
+
+    uint16_t length = 0;
+    assertTrue(mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HAStateTopic),
+        length
+    ) != nullptr);
+    assertTrue(mqtt.getCachedDataTopic(
+        testUniqueId,
+        AHATOFSTR(HACommandTopic),
+        length
+    ) == nullptr);
+}
+
+AHA_TEST(TopicCacheTest, clear_on_data_prefix_change) {
+    prepareTest
+
+    uint16_t length = 0;
+    mqtt.getCachedDataTopic(testUniqueId, AHATOFSTR(HAStateTopic), length);
+    mqtt.setDataPrefix("newPrefix");
+
+    assertEqual((uint8_t)0, mqtt.getTopicCache()->getTopicsNb());
+    assertEqual(
+        "newPrefix/testDevice/uniqueSwitch/stat_t",
+        mqtt.getCachedDataTopic(testUniqueId, AHATOFSTR(HAStateTopic), length)
+    );
+}
+
+AHA_TEST(TopicCacheTest, memory_usage) {
+    prepareTest
+
+    const uint16_t usage = mqtt.getTopicCache()->calculateMemoryUsage();
+    assertTrue(usage >= 128);
+}
+
+AHA_TEST(TopicCacheTest, publish_on_cached_topic) {
+    prepareTest
+
+    mock->connectDummy();
+    HASwitch testSwitch(testUniqueId);
+
+    assertTrue(testSwitch.setState(true));
+    assertTrue(testSwitch.setState(false));
+    assertEqual((uint8_t)1, mqtt.getTopicCache()->getTopicsNb());
+    assertMqttMessage(0, AHATOFSTR(StateTopic), "ON", true)
+    assertMqttMessage(1, AHATOFSTR(StateTopic), "OFF", true)
+}
+
+AHA_TEST(TopicCacheTest, subscribe_and_compare_cached_topic) {
+    prepareTest
+
+    commandReceived = false;
+    HASwitch testSwitch(testUniqueId);
+    testSwitch.onCommand(onCommandReceived);
+    mqtt.loop();
+
+    assertEqual((uint8_t)1, mock->getSubscriptionsNb());
+    assertEqual(AHATOFSTR(CommandTopic), mock->getSubscriptions()[0]->topic);
+
+    mock->fakeMessage(AHATOFSTR(CommandTopic), "ON");
+    assertTrue(commandReceived);
+}
+
+AHA_TEST(TopicCacheTest, config_with_cached_topics) {
+    prepareTest
+
+    HASwitch testSwitch(testUniqueId);
+    mqtt.loop();
+
+    assertMqttMessage(
+        0,
+        "homeassistant/switch/testDevice/uniqueSwitch/config",
+        (
+            "{"
+            "\"uniq_id\":\"uniqueSwitch\","
+            "\"dev\":{\"ids\":\"testDevice\"},"
+            "\"stat_t\":\"testData/testDevice/uniqueSwitch/stat_t\","
+            "\"cmd_t\":\"testData/testDevice/uniqueSwitch/cmd_t\""
+            "}"
+        ),
+        true
+    )
+    assertEqual((uint8_t)2, mqtt.getTopicCache()->getTopicsNb());
+}
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    while (!Serial);
+}
+
+void loop()
+{
+    TestRunner::run();
+    delay(1);
+}